@@ -2,6 +2,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
+#include <float.h>
+#include <stdarg.h>
+
+#include "matrix_mult.h"
+#ifdef MATMUL_MPI
+  #include "matrix_summa.h"
+#endif
+#ifdef MATMUL_CUDA
+  #include "matrix_cuda.h"
+#endif
+
+// set by the CMake build to the compiler and flags it used
+#ifndef MATMUL_BUILD_INFO
+  #define MATMUL_BUILD_INFO "unknown (built without CMake)"
+#endif
 
 #ifdef _WIN32
   #include <windows.h>
@@ -9,61 +25,94 @@
   #include <direct.h>   
   #define MKDIR(p) _mkdir(p)
   #define PATH_SEP '\\'
-  static long get_memory_used_mb() {
+  static double get_memory_used_mb() {
       PROCESS_MEMORY_COUNTERS pmc;
       if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
-          return (long)(pmc.WorkingSetSize / (1024 * 1024));
+          return pmc.WorkingSetSize / (1024.0 * 1024.0);
       }
-      return 0;
+      return 0.0;
+  }
+  // Windows keeps no resettable peak: PeakWorkingSetSize covers the whole process
+  static int reset_peak_rss() {
+      return -1;
+  }
+  static double get_peak_rss_mb() {
+      PROCESS_MEMORY_COUNTERS pmc;
+      if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+          return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+      }
+      return -1.0;
+  }
+  // PageFaultCount lumps soft and hard faults together; it goes in the minor column
+  static void get_page_faults(long *minor, long *major) {
+      PROCESS_MEMORY_COUNTERS pmc;
+      *minor = GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? (long) pmc.PageFaultCount : -1;
+      *major = -1;
   }
 #else
-  #include <sys/time.h>
   #include <sys/stat.h>
+  #include <sys/resource.h>
   #include <unistd.h>
   #define MKDIR(p) mkdir(p, 0755)
   #define PATH_SEP '/'
-  static long get_memory_used_mb() {
+  #ifdef __linux__
+    #include <sys/syscall.h>
+    #include <sys/ioctl.h>
+    #include <linux/perf_event.h>
+  #endif
+  static double get_memory_used_mb() {
       FILE *f = fopen("/proc/self/statm", "r");
-      if (!f) return 0;
+      if (!f) return 0.0;
       long total_pages, resident_pages;
       if (fscanf(f, "%ld %ld", &total_pages, &resident_pages) != 2) {
           fclose(f);
-          return 0;
+          return 0.0;
       }
       fclose(f);
       long page_size = sysconf(_SC_PAGESIZE);
-      long rss_bytes = resident_pages * page_size;
-      return rss_bytes / (1024 * 1024);
+      return (double) resident_pages * page_size / (1024.0 * 1024.0);
+  }
+  // Linux 4.0+ restarts the VmHWM mark when "5" is written to clear_refs
+  static int reset_peak_rss() {
+      FILE *f = fopen("/proc/self/clear_refs", "w");
+      if (!f) return -1;
+      const int ok = fputs("5", f) >= 0;
+      return fclose(f) == 0 && ok ? 0 : -1;
+  }
+  // VmHWM where /proc has it (follows reset_peak_rss), else the lifetime ru_maxrss
+  static double get_peak_rss_mb() {
+      FILE *f = fopen("/proc/self/status", "r");
+      if (f) {
+          char line[256];
+          long kb = -1;
+          while (fgets(line, sizeof(line), f)) {
+              if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+          }
+          fclose(f);
+          if (kb >= 0) return kb / 1024.0;
+      }
+      struct rusage ru;
+      if (getrusage(RUSAGE_SELF, &ru) != 0) return -1.0;
+    #ifdef __APPLE__
+      return ru.ru_maxrss / (1024.0 * 1024.0);   // bytes on macOS
+    #else
+      return ru.ru_maxrss / 1024.0;              // kilobytes elsewhere
+    #endif
+  }
+  static void get_page_faults(long *minor, long *major) {
+      struct rusage ru;
+      if (getrusage(RUSAGE_SELF, &ru) != 0) {
+          *minor = *major = -1;
+          return;
+      }
+      *minor = ru.ru_minflt;
+      *major = ru.ru_majflt;
   }
 #endif
 
-// ---------- Production Code -----------
-double** allocate_matrix(int n) {
-    double **M = (double**)malloc(n * sizeof(double*));
-    for (int i = 0; i < n; ++i) M[i] = (double*)malloc(n * sizeof(double));
-    return M;
-}
-void free_matrix(double **M, int n) {
-    for (int i = 0; i < n; ++i) free(M[i]);
-    free(M);
-}
-void fill_random(double **M, int n) {
-    for (int i = 0; i < n; ++i)
-        for (int j = 0; j < n; ++j)
-            M[i][j] = (double)rand() / RAND_MAX;
-}
-void matrix_multiply(double **A, double **B, double **C, int n) {
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j) {
-            double s = 0.0;
-            for (int k = 0; k < n; ++k) s += A[i][k] * B[k][j];
-            C[i][j] = s;
-        }
-    }
-}
-// --------------------------------------
 
-// Return seconds (double) wall-clock
+// Return seconds (double) from a monotonic clock: nanosecond resolution and
+// immune to NTP / settimeofday jumps, unlike gettimeofday
 static double now_seconds() {
 #ifdef _WIN32
     LARGE_INTEGER freq, ctr;
@@ -71,9 +120,9 @@ static double now_seconds() {
     QueryPerformanceCounter(&ctr);
     return (double)ctr.QuadPart / (double)freq.QuadPart;
 #else
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + tv.tv_usec * 1e-6;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
 #endif
 }
 
@@ -104,84 +153,2342 @@ static void resolve_csv_path(char *out, size_t outsz) {
     snprintf(out, outsz, "..%cdata%cresults.csv", PATH_SEP, PATH_SEP);
 }
 
+// Columns are only ever appended at the end, so an older header is a prefix
+#define CSV_HEADER "language,matrix_size,run_index,elapsed_sec,memory_used_mb,timestamp_iso,kernel,setup_sec,threads,shape,mults_per_sec,rel_error,precision,load_sec,ranks,density,transfer_sec,p50_sec,p99_sec,gflops,cycles,instructions,l1d_misses,llc_misses,dtlb_misses,alloc_peak_bytes,peak_rss_mb,minor_faults,major_faults,cache,overhead_sec"
+
+// Rewrite the header line of an existing CSV written with an older schema
+static void upgrade_csv_header(const char *path, size_t old_header_len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *body = (char*)malloc((size_t)size + 1);
+    size_t got = fread(body, 1, (size_t)size, f);
+    fclose(f);
+    body[got] = '\0';
+
+    f = fopen(path, "wb");
+    if (!f) {
+        perror("[ERROR] fopen upgrade");
+        free(body);
+        return;
+    }
+    fprintf(f, "%s", CSV_HEADER);
+    if (got > old_header_len) fwrite(body + old_header_len, 1, got - old_header_len, f);
+    else fprintf(f, "\n");
+    fclose(f);
+    free(body);
+    printf("[INFO] Upgraded CSV header to current schema\n");
+}
+
 // ensure file exists and has header
 static void ensure_csv(const char *path) {
     ensure_parent_dir(path);
     FILE *f = fopen(path, "r");
-    if (f) { fclose(f); return; }
+    if (f) {
+        char line[1024] = {0};
+        if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+        fclose(f);
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (strcmp(line, CSV_HEADER) == 0) return;
+        if (len > 0 && strncmp(line, CSV_HEADER, len) == 0 && CSV_HEADER[len] == ',') {
+            upgrade_csv_header(path, len);
+        } else {
+            fprintf(stderr, "[WARN] Unrecognized CSV header in %s\n", path);
+        }
+        return;
+    }
     f = fopen(path, "w");
     if (!f) {
         perror("[ERROR] fopen header");
         fprintf(stderr, "Tried path: %s\n", path);
         return;
     }
-    fprintf(f, "language,matrix_size,run_index,elapsed_sec,memory_used_mb,timestamp_iso\n");
+    fprintf(f, "%s\n", CSV_HEADER);
     fclose(f);
 }
 
-static void append_csv(const char *path, int n, int run_index, double elapsed, long mem_used_mb) {
-    FILE *f = fopen(path, "a");
+// Hardware events counted with --perf, in CSV column order
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_DTLB_MISSES, PERF_EVENT_COUNT };
+#define NO_COUNTERS { -1.0, -1.0, -1.0, -1.0, -1.0 }
+
+// Memory footprint of one run; negative fields were not measured
+typedef struct {
+    double alloc_peak_bytes;   // aligned_malloc high-water mark above the live bytes at the start
+    double peak_rss_mb;        // resident-set high-water mark (whole process where it cannot be reset)
+    double minor_faults;       // page faults served without I/O during the run
+    double major_faults;       // page faults that had to read from disk
+} MemStats;
+#define NO_MEM_STATS { -1.0, -1.0, -1.0, -1.0 }
+
+// Process counters sampled just before a run; mem_probe_stop turns them into MemStats
+typedef struct {
+    double rss_mb;
+    size_t heap_bytes;
+    long minor_faults;
+    long major_faults;
+    int peak_reset;   // the kernel's peak-RSS mark restarted here, so VmHWM is per run
+} MemProbe;
+
+static void mem_probe_start(MemProbe *p) {
+    matrix_alloc_stats_reset();
+    p->heap_bytes = matrix_alloc_stats().current_bytes;
+    p->peak_reset = reset_peak_rss() == 0;
+    get_page_faults(&p->minor_faults, &p->major_faults);
+    p->rss_mb = get_memory_used_mb();
+}
+
+// Fills *out and returns the run's resident-set growth in MB: peak minus start
+// where the peak could be reset, end minus start otherwise
+static double mem_probe_stop(const MemProbe *p, MemStats *out) {
+    const double rss_mb = get_memory_used_mb();
+    long minor, major;
+    get_page_faults(&minor, &major);
+    const MatrixAllocStats a = matrix_alloc_stats();
+    out->alloc_peak_bytes = (double) (a.peak_bytes > p->heap_bytes ? a.peak_bytes - p->heap_bytes : 0);
+    out->peak_rss_mb = get_peak_rss_mb();
+    out->minor_faults = minor >= 0 && p->minor_faults >= 0 ? (double) (minor - p->minor_faults) : -1.0;
+    out->major_faults = major >= 0 && p->major_faults >= 0 ? (double) (major - p->major_faults) : -1.0;
+    const double grown = (p->peak_reset && out->peak_rss_mb >= 0 ? out->peak_rss_mb : rss_mb) - p->rss_mb;
+    return grown > 0 ? grown : 0.0;
+}
+
+// One CSV line; fields follow CSV_HEADER order
+typedef struct {
+    int matrix_size;
+    int run_index;
+    double elapsed;
+    double mem_used_mb;     // resident-set growth over the run
+    const char *kernel;
+    double setup_sec;
+    int threads;
+    const char *shape;
+    double mults_per_sec;   // multiplies completed per second of elapsed time
+    double rel_error;       // ||C - C_ref||_F / ||C_ref||_F; negative if not measured
+    const char *precision;  // "fp64", "fp32" or "mixed"
+    double load_sec;        // one-time time to map the --load input files
+    int ranks;              // MPI ranks that shared the product (1 outside --summa)
+    double density;         // fraction of non-zeros in A for --density runs; negative otherwise
+    double transfer_sec;    // host <-> device copies of this run (GPU backends)
+    double p50_sec;         // median per-request latency (--pipeline); negative otherwise
+    double p99_sec;         // 99th percentile per-request latency (--pipeline); negative otherwise
+    double gflops;          // 2*m*k*n per multiply over elapsed (dense-equivalent); negative if n/a
+    double perf[PERF_EVENT_COUNT];   // counter totals over all workers; negative if not counted
+    MemStats mem;
+    const char *cache;      // "hot" (runs back to back) or "cold" (caches flushed before the run)
+} BenchRow;
+
+// Row of one fp64 multiply on one rank, hot cache, every optional column left
+// "not measured"; callers set the rest by name
+static BenchRow bench_row(int size, int run, double elapsed, const char *kernel, int threads, const char *shape) {
+    BenchRow row = { .matrix_size = size, .run_index = run, .elapsed = elapsed, .kernel = kernel,
+                     .threads = threads, .shape = shape, .mults_per_sec = elapsed > 0 ? 1.0 / elapsed : 0.0,
+                     .rel_error = -1.0, .precision = "fp64", .ranks = 1, .density = -1.0, .p50_sec = -1.0,
+                     .p99_sec = -1.0, .gflops = -1.0, .perf = NO_COUNTERS, .mem = NO_MEM_STATS, .cache = "hot" };
+    return row;
+}
+
+// CSV language column: "C" for the CPU kernels, "C-<BACKEND>" for offloaded runs
+static const char *csv_language = "C";
+
+// Growable text buffer for rows that are written out later
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} TextBuffer;
+
+static void text_printf(TextBuffer *b, const char *fmt, ...) {
+    for (;;) {
+        const size_t room = b->cap - b->len;
+        va_list ap;
+        va_start(ap, fmt);
+        const int need = vsnprintf(b->data ? b->data + b->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (need < 0) return;
+        if ((size_t) need < room) {
+            b->len += (size_t) need;
+            return;
+        }
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap - b->len <= (size_t) need) cap *= 2;
+        char *grown = (char*) realloc(b->data, cap);
+        if (!grown) return;
+        b->data = grown;
+        b->cap = cap;
+    }
+}
+
+// Rows already formatted but not yet in the file. Normally each one is written
+// as soon as it exists; a --sizes / --range sweep keeps them all and writes the
+// file once at exit, so no file I/O happens between runs
+static TextBuffer pending_csv;
+static char pending_csv_path[1024];
+static int defer_csv = 0;
+// --json PATH: every row also becomes one object of a JSON array written at exit
+static const char *json_path = NULL;
+static TextBuffer pending_json;
+static int json_rows = 0;
+
+// One CSV line as a JSON object keyed by the CSV_HEADER names: empty fields
+// become null, numeric ones numbers, the rest strings
+static void append_json_row(TextBuffer *out, const char *line) {
+    const char *name = CSV_HEADER;
+    const char *value = line;
+    text_printf(out, "%s  {", json_rows++ ? ",\n" : "");
+    for (int col = 0; *name; ++col) {
+        const size_t name_len = strcspn(name, ",");
+        const size_t value_len = strcspn(value, ",\n");
+        char field[256];
+        snprintf(field, sizeof(field), "%.*s", (int) value_len, value);
+        text_printf(out, "%s\"%.*s\": ", col ? ", " : "", (int) name_len, name);
+        char *end = NULL;
+        const double num = strtod(field, &end);
+        if (field[0] == '\0') {
+            text_printf(out, "null");
+        } else if (*end == '\0' && isfinite(num)) {
+            text_printf(out, "%s", field);
+        } else {
+            text_printf(out, "\"");
+            for (const char *c = field; *c; ++c) text_printf(out, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+            text_printf(out, "\"");
+        }
+        name += name_len + (name[name_len] == ',');
+        value += value_len + (value[value_len] == ',');
+    }
+    text_printf(out, "}");
+}
+
+static void flush_csv(void) {
+    if (pending_csv.len == 0) return;
+    FILE *f = fopen(pending_csv_path, "a");
     if (!f) {
         perror("[ERROR] fopen append");
-        fprintf(stderr, "Tried path: %s\n", path);
-        return;
+        fprintf(stderr, "Tried path: %s\n", pending_csv_path);
+    } else {
+        fwrite(pending_csv.data, 1, pending_csv.len, f);
+        fclose(f);
     }
+    pending_csv.len = 0;
+}
+
+// Writes whatever rows are still pending; called once on the way out of main
+static void flush_results(void) {
+    flush_csv();
+    if (json_path && json_rows > 0) {
+        FILE *f = fopen(json_path, "w");
+        if (!f) {
+            perror("[ERROR] fopen json");
+            fprintf(stderr, "Tried path: %s\n", json_path);
+        } else {
+            fprintf(f, "[\n%.*s\n]\n", (int) pending_json.len, pending_json.data);
+            fclose(f);
+        }
+    }
+    free(pending_csv.data);
+    free(pending_json.data);
+}
+
+static void append_csv(const char *path, const BenchRow *row) {
     time_t t = time(NULL);
     struct tm *tm = localtime(&t);
     char iso[32];
     strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%S", tm);
-    fprintf(f, "C,%d,%d,%.6f,%ld,%s\n", n, run_index, elapsed, mem_used_mb, iso);
-    fclose(f);
+    snprintf(pending_csv_path, sizeof(pending_csv_path), "%s", path);
+    TextBuffer *f = &pending_csv;
+    const size_t start = f->len;
+    text_printf(f, "%s,%d,%d,%.6f,%.3f,%s,%s,%.6f,%d,%s,%.3f,", csv_language, row->matrix_size, row->run_index,
+                row->elapsed, row->mem_used_mb, iso, row->kernel, row->setup_sec, row->threads, row->shape,
+                row->mults_per_sec);
+    if (row->rel_error >= 0) text_printf(f, "%.3e", row->rel_error);
+    text_printf(f, ",%s,%.6f,%d,", row->precision, row->load_sec, row->ranks);
+    if (row->density >= 0) text_printf(f, "%.6f", row->density);
+    text_printf(f, ",%.6f,", row->transfer_sec);
+    if (row->p50_sec >= 0) text_printf(f, "%.6f", row->p50_sec);
+    text_printf(f, ",");
+    if (row->p99_sec >= 0) text_printf(f, "%.6f", row->p99_sec);
+    text_printf(f, ",");
+    if (row->gflops >= 0) text_printf(f, "%.3f", row->gflops);
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+        text_printf(f, ",");
+        if (row->perf[e] >= 0) text_printf(f, "%.0f", row->perf[e]);
+    }
+    text_printf(f, ",");
+    if (row->mem.alloc_peak_bytes >= 0) text_printf(f, "%.0f", row->mem.alloc_peak_bytes);
+    text_printf(f, ",");
+    if (row->mem.peak_rss_mb >= 0) text_printf(f, "%.3f", row->mem.peak_rss_mb);
+    text_printf(f, ",");
+    if (row->mem.minor_faults >= 0) text_printf(f, "%.0f", row->mem.minor_faults);
+    text_printf(f, ",");
+    if (row->mem.major_faults >= 0) text_printf(f, "%.0f", row->mem.major_faults);
+    // overhead_sec is only written by the Java and Python harnesses' native-kernel rows
+    text_printf(f, ",%s,\n", row->cache);
+    if (json_path && f->data) append_json_row(&pending_json, f->data + start);
+    if (!defer_csv) flush_csv();
 }
 
-int main(int argc, char *argv[]) {
+// ---------- Thread placement ----------
+static PoolAffinity pool_affinity = POOL_AFFINITY_NONE;
+
+typedef struct {
+    int *cpu;
+    int *node;
+} PlacementJob;
+
+static void record_placement(void *arg, int task, int worker) {
+    (void) task;
+    PlacementJob *job = (PlacementJob*) arg;
+    job->cpu[worker] = thread_pool_current_cpu(&job->node[worker]);
+}
+
+// Every pool of the benchmark: --affinity policy, then one line with the CPU
+// and NUMA node of each worker
+static ThreadPool *create_pool(int threads) {
+    ThreadPool *pool = thread_pool_create_pinned(threads, pool_affinity);
+    if (!pool) return NULL;
+    int *cpu = (int*) malloc((size_t) threads * 2 * sizeof(int));
+    if (!cpu) return pool;
+    for (int w = 0; w < 2 * threads; ++w) cpu[w] = -1;
+    PlacementJob job = { cpu, cpu + threads };
+    thread_pool_run_each(pool, record_placement, &job);
+    printf("[INFO] Threads: %d | affinity: %s | cpu(node) per worker:", threads, thread_pool_affinity_name(pool_affinity));
+    for (int w = 0; w < threads; ++w) {
+        if (cpu[w] >= 0) printf(" %d(%d)", cpu[w], job.node[w]);
+        else printf(" ?");
+    }
+    printf("\n");
+    free(cpu);
+    return pool;
+}
+
+// Share of M's pages on each NUMA node (Linux move_pages query, sampled)
+static void log_page_nodes(const char *label, const Matrix *M) {
+#ifdef __linux__
+    enum { SAMPLES = 1024, MAX_NODES = 64 };
+    const long page = sysconf(_SC_PAGESIZE);
+    const size_t bytes = (size_t) M->rows * (size_t) M->ld * sizeof(double);
+    const size_t pages = (bytes + (size_t) page - 1) / (size_t) page;
+    const size_t count = pages < SAMPLES ? pages : SAMPLES;
+    void *addr[SAMPLES];
+    int status[SAMPLES];
+    for (size_t i = 0; i < count; ++i)
+        addr[i] = (char*) M->data + (pages * i / count) * (size_t) page;
+    if (count == 0 || syscall(SYS_move_pages, 0, (unsigned long) count, addr, NULL, status, 0) != 0) return;
+    int per_node[MAX_NODES] = {0};
+    for (size_t i = 0; i < count; ++i)
+        if (status[i] >= 0 && status[i] < MAX_NODES) per_node[status[i]]++;
+    printf("[INFO] Pages of %s by node:", label);
+    for (int nd = 0; nd < MAX_NODES; ++nd)
+        if (per_node[nd]) printf(" node%d %.1f%%", nd, 100.0 * per_node[nd] / count);
+    printf("\n");
+#else
+    (void) label;
+    (void) M;
+#endif
+}
+
+// GFLOP/s of 'multiplies' m x k times k x n products in sec seconds
+static double gflop_rate(double multiplies, int m, int k, int n, double sec) {
+    return sec > 0 ? multiplies * 2.0 * m * k * n / sec * 1e-9 : 0.0;
+}
+
+// ---------- Hardware counters ----------
+// perf_event_open counters for every worker of a pool: each worker opens its
+// own per-thread events, the caller enables them around a multiply and sums
+// them. Events the CPU or kernel (perf_event_paranoid) refuse stay closed and
+// their columns empty.
+typedef struct {
+    int workers;
+    int *fds;   // workers x PERF_EVENT_COUNT, -1 if not open
+} PerfCounters;
+
+#ifdef __linux__
+static const struct { unsigned type; unsigned long long config; } perf_events[PERF_EVENT_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+static void perf_open_worker(void *arg, int task, int worker) {
+    (void) task;
+    PerfCounters *pc = (PerfCounters*) arg;
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[e].type;
+        attr.config = perf_events[e].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // more events than hardware counters get multiplexed; scale by these
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        pc->fds[worker * PERF_EVENT_COUNT + e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+#endif
+
+// NULL if no event could be opened on this system
+static PerfCounters *perf_open(ThreadPool *pool) {
+#ifdef __linux__
+    PerfCounters *pc = (PerfCounters*) malloc(sizeof(PerfCounters));
+    if (!pc) return NULL;
+    pc->workers = thread_pool_size(pool);
+    pc->fds = (int*) malloc((size_t) pc->workers * PERF_EVENT_COUNT * sizeof(int));
+    if (!pc->fds) {
+        free(pc);
+        return NULL;
+    }
+    thread_pool_run_each(pool, perf_open_worker, pc);
+    for (int i = 0; i < pc->workers * PERF_EVENT_COUNT; ++i)
+        if (pc->fds[i] >= 0) return pc;
+    free(pc->fds);
+    free(pc);
+#else
+    (void) pool;
+#endif
+    return NULL;
+}
+
+static void perf_close(PerfCounters *pc) {
+    if (!pc) return;
+#ifdef __linux__
+    for (int i = 0; i < pc->workers * PERF_EVENT_COUNT; ++i)
+        if (pc->fds[i] >= 0) close(pc->fds[i]);
+#endif
+    free(pc->fds);
+    free(pc);
+}
+
+static void perf_start(PerfCounters *pc) {
+#ifdef __linux__
+    for (int i = 0; pc && i < pc->workers * PERF_EVENT_COUNT; ++i) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void) pc;
+#endif
+}
+
+// Stops the counters and sums each event over the workers into out[]
+static void perf_stop(PerfCounters *pc, double out[PERF_EVENT_COUNT]) {
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e) out[e] = -1.0;
+#ifdef __linux__
+    for (int i = 0; pc && i < pc->workers * PERF_EVENT_COUNT; ++i) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        unsigned long long v[3];   // value, time enabled, time running
+        // an event that was never scheduled on a PMU counter measured nothing
+        if (read(pc->fds[i], v, sizeof(v)) != (ssize_t) sizeof(v) || v[2] == 0) continue;
+        const int e = i % PERF_EVENT_COUNT;
+        const double value = (double) v[0] * ((double) v[1] / (double) v[2]);
+        out[e] = (out[e] < 0 ? 0.0 : out[e]) + value;
+    }
+#else
+    (void) pc;
+#endif
+}
+
+// ---------- Run statistics ----------
+// How the kernel loop repeats: untimed warmup runs, then at least min_runs
+// recorded ones, then (with ci_target > 0) more until the median is known
+// precisely enough, max_runs are done or time_budget seconds were timed
+typedef struct {
+    int warmup;
+    int min_runs;
+    int max_runs;
+    double ci_target;     // wanted 95% CI half-width as a fraction of the median; 0 = fixed count
+    double time_budget;
+    int flush_cache;      // evict the caches before every run ("cold") instead of running back to back ("hot")
+} RunPolicy;
+
+#define BOOTSTRAP_RESAMPLES 1000
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile (0..100) of values[0..count); sorts values in place
+static double percentile(double *values, int count, double pct) {
+    qsort(values, (size_t) count, sizeof(double), compare_double);
+    int rank = (int) ceil(pct / 100.0 * count);
+    if (rank < 1) rank = 1;
+    return values[rank - 1];
+}
+
+// 95% percentile-bootstrap interval of the median of times[0..count). The
+// resampling stream has a fixed seed so the same runs give the same interval
+static void bootstrap_median_ci(const double *times, int count, double *lo, double *hi) {
+    double *sample = (double*) malloc((size_t) count * sizeof(double));
+    double *medians = (double*) malloc(BOOTSTRAP_RESAMPLES * sizeof(double));
+    if (!sample || !medians || count < 2) {
+        *lo = *hi = count > 0 ? times[0] : 0.0;
+        free(sample);
+        free(medians);
+        return;
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (int b = 0; b < BOOTSTRAP_RESAMPLES; ++b) {
+        for (int i = 0; i < count; ++i) {
+            // xorshift64: plenty for picking sample indices
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            sample[i] = times[state % (uint64_t) count];
+        }
+        medians[b] = percentile(sample, count, 50.0);
+    }
+    *lo = percentile(medians, BOOTSTRAP_RESAMPLES, 2.5);
+    *hi = percentile(medians, BOOTSTRAP_RESAMPLES, 97.5);
+    free(sample);
+    free(medians);
+}
+
+// Relative 95% CI half-width of the median of times[0..count)
+static double median_ci_width(const double *times, int count) {
+    double *sorted = (double*) malloc((size_t) count * sizeof(double));
+    if (!sorted) return 0.0;
+    memcpy(sorted, times, (size_t) count * sizeof(double));
+    const double median = percentile(sorted, count, 50.0);
+    free(sorted);
+    double lo, hi;
+    bootstrap_median_ci(times, count, &lo, &hi);
+    return median > 0 ? (hi - lo) / 2.0 / median : 0.0;
+}
+
+// Whether the kernel loop should record another run after 'done' runs that
+// took 'timed' seconds together. The bootstrap is redone only every ~10% of
+// the runs so that checking stays cheap next to microsecond multiplies.
+static int need_more_runs(const RunPolicy *pol, const double *times, int done, double timed) {
+    if (done < pol->min_runs) return 1;
+    if (pol->ci_target <= 0 || done >= pol->max_runs || timed >= pol->time_budget) return 0;
+    if (done < 5) return 1;
+    const int every = done / 10 > 1 ? done / 10 : 1;
+    if ((done - pol->min_runs) % every != 0) return 1;
+    return median_ci_width(times, done) > pol->ci_target;
+}
+
+typedef struct {
+    volatile char *buf;
+    size_t bytes;
+    int workers;
+} CacheFlush;
+
+static CacheFlush cache_flush;
+
+// Last-level cache size where the C library reports it, else a generous guess
+static size_t llc_bytes(void) {
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    long v = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (v <= 0) v = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (v > 0) return (size_t) v;
+#endif
+    return (size_t) 32 << 20;
+}
+
+// Each worker rewrites its own slice of a buffer twice the LLC size (at least
+// 16 MB), which evicts A, B and C from the shared cache and, with one slice
+// per core, from the private caches of the cores that ran the multiply
+static void flush_slice(void *arg, int task, int worker) {
+    (void) task;
+    const CacheFlush *cf = (const CacheFlush*) arg;
+    const size_t slice = cf->bytes / (size_t) cf->workers;
+    volatile char *p = cf->buf + (size_t) worker * slice;
+    for (size_t i = 0; i < slice; i += 64) p[i] = (char) (p[i] + 1);
+}
+
+static void flush_caches(ThreadPool *pool) {
+    if (!cache_flush.buf) {
+        size_t bytes = 2 * llc_bytes();
+        if (bytes < ((size_t) 16 << 20)) bytes = (size_t) 16 << 20;
+        cache_flush.buf = (volatile char*) calloc(bytes, 1);
+        if (!cache_flush.buf) {
+            fprintf(stderr, "[WARN] no memory for the cache flush buffer; runs stay hot\n");
+            return;
+        }
+        cache_flush.bytes = bytes;
+    }
+    cache_flush.workers = pool ? thread_pool_size(pool) : 1;
+    if (pool) thread_pool_run_each(pool, flush_slice, &cache_flush);
+    else flush_slice(&cache_flush, 0, 0);
+}
+
+// Parse "naive,blocked" into kernels[]; returns count or -1 on an unknown name
+static int parse_kernel_list(const char *arg, MatrixKernel *kernels, int max) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    int count = 0;
+    for (char *tok = strtok(buf, ","); tok && count < max; tok = strtok(NULL, ",")) {
+        if (matrix_kernel_from_name(tok, &kernels[count]) != 0) {
+            fprintf(stderr, "[ERROR] Unknown kernel '%s'\n", tok);
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+// "LO:HI[:STEP]" into sizes[]. STEP is an increment ("64") or a factor ("x2",
+// the default); returns the count or -1
+static int parse_size_range(const char *arg, int *sizes, int max) {
+    int lo, hi;
+    char step[32] = "x2";
+    if (sscanf(arg, "%d:%d:%31s", &lo, &hi, step) < 2 || lo <= 0 || hi < lo) return -1;
+    const int geometric = step[0] == 'x';
+    const int by = atoi(geometric ? step + 1 : step);
+    if (by < (geometric ? 2 : 1)) return -1;
+    int count = 0;
+    for (long v = lo; v <= hi && count < max; v = geometric ? v * by : v + by) sizes[count++] = (int) v;
+    return count;
+}
+
+// Comma-separated fractions in (0, 1]; returns the count or -1
+static int parse_fraction_list(const char *arg, double *values, int max) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    int count = 0;
+    for (char *tok = strtok(buf, ","); tok && count < max; tok = strtok(NULL, ",")) {
+        double v = atof(tok);
+        if (v <= 0.0 || v > 1.0) return -1;
+        values[count++] = v;
+    }
+    return count;
+}
+
+// Parse "1,2,4,8" into counts[]; returns count or -1 on a bad value
+static int parse_int_list(const char *arg, int *values, int max) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    int count = 0;
+    for (char *tok = strtok(buf, ","); tok && count < max; tok = strtok(NULL, ",")) {
+        int v = atoi(tok);
+        if (v <= 0) return -1;
+        values[count++] = v;
+    }
+    return count;
+}
+
+// Time allocating and releasing 'count' n x n matrices per round, with plain
+// malloc (row table + rows, as the original harness did), one aligned block per
+// matrix, and an arena that is reset after each round.
+static void run_alloc_bench(const char *csv_path, int n, int count, int runs, int arena_flags) {
+    const char *names[3] = { "alloc-malloc", "alloc-aligned", "alloc-arena" };
+    double ***tables = (double***) malloc((size_t) count * sizeof(double**));
+    Matrix *mats = (Matrix*) malloc((size_t) count * sizeof(Matrix));
+    MatrixArena *arena = matrix_arena_create(0, arena_flags);
+    if (!tables || !mats || !arena) {
+        fprintf(stderr, "[ERROR] alloc bench setup failed\n");
+        free(tables);
+        free(mats);
+        matrix_arena_destroy(arena);
+        return;
+    }
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", n, n, n);
+
+    printf("=========== ALLOC BENCHMARK ===========\n");
+    printf("Matrix size: %dx%d | Matrices per round: %d | Runs: %d\n", n, n, count, runs);
+    for (int mode = 0; mode < 3; ++mode) {
+        double total = 0.0;
+        int done = 0;
+        for (int r = 1; r <= runs; ++r) {
+            MemProbe probe;
+            mem_probe_start(&probe);
+            double t0 = now_seconds();
+            int made = 0;
+            for (; made < count; ++made) {
+                const int i = made;
+                // every buffer gets its first row written so lazily mapped pages are counted
+                if (mode == 0) {
+                    double **M = (double**) malloc((size_t) n * sizeof(double*));
+                    int j = 0;
+                    while (M && j < n && (M[j] = (double*) malloc((size_t) n * sizeof(double)))) ++j;
+                    if (!M || j < n) {
+                        while (M && j > 0) free(M[--j]);
+                        free(M);
+                        break;
+                    }
+                    memset(M[0], 0, (size_t) n * sizeof(double));
+                    tables[i] = M;
+                } else {
+                    mats[i] = mode == 1 ? matrix_alloc(n, n) : matrix_arena_alloc(arena, n, n);
+                    if (!mats[i].data) break;
+                    memset(mats[i].data, 0, (size_t) n * sizeof(double));
+                }
+            }
+            for (int i = 0; i < made; ++i) {
+                if (mode == 0) {
+                    for (int j = 0; j < n; ++j) free(tables[i][j]);
+                    free(tables[i]);
+                } else if (mode == 1) {
+                    matrix_free(&mats[i]);
+                }
+            }
+            if (mode == 2) matrix_arena_reset(arena);
+            double elapsed = now_seconds() - t0;
+            if (made < count) {
+                fprintf(stderr, "[ERROR] %s: out of memory after %d of %d matrices; run %d not recorded\n",
+                        names[mode], made, count, r);
+                continue;
+            }
+            total += elapsed;
+            done++;
+
+            BenchRow row = bench_row(n, r, elapsed, names[mode], 1, shape);
+            row.mults_per_sec = elapsed > 0 ? count / elapsed : 0.0;
+            row.mem_used_mb = mem_probe_stop(&probe, &row.mem);
+            // plain malloc bypasses the aligned_malloc counters
+            if (mode == 0) row.mem.alloc_peak_bytes = -1.0;
+            append_csv(csv_path, &row);
+        }
+        if (done > 0) printf("%-14s %.3f us per matrix\n", names[mode], total / done / count * 1e6);
+    }
+    printf("Arena capacity: %.1f MB | huge pages: %s\n", matrix_arena_capacity(arena) / (1024.0 * 1024.0),
+           matrix_arena_huge_pages(arena) ? "yes" : "no");
+    printf("=======================================\n");
+    free(tables);
+    free(mats);
+    matrix_arena_destroy(arena);
+}
+
+// Throughput of 'count' independent n x n products: one matrix_multiply_batch
+// call versus a loop of single SIMD multiplies, for each thread count
+static int run_batch_bench(const char *csv_path, int n, int count, int runs, const int *thread_counts,
+                           int num_thread_counts, int arena_flags) {
+    MatrixArena *arena = matrix_arena_create(0, arena_flags);
+    Matrix *A = (Matrix*) malloc((size_t) count * sizeof(Matrix));
+    Matrix *B = (Matrix*) malloc((size_t) count * sizeof(Matrix));
+    Matrix *C = (Matrix*) malloc((size_t) count * sizeof(Matrix));
+    int ok = arena && A && B && C;
+    for (int i = 0; ok && i < count; ++i) {
+        A[i] = matrix_arena_alloc(arena, n, n);
+        B[i] = matrix_arena_alloc(arena, n, n);
+        C[i] = matrix_arena_alloc(arena, n, n);
+        ok = A[i].data && B[i].data && C[i].data;
+        if (ok) {
+            matrix_fill_random(&A[i]);
+            matrix_fill_random(&B[i]);
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "[ERROR] could not allocate a batch of %d %dx%d matrices\n", count, n, n);
+        free(A);
+        free(B);
+        free(C);
+        matrix_arena_destroy(arena);
+        return 1;
+    }
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", n, n, n);
+
+    printf("=========== BATCH BENCHMARK ===========\n");
+    printf("Matrix size: %dx%d | Batch: %d | Runs: %d\n", n, n, count, runs);
+    for (int ti = 0; ti < num_thread_counts; ++ti) {
+        const int threads = thread_counts[ti];
+        ThreadPool *pool = create_pool(threads);
+        if (!pool) {
+            fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+            break;
+        }
+        for (int mode = 0; mode < 2; ++mode) {
+            const char *kname = mode == 0 ? "batch" : "batch-loop";
+            double total = 0.0;
+            for (int r = 1; r <= runs; ++r) {
+                MemProbe probe;
+                mem_probe_start(&probe);
+                double t0 = now_seconds();
+                if (mode == 0) {
+                    matrix_multiply_batch(pool, A, B, C, count);
+                } else {
+                    for (int i = 0; i < count; ++i) matrix_multiply_parallel(pool, MM_KERNEL_SIMD, &A[i], &B[i], &C[i]);
+                }
+                double elapsed = now_seconds() - t0;
+                total += elapsed;
+                BenchRow row = bench_row(n, r, elapsed, kname, threads, shape);
+                row.mults_per_sec = elapsed > 0 ? count / elapsed : 0.0;
+                row.gflops = gflop_rate(count, n, n, n, elapsed);
+                row.mem_used_mb = mem_probe_stop(&probe, &row.mem);
+                append_csv(csv_path, &row);
+            }
+            printf("%-10s | threads %2d | %.6f s per batch | %.0f multiplies/s\n", kname, threads,
+                   total / runs, count * runs / total);
+        }
+        thread_pool_destroy(pool);
+    }
+    printf("=======================================\n");
+    free(A);
+    free(B);
+    free(C);
+    matrix_arena_destroy(arena);
+    return 0;
+}
+
+// Stand-in for handing a result on: touch every element of C
+static double checksum(const Matrix *C) {
+    double sum = 0.0;
+    for (int i = 0; i < C->rows; ++i)
+        for (int j = 0; j < C->cols; ++j) sum += MAT_AT(C, i, j);
+    return sum;
+}
+
+// A request stream of 'count' independent n x n multiplies, each one filled
+// with fresh inputs ("parse"), multiplied and checksummed ("serialize").
+// pipeline-async keeps up to 'inflight' requests queued on a MatrixExecutor
+// so parsing and serializing overlap the multiplies; pipeline-blocking runs
+// one request at a time on the whole pool. Latency is parse start to
+// serialize end of each request.
+static int run_pipeline_bench(const char *csv_path, int n, int count, int runs, int inflight, MatrixKernel kernel,
+                              const int *thread_counts, int num_thread_counts) {
+    Matrix *A = (Matrix*) calloc((size_t) inflight, sizeof(Matrix));
+    Matrix *B = (Matrix*) calloc((size_t) inflight, sizeof(Matrix));
+    Matrix *C = (Matrix*) calloc((size_t) inflight, sizeof(Matrix));
+    MatrixFuture **pending = (MatrixFuture**) calloc((size_t) inflight, sizeof(MatrixFuture*));
+    double *started = (double*) calloc((size_t) inflight, sizeof(double));
+    double *latency = (double*) malloc((size_t) count * sizeof(double));
+    int ok = A && B && C && pending && started && latency;
+    for (int s = 0; ok && s < inflight; ++s) {
+        A[s] = matrix_alloc(n, n);
+        B[s] = matrix_alloc(n, n);
+        C[s] = matrix_alloc(n, n);
+        ok = A[s].data && B[s].data && C[s].data;
+    }
+    if (!ok) fprintf(stderr, "[ERROR] could not allocate %d request buffers of %dx%d\n", inflight, n, n);
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", n, n, n);
+
+    if (ok) {
+        printf("=========== PIPELINE BENCHMARK ===========\n");
+        printf("Matrix size: %dx%d | Requests: %d | In flight: %d | Kernel: %s | Runs: %d\n", n, n, count, inflight,
+               matrix_kernel_name(kernel), runs);
+    }
+    volatile double sink = 0.0;
+    for (int ti = 0; ok && ti < num_thread_counts; ++ti) {
+        const int threads = thread_counts[ti];
+        ThreadPool *pool = create_pool(threads);
+        if (!pool) {
+            fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+            break;
+        }
+        for (int mode = 0; ok && mode < 2; ++mode) {
+            const char *kname = mode == 0 ? "pipeline-async" : "pipeline-blocking";
+            double total = 0.0, sum_p50 = 0.0, sum_p99 = 0.0;
+            for (int r = 1; r <= runs; ++r) {
+                MatrixExecutor *ex = mode == 0 ? matrix_executor_create(pool) : NULL;
+                if (mode == 0 && !ex) {
+                    fprintf(stderr, "[ERROR] could not start the executor\n");
+                    ok = 0;
+                    break;
+                }
+                MemProbe probe;
+                mem_probe_start(&probe);
+                double t0 = now_seconds();
+                // request i lives in slot i % inflight; before reusing a slot the
+                // request that held it (i - inflight) is finished and serialized
+                for (int i = 0; i < count + inflight && ok; ++i) {
+                    const int s = i % inflight;
+                    if (mode == 0 && i >= inflight) {
+                        if (matrix_future_wait(pending[s]) != 0) ok = 0;
+                        pending[s] = NULL;
+                        sink += checksum(&C[s]);
+                        latency[i - inflight] = now_seconds() - started[s];
+                    }
+                    if (i >= count) continue;
+                    started[s] = now_seconds();
+                    matrix_fill_random(&A[s]);
+                    matrix_fill_random(&B[s]);
+                    if (mode == 0) {
+                        pending[s] = matrix_submit(ex, kernel, &A[s], &B[s], &C[s]);
+                        if (!pending[s]) ok = 0;
+                    } else {
+                        if (matrix_multiply_parallel(pool, kernel, &A[s], &B[s], &C[s]) != 0) ok = 0;
+                        sink += checksum(&C[s]);
+                        latency[i] = now_seconds() - started[s];
+                    }
+                }
+                double elapsed = now_seconds() - t0;
+                // a failure stops the loop with requests still queued; each future is waited on once
+                for (int p = 0; p < inflight; ++p) {
+                    if (pending[p]) matrix_future_wait(pending[p]);
+                    pending[p] = NULL;
+                }
+                matrix_executor_destroy(ex);
+                if (!ok) {
+                    fprintf(stderr, "[ERROR] pipeline request failed\n");
+                    break;
+                }
+                total += elapsed;
+                const double p50 = percentile(latency, count, 50.0), p99 = percentile(latency, count, 99.0);
+                sum_p50 += p50;
+                sum_p99 += p99;
+                BenchRow row = bench_row(n, r, elapsed, kname, threads, shape);
+                row.mults_per_sec = elapsed > 0 ? count / elapsed : 0.0;
+                row.p50_sec = p50;
+                row.p99_sec = p99;
+                row.gflops = gflop_rate(count, n, n, n, elapsed);
+                row.mem_used_mb = mem_probe_stop(&probe, &row.mem);
+                append_csv(csv_path, &row);
+            }
+            if (ok) {
+                printf("%-17s | threads %2d | %.0f requests/s | p50 %.6f s | p99 %.6f s\n", kname, threads,
+                       count * runs / total, sum_p50 / runs, sum_p99 / runs);
+            }
+        }
+        thread_pool_destroy(pool);
+    }
+    if (ok) printf("==========================================\n");
+    for (int s = 0; s < inflight && A && B && C; ++s) {
+        matrix_free(&A[s]);
+        matrix_free(&B[s]);
+        matrix_free(&C[s]);
+    }
+    free(A);
+    free(B);
+    free(C);
+    free(pending);
+    free(started);
+    free(latency);
+    return ok ? 0 : 1;
+}
+
+// Frobenius-norm distance of C from the reference, relative to the reference
+static double relative_error(const Matrix *C, const Matrix *R) {
+    double diff = 0.0, ref = 0.0;
+    for (int i = 0; i < R->rows; ++i) {
+        for (int j = 0; j < R->cols; ++j) {
+            const double d = MAT_AT(C, i, j) - MAT_AT(R, i, j);
+            diff += d * d;
+            ref += MAT_AT(R, i, j) * MAT_AT(R, i, j);
+        }
+    }
+    return ref > 0 ? sqrt(diff / ref) : sqrt(diff);
+}
+
+// ---------- Verification (--verify) ----------
+// Freivalds' check: if C = A * B then C r = A (B r) for every vector r, and
+// both sides cost O(n^2) instead of a multiply. With random real entries in r,
+// a wrong row goes unnoticed only when its error is orthogonal to r, so two
+// rounds are plenty.
+#define VERIFY_ROUNDS 2
+// up to this size (cube root of m*k*n) the naive kernel also gives an
+// element-wise reference; beyond it that would cost as much as the benchmark
+#define VERIFY_REFERENCE_MAX 512
+// the vectors' own stream, row = round: top two bits set lies outside the counter's numbers, their
+// sparse mirrors (top bit) and matrix_input_stream (bit 62), so checking never moves later inputs
+#define VERIFY_STREAM (UINT64_C(3) << 62)
+
+// Largest |(A (B r))_i - (C r)_i| relative to (|A| (|B| |r|))_i, the scale of its
+// rounding error if C is right; -1 if the vectors cannot be allocated
+static double freivalds_residual(const Matrix *A, const Matrix *B, const Matrix *C, int rounds) {
+    double *r = (double*) malloc(((size_t) 2 * B->cols + 2 * (size_t) B->rows) * sizeof(double));
+    if (!r) return -1.0;
+    double *r_abs = r + B->cols, *y = r_abs + B->cols, *y_abs = y + B->rows;
+    Matrix rv = { r, 1, B->cols, B->cols, 0 };
+    double worst = 0.0;
+    for (int round = 0; round < rounds; ++round) {
+        matrix_fill_random_at(NULL, &rv, VERIFY_STREAM, round, 0);
+        for (int j = 0; j < B->cols; ++j) {
+            r[j] = 2.0 * r[j] - 1.0;
+            r_abs[j] = fabs(r[j]);
+        }
+        for (int p = 0; p < B->rows; ++p) {
+            const double *Bp = &MAT_AT(B, p, 0);
+            double s = 0.0, s_abs = 0.0;
+            for (int j = 0; j < B->cols; ++j) {
+                s += Bp[j] * r[j];
+                s_abs += fabs(Bp[j]) * r_abs[j];
+            }
+            y[p] = s;
+            y_abs[p] = s_abs;
+        }
+        for (int i = 0; i < A->rows; ++i) {
+            const double *Ai = &MAT_AT(A, i, 0), *Ci = &MAT_AT(C, i, 0);
+            double z = 0.0, z_abs = 0.0, w = 0.0;
+            for (int p = 0; p < A->cols; ++p) {
+                z += Ai[p] * y[p];
+                z_abs += fabs(Ai[p]) * y_abs[p];
+            }
+            for (int j = 0; j < C->cols; ++j) w += Ci[j] * r[j];
+            const double res = z_abs > 0 ? fabs(z - w) / z_abs : fabs(z - w);
+            if (!(res <= worst)) worst = res;   // also catches NaN
+        }
+    }
+    free(r);
+    return worst;
+}
+
+static double max_abs(const Matrix *M) {
+    double v = 0.0;
+    for (int i = 0; i < M->rows; ++i)
+        for (int j = 0; j < M->cols; ++j)
+            if (fabs(MAT_AT(M, i, j)) > v) v = fabs(MAT_AT(M, i, j));
+    return v;
+}
+
+// Checks C = A * B outside any timed section and prints the outcome; returns
+// 0 if the product passes, -1 if it is wrong (or could not be checked)
+static int verify_product(const Matrix *A, const Matrix *B, const Matrix *C, const char *kname) {
+    // a k-term dot product is within k * eps * sum |a||b| of the exact one;
+    // the margin covers Strassen's growth and the GPU's summation order
+    const double tol = 32.0 * A->cols * DBL_EPSILON;
+    const double residual = freivalds_residual(A, B, C, VERIFY_ROUNDS);
+    int ok = residual >= 0 && residual <= tol;
+    printf("Verify %s: Freivalds residual %.3e over %d rounds (tol %.1e)", kname, residual, VERIFY_ROUNDS, tol);
+    if (cbrt((double) A->rows * A->cols * B->cols) <= VERIFY_REFERENCE_MAX) {
+        Matrix R = matrix_alloc(C->rows, C->cols);
+        if (R.data) {
+            matrix_multiply_with(MM_KERNEL_NAIVE, A, B, &R);
+            double err = 0.0;
+            for (int i = 0; i < R.rows; ++i)
+                for (int j = 0; j < R.cols; ++j) {
+                    const double d = fabs(MAT_AT(C, i, j) - MAT_AT(&R, i, j));
+                    if (!(d <= err)) err = d;
+                }
+            const double bound = tol * A->cols * max_abs(A) * max_abs(B);
+            printf(" | max abs error vs naive %.3e (bound %.1e)", err, bound);
+            ok = ok && err <= bound;
+        } else {
+            ok = 0;
+        }
+        matrix_free(&R);
+    }
+    printf(" | %s\n", ok ? "PASS" : "FAIL");
+    if (!ok) fprintf(stderr, "[ERROR] %s: result failed verification\n", kname);
+    return ok ? 0 : -1;
+}
+
+// fp32 or mixed-precision multiplies of float copies of the same random
+// inputs; rel_error is measured against the fp64 product of the originals
+static int run_precision_bench(const char *csv_path, int m, int k, int n, int runs, const char *precision,
+                               const int *thread_counts, int num_thread_counts) {
+    const int mixed = strcmp(precision, "mixed") == 0;
+    Matrix A = matrix_alloc(m, k);
+    Matrix B = matrix_alloc(k, n);
+    Matrix Cref = matrix_alloc(m, n);
+    Matrix Cd = matrix_alloc(m, n);   // mixed result, or the fp32 result widened for comparison
+    MatrixF Af = matrix_alloc_f(m, k);
+    MatrixF Bf = matrix_alloc_f(k, n);
+    MatrixF Cf = mixed ? (MatrixF) {0} : matrix_alloc_f(m, n);
+    int rc = 0;
+    if (!A.data || !B.data || !Cref.data || !Cd.data || !Af.data || !Bf.data || (!mixed && !Cf.data)) {
+        fprintf(stderr, "[ERROR] could not allocate %dx%dx%d matrices\n", m, k, n);
+        rc = 1;
+        goto done;
+    }
+    matrix_fill_random(&A);
+    matrix_fill_random(&B);
+    matrix_to_f(&A, &Af);
+    matrix_to_f(&B, &Bf);
+    matrix_multiply_simd(&A, &B, &Cref, NULL);
+
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", m, k, n);
+    const int size_equiv = (int) (cbrt((double) m * k * n) + 0.5);
+
+    printf("=========== C BENCHMARK (%s) ===========\n", precision);
+    printf("Matrix shape (MxKxN): %s | Runs: %d\n", shape, runs);
+    for (int ti = 0; ti < num_thread_counts; ++ti) {
+        const int threads = thread_counts[ti];
+        ThreadPool *pool = create_pool(threads);
+        if (!pool) {
+            fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+            rc = 1;
+            break;
+        }
+        printf("-----------------------------------\n");
+        printf("Kernel: simd | Precision: %s | Threads: %d\n", precision, threads);
+        double total = 0.0;
+        for (int r = 1; r <= runs; ++r) {
+            MemProbe probe;
+            mem_probe_start(&probe);
+            double t0 = now_seconds();
+            if (mixed) matrix_multiply_mixed(pool, &Af, &Bf, &Cd);
+            else matrix_multiply_f(pool, &Af, &Bf, &Cf);
+            double elapsed = now_seconds() - t0;
+            MemStats mem;
+            const double mem_used = mem_probe_stop(&probe, &mem);
+            total += elapsed;
+
+            if (!mixed) matrix_from_f(&Cf, &Cd);
+            const double err = relative_error(&Cd, &Cref);
+            BenchRow row = bench_row(size_equiv, r, elapsed, "simd", threads, shape);
+            row.mem_used_mb = mem_used;
+            row.rel_error = err;
+            row.precision = precision;
+            row.gflops = gflop_rate(1, m, k, n, elapsed);
+            row.mem = mem;
+            append_csv(csv_path, &row);
+            printf("Run %d: %.6f s | Memory used: %.3f MB | rel. error: %.3e\n", r, elapsed, mem_used, err);
+        }
+        printf("Average time (%s, %d threads): %.6f s\n", precision, threads, total / runs);
+        thread_pool_destroy(pool);
+    }
+    printf("===================================\n");
+
+done:
+    matrix_free(&A);
+    matrix_free(&B);
+    matrix_free(&Cref);
+    matrix_free(&Cd);
+    matrix_free_f(&Af);
+    matrix_free_f(&Bf);
+    matrix_free_f(&Cf);
+    return rc;
+}
+
+// Sparse A (each element non-zero with the given probability) times dense B,
+// through the dense simd kernel, CSR and 4x4 blocked CSR. The conversion from
+// the dense layout is timed once per density and logged as setup_sec; a
+// table at the end shows where the sparse kernels overtake the dense one.
+static int run_sparse_bench(const char *csv_path, int m, int k, int n, int runs, const double *densities,
+                            int num_densities, const int *thread_counts, int num_thread_counts) {
+    static const char *names[3] = { "dense-simd", "csr", "bsr-4" };
+    Matrix A = matrix_alloc(m, k);
+    Matrix B = matrix_alloc(k, n);
+    Matrix C = matrix_alloc(m, n);
+    Matrix Cref = matrix_alloc(m, n);
+    if (!A.data || !B.data || !C.data || !Cref.data) {
+        fprintf(stderr, "[ERROR] could not allocate %dx%dx%d matrices\n", m, k, n);
+        matrix_free(&A);
+        matrix_free(&B);
+        matrix_free(&C);
+        matrix_free(&Cref);
+        return 1;
+    }
+    matrix_fill_random(&B);
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", m, k, n);
+    const int size_equiv = (int) (cbrt((double) m * k * n) + 0.5);
+
+    printf("=========== C BENCHMARK (sparse A) ===========\n");
+    printf("Matrix shape (MxKxN): %s | Runs: %d\n", shape, runs);
+    double averages[16][16][3] = {{{0}}};   // [density][threads][kernel]
+    int rc = 0;
+    for (int di = 0; di < num_densities && rc == 0; ++di) {
+        const double density = densities[di];
+        matrix_fill_sparse_random(&A, density);
+        double t0 = now_seconds();
+        MatrixCsr csr = matrix_to_csr(&A);
+        const double csr_setup = now_seconds() - t0;
+        t0 = now_seconds();
+        MatrixBsr bsr = matrix_to_bsr(&A);
+        const double bsr_setup = now_seconds() - t0;
+        if (!csr.row_ptr || !bsr.row_ptr) {
+            fprintf(stderr, "[ERROR] could not convert A to CSR / BSR\n");
+            matrix_csr_free(&csr);
+            matrix_bsr_free(&bsr);
+            rc = 1;
+            break;
+        }
+        matrix_multiply_simd(&A, &B, &Cref, NULL);
+        const double block_fill = bsr.nblocks ? (double) csr.nnz / ((double) bsr.nblocks * MM_BSR_BLOCK * MM_BSR_BLOCK) : 0.0;
+        printf("-----------------------------------\n");
+        printf("Density: %.4f | nnz: %zu | 4x4 blocks: %zu (%.0f%% filled) | convert: csr %.6f s, bsr %.6f s\n",
+               density, csr.nnz, bsr.nblocks, 100.0 * block_fill, csr_setup, bsr_setup);
+
+        for (int ti = 0; ti < num_thread_counts && rc == 0; ++ti) {
+            const int threads = thread_counts[ti];
+            ThreadPool *pool = create_pool(threads);
+            if (!pool) {
+                fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+                rc = 1;
+                break;
+            }
+            for (int kind = 0; kind < 3; ++kind) {
+                double total = 0.0;
+                for (int r = 1; r <= runs; ++r) {
+                    MemProbe probe;
+                    mem_probe_start(&probe);
+                    double s0 = now_seconds();
+                    if (kind == 0) matrix_multiply_parallel(pool, MM_KERNEL_SIMD, &A, &B, &C);
+                    else if (kind == 1) matrix_multiply_csr(pool, &csr, &B, &C);
+                    else matrix_multiply_bsr(pool, &bsr, &B, &C);
+                    double elapsed = now_seconds() - s0;
+                    MemStats mem;
+                    const double mem_used = mem_probe_stop(&probe, &mem);
+                    total += elapsed;
+                    const double err = kind == 0 ? -1.0 : relative_error(&C, &Cref);
+                    const double setup = kind == 1 ? csr_setup : kind == 2 ? bsr_setup : 0.0;
+                    BenchRow row = bench_row(size_equiv, r, elapsed, names[kind], threads, shape);
+                    row.mem_used_mb = mem_used;
+                    row.setup_sec = setup;
+                    row.rel_error = err;
+                    row.density = density;
+                    row.gflops = gflop_rate(1, m, k, n, elapsed);
+                    row.mem = mem;
+                    append_csv(csv_path, &row);
+                }
+                averages[di][ti][kind] = total / runs;
+                printf("%-10s %2d threads: %.6f s avg\n", names[kind], threads, total / runs);
+            }
+            thread_pool_destroy(pool);
+        }
+        matrix_csr_free(&csr);
+        matrix_bsr_free(&bsr);
+    }
+    if (rc == 0) {
+        printf("=========== Speedup vs dense ===========\n");
+        for (int ti = 0; ti < num_thread_counts; ++ti)
+            for (int di = 0; di < num_densities; ++di) {
+                const double *avg = averages[di][ti];
+                printf("density %.4f, %2d threads: csr %.2fx, bsr-4 %.2fx\n", densities[di], thread_counts[ti],
+                       avg[1] > 0 ? avg[0] / avg[1] : 0.0, avg[2] > 0 ? avg[0] / avg[2] : 0.0);
+            }
+    }
+    printf("===================================\n");
+    matrix_free(&A);
+    matrix_free(&B);
+    matrix_free(&C);
+    matrix_free(&Cref);
+    return rc;
+}
+
+#ifdef MATMUL_CUDA
+// GPU backend: A and B are uploaded once (setup_sec) and stay resident, so a
+// run is the kernel alone (elapsed_sec) plus copying C back (transfer_sec)
+static int run_cuda_bench(const char *csv_path, int m, int k, int n, int runs, int verify) {
+    char device[256];
+    if (!matrix_cuda_available(device, sizeof(device))) {
+        fprintf(stderr, "[ERROR] no CUDA device found\n");
+        return 1;
+    }
+    Matrix A = matrix_alloc(m, k);
+    Matrix B = matrix_alloc(k, n);
+    Matrix C = matrix_alloc(m, n);
+    Matrix Cref = matrix_alloc(m, n);
+    MatrixDevice *dev = matrix_cuda_create(m, k, n);
+    double upload = 0.0;
+    int rc = 0;
+    if (!A.data || !B.data || !C.data || !Cref.data || !dev) {
+        fprintf(stderr, "[ERROR] could not allocate %dx%dx%d matrices on the %s\n", m, k, n, dev ? "host" : "device");
+        rc = 1;
+        goto done;
+    }
+    matrix_fill_random(&A);
+    matrix_fill_random(&B);
+    matrix_multiply_simd(&A, &B, &Cref, NULL);
+    if (matrix_cuda_upload(dev, &A, &B, &upload) != 0) {
+        fprintf(stderr, "[ERROR] host to device copy failed\n");
+        rc = 1;
+        goto done;
+    }
+
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", m, k, n);
+    const int size_equiv = (int) (cbrt((double) m * k * n) + 0.5);
+    printf("=========== C BENCHMARK (CUDA) ===========\n");
+    printf("Device: %s | Matrix shape (MxKxN): %s | Runs: %d\n", device, shape, runs);
+    printf("Upload A, B: %.6f s\n", upload);
+    double total = 0.0, total_copy = 0.0;
+    for (int r = 1; r <= runs; ++r) {
+        double elapsed = 0.0, copy = 0.0;
+        if (matrix_cuda_multiply(dev, &elapsed) != 0 || matrix_cuda_download(dev, &C, &copy) != 0) {
+            fprintf(stderr, "[ERROR] CUDA multiply failed\n");
+            rc = 1;
+            break;
+        }
+        total += elapsed;
+        total_copy += copy;
+        const double err = relative_error(&C, &Cref);
+        BenchRow row = bench_row(size_equiv, r, elapsed, "cuda-tiled", 1, shape);
+        row.setup_sec = upload;
+        row.rel_error = err;
+        row.transfer_sec = copy;
+        row.gflops = gflop_rate(1, m, k, n, elapsed);
+        append_csv(csv_path, &row);
+        printf("Run %d: kernel %.6f s | copy C back %.6f s | rel. error: %.3e\n", r, elapsed, copy, err);
+    }
+    if (rc == 0)
+        printf("Average: kernel %.6f s, transfer %.6f s\n", total / runs, total_copy / runs);
+    if (rc == 0 && verify && verify_product(&A, &B, &C, "cuda-tiled") != 0) rc = 1;
+    printf("===================================\n");
+
+done:
+    matrix_cuda_destroy(dev);
+    matrix_free(&A);
+    matrix_free(&B);
+    matrix_free(&C);
+    matrix_free(&Cref);
+    return rc;
+}
+#endif
+
+// Out-of-core multiply of two matrix files into a third; load_sec records how
+// long the multiply stalled waiting for panels, i.e. the I/O not hidden by compute
+static int run_ooc_bench(const char *csv_path, const char *a_path, const char *b_path, const char *c_path,
+                         size_t budget, int runs, const int *thread_counts, int num_thread_counts) {
+    MatrixFileHeader ha, hb;
+    const int a_ok = matrix_file_info(a_path, &ha) == 0, b_ok = matrix_file_info(b_path, &hb) == 0;
+    if (!a_ok || !b_ok) {
+        fprintf(stderr, "[ERROR] %s is not a matrix file\n", a_ok ? b_path : a_path);
+        return 1;
+    }
+    if (ha.cols != hb.rows) {
+        fprintf(stderr, "[ERROR] %s is %lldx%lld but %s is %lldx%lld\n", a_path, (long long) ha.rows,
+                (long long) ha.cols, b_path, (long long) hb.rows, (long long) hb.cols);
+        return 1;
+    }
+    const int m = (int) ha.rows, k = (int) ha.cols, n = (int) hb.cols;
+    char shape[64];
+    snprintf(shape, sizeof(shape), "%dx%dx%d", m, k, n);
+    const int size_equiv = (int) (cbrt((double) m * k * n) + 0.5);
+
+    printf("=========== C BENCHMARK (out-of-core) ===========\n");
+    printf("Matrix shape (MxKxN): %s | Runs: %d | Budget: %.1f MB\n", shape, runs, budget / (1024.0 * 1024.0));
+    int rc = 0;
+    for (int ti = 0; ti < num_thread_counts && rc == 0; ++ti) {
+        const int threads = thread_counts[ti];
+        ThreadPool *pool = create_pool(threads);
+        if (!pool) {
+            fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+            return 1;
+        }
+        printf("-----------------------------------\n");
+        printf("Kernel: ooc | Threads: %d\n", threads);
+        double total = 0.0;
+        for (int r = 1; r <= runs; ++r) {
+            MatrixOocStats st;
+            MemProbe probe;
+            mem_probe_start(&probe);
+            double t0 = now_seconds();
+            if (matrix_multiply_ooc(pool, a_path, b_path, c_path, budget, &st) != 0) {
+                fprintf(stderr, "[ERROR] out-of-core multiply failed (budget too small or I/O error)\n");
+                rc = 1;
+                break;
+            }
+            double elapsed = now_seconds() - t0;
+            total += elapsed;
+            BenchRow row = bench_row(size_equiv, r, elapsed, "ooc", threads, shape);
+            row.load_sec = st.wait_sec;
+            row.gflops = gflop_rate(1, m, k, n, elapsed);
+            row.mem_used_mb = mem_probe_stop(&probe, &row.mem);
+            append_csv(csv_path, &row);
+            printf("Run %d: %.6f s | read %.3f s, stalled %.3f s, write %.3f s | panels %dx%d\n", r, elapsed,
+                   st.read_sec, st.wait_sec, st.write_sec, st.panel_rows, st.panel_depth);
+        }
+        if (rc == 0) printf("Average time (ooc, %d threads): %.6f s\n", threads, total / runs);
+        thread_pool_destroy(pool);
+    }
+    printf("===================================\n");
+    return rc;
+}
+
+#ifdef MATMUL_MPI
+// Local block of a distributed matrix; empty blocks stay unallocated
+// This rank's rows x cols block at (row0, col0) of the global matrix drawn from
+// stream, so the product is the same whatever the grid
+static Matrix alloc_block(int rows, int cols, uint64_t stream, int row0, int col0) {
+    if (rows == 0 || cols == 0) return (Matrix) {0};
+    Matrix M = matrix_alloc(rows, cols);
+    matrix_fill_random_at(NULL, &M, stream, row0, col0);
+    return M;
+}
+
+// SUMMA on the first P ranks of MPI_COMM_WORLD for every P in rank_counts.
+// Strong scaling keeps the n x n problem; weak scaling grows it to
+// n * cbrt(P) so every rank does the flops of one n x n product. Rows record
+// the slowest rank's time; only world rank 0 prints and writes the CSV.
+static int run_summa_bench(int n, int runs, int weak, int panel, const int *rank_counts, int num_rank_counts,
+                           const int *thread_counts, int num_thread_counts) {
+    MPI_Init(NULL, NULL);
+    int world, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // every rank needs rank 0's seed to draw its block of the same matrices
+    uint64_t seed = matrix_get_seed();
+    MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    matrix_set_seed(seed);
+
+    char csv_path[1024];
+    if (rank == 0) {
+        resolve_csv_path(csv_path, sizeof(csv_path));
+        ensure_csv(csv_path);
+        printf("[INFO] CSV path: %s\n", csv_path);
+        printf("[INFO] Build: %s\n", MATMUL_BUILD_INFO);
+        printf("[INFO] Seed: %llu\n", (unsigned long long) seed);
+        printf("=========== C BENCHMARK (SUMMA, %s scaling) ===========\n", weak ? "weak" : "strong");
+        printf("Ranks available: %d | Runs: %d | Panel: %d\n", world, runs, panel > 0 ? panel : matrix_get_tiles().kc);
+    }
+    // default: 1, 2, 4, ... up to the whole job
+    int counts[32];
+    int num_counts = 0;
+    if (num_rank_counts > 0) {
+        for (int i = 0; i < num_rank_counts && num_counts < 32; ++i) counts[num_counts++] = rank_counts[i];
+    } else {
+        for (int p = 1; p < world && num_counts < 31; p *= 2) counts[num_counts++] = p;
+        counts[num_counts++] = world;
+    }
+
+    int rc = 0;
+    for (int ci = 0; ci < num_counts && rc == 0; ++ci) {
+        const int P = counts[ci];
+        if (P > world) {
+            if (rank == 0) printf("[WARN] skipping %d ranks: the job only has %d\n", P, world);
+            continue;
+        }
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < P ? 0 : MPI_UNDEFINED, rank, &sub);
+        if (sub != MPI_COMM_NULL) {
+            MatrixGrid grid;
+            matrix_grid_create(sub, 0, 0, &grid);
+            const int N = weak ? (int) (n * cbrt((double) P) + 0.5) : n;
+            int r0, rows, c0, cols, k0, acols, bk0, brows;
+            matrix_block_range(N, grid.rows, grid.row, &r0, &rows);
+            matrix_block_range(N, grid.cols, grid.col, &c0, &cols);
+            matrix_block_range(N, grid.cols, grid.col, &k0, &acols);
+            matrix_block_range(N, grid.rows, grid.row, &bk0, &brows);
+            Matrix A = alloc_block(rows, acols, 0, r0, k0), B = alloc_block(brows, cols, 1, bk0, c0);
+            Matrix C = alloc_block(rows, cols, 2, r0, c0);
+            char shape[64];
+            snprintf(shape, sizeof(shape), "%dx%dx%d", N, N, N);
+            if (rank == 0) {
+                printf("-----------------------------------\n");
+                printf("Ranks: %d (grid %dx%d) | Matrix: %s\n", P, grid.rows, grid.cols, shape);
+            }
+            for (int ti = 0; ti < num_thread_counts && rc == 0; ++ti) {
+                const int threads = thread_counts[ti];
+                ThreadPool *pool = thread_pool_create(threads);
+                // all ranks must agree before the collectives: one rank skipping the multiply hangs the rest
+                int pool_ok = pool != NULL, all_pools = 0;
+                MPI_Allreduce(&pool_ok, &all_pools, 1, MPI_INT, MPI_MIN, sub);
+                if (!all_pools) {
+                    if (rank == 0) fprintf(stderr, "[ERROR] could not start %d threads on every rank\n", threads);
+                    thread_pool_destroy(pool);
+                    rc = 1;
+                    break;
+                }
+                double total = 0.0;
+                for (int r = 1; r <= runs; ++r) {
+                    MatrixSummaStats st;
+                    const double mem_before = get_memory_used_mb();
+                    MPI_Barrier(sub);
+                    double t0 = now_seconds();
+                    const int ok = matrix_multiply_summa(&grid, pool, N, N, N, panel, &A, &B, &C, &st) == 0;
+                    double local[3] = { now_seconds() - t0, ok ? st.wait_sec : 0.0,
+                                        get_memory_used_mb() - mem_before };
+                    double worst[3];
+                    int all_ok = 0;
+                    MPI_Reduce(local, worst, 3, MPI_DOUBLE, MPI_MAX, 0, sub);
+                    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, sub);
+                    if (!all_ok) {
+                        if (rank == 0) fprintf(stderr, "[ERROR] SUMMA failed on %d ranks (out of memory?)\n", P);
+                        rc = 1;
+                        break;
+                    }
+                    if (rank == 0) {
+                        const double elapsed = worst[0];
+                        total += elapsed;
+                        BenchRow row = bench_row(N, r, elapsed, weak ? "summa-weak" : "summa", threads, shape);
+                        row.mem_used_mb = worst[2] > 0 ? worst[2] : 0.0;
+                        row.ranks = P;
+                        row.gflops = gflop_rate(1, N, N, N, elapsed);
+                        append_csv(csv_path, &row);
+                        printf("Run %d: %.6f s | %d threads/rank | broadcast wait %.6f s (%d panels)\n", r, elapsed,
+                               threads, worst[1], st.panels);
+                    }
+                }
+                if (rank == 0 && rc == 0)
+                    printf("Average time (%d ranks, %d threads): %.6f s\n", P, threads, total / runs);
+                thread_pool_destroy(pool);
+            }
+            matrix_free(&A);
+            matrix_free(&B);
+            matrix_free(&C);
+            matrix_grid_free(&grid);
+            MPI_Comm_free(&sub);
+        }
+        // ranks outside this count must not run ahead and return before the others
+        MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    if (rank == 0) printf("===================================\n");
+    MPI_Finalize();
+    return rc;
+}
+#endif
+
+// ---------- Tuning (--tune) ----------
+// Best-of-runs time of one tuning candidate. It is installed as a one-class
+// table and run through MM_KERNEL_AUTO, the path the saved table will take
+// (including the pool of e->threads it keeps).
+static double time_tune_entry(const MatrixTuneEntry *e, const Matrix *A, const Matrix *B, Matrix *C, int runs) {
+    MatrixTuneTable one;
+    memset(&one, 0, sizeof(one));
+    one.count = 1;
+    one.classes[0] = *e;
+    matrix_tune_set(&one);
+    matrix_multiply_parallel(NULL, MM_KERNEL_AUTO, A, B, C);   // untimed: warms the caches and pages in C
+    double best = -1.0;
+    for (int r = 0; r < runs; ++r) {
+        const double t0 = now_seconds();
+        matrix_multiply_parallel(NULL, MM_KERNEL_AUTO, A, B, C);
+        const double elapsed = now_seconds() - t0;
+        if (best < 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Times candidate e and makes it *best if it beats *best_time
+static void try_tune_entry(const MatrixTuneEntry *e, const Matrix *A, const Matrix *B, Matrix *C, int runs,
+                           MatrixTuneEntry *best, double *best_time) {
+    const double t = time_tune_entry(e, A, B, C, runs);
+    printf("Size %4d | %-8s | tiles %d,%d,%d | threads %2d | %.6f s\n", e->size, matrix_kernel_name(e->kernel),
+           e->tiles.mc, e->tiles.kc, e->tiles.nc, e->threads, t);
+    if (*best_time < 0 || t < *best_time) {
+        *best_time = t;
+        *best = *e;
+    }
+}
+
+static int compare_int(const void *a, const void *b) {
+    const int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+// Searches kernel, then tiles (one dimension at a time), then thread count for
+// every size class, keeping the fastest setting of each before moving to the
+// next, and saves the winners as this host's tuning table
+static int run_tune_bench(const char *path, int *sizes, int num_sizes, int runs, const int *thread_counts,
+                          int num_thread_counts) {
+    static const MatrixKernel candidates[] = { MM_KERNEL_PACKED, MM_KERNEL_BLOCKED, MM_KERNEL_FIXED,
+                                               MM_KERNEL_STRASSEN };
+    static const int grid[3][4] = { { 32, 64, 128, 256 }, { 64, 128, 256, 512 }, { 256, 512, 1024, 2048 } };
+    qsort(sizes, (size_t) num_sizes, sizeof(int), compare_int);
+    int widest = 0;
+    int rc = 0;
+    for (int ti = 0; ti < num_thread_counts; ++ti)
+        if (thread_counts[ti] > thread_counts[widest]) widest = ti;
+    MatrixTuneTable table;
+    memset(&table, 0, sizeof(table));
+    snprintf(table.cpu, sizeof(table.cpu), "%s", matrix_cpu_model());
+    printf("[INFO] Build: %s\n", MATMUL_BUILD_INFO);
+    printf("[INFO] Seed: %llu\n", (unsigned long long) matrix_get_seed());
+    printf("=========== C TUNING ===========\n");
+    printf("CPU: %s | best of %d runs per candidate\n", table.cpu, runs);
+    for (int si = 0; si < num_sizes && rc == 0; ++si) {
+        const int s = sizes[si];
+        if (si > 0 && s == sizes[si - 1]) continue;
+        if (table.count == MM_TUNE_MAX_CLASSES) {
+            printf("[WARN] a tuning table holds %d size classes; sizes from %d on are left out\n",
+                   MM_TUNE_MAX_CLASSES, s);
+            break;
+        }
+        Matrix A = matrix_alloc(s, s), B = matrix_alloc(s, s), C = matrix_alloc(s, s);
+        if (!A.data || !B.data || !C.data) {
+            fprintf(stderr, "[ERROR] could not allocate %d x %d matrices\n", s, s);
+            rc = 1;
+        } else {
+            matrix_fill_random(&A);
+            matrix_fill_random(&B);
+            printf("-----------------------------------\n");
+            const MatrixTuneEntry start = { s, MM_KERNEL_SIMD, matrix_get_tiles(), thread_counts[widest] };
+            MatrixTuneEntry best = start;
+            double best_time = -1.0;
+            try_tune_entry(&start, &A, &B, &C, runs, &best, &best_time);
+            // 1. kernel, on the default tiles and the widest pool
+            for (size_t ci = 0; ci < sizeof(candidates) / sizeof(candidates[0]); ++ci) {
+                MatrixTuneEntry e = best;
+                e.kernel = candidates[ci];
+                if (e.kernel == MM_KERNEL_FIXED && !matrix_fixed_supported(s, s, s)) continue;
+                if (e.kernel == MM_KERNEL_STRASSEN && s < 2 * matrix_get_strassen().cutoff) continue;
+                try_tune_entry(&e, &A, &B, &C, runs, &best, &best_time);
+            }
+            // 2. tiles, for the kernels that block by them
+            const int tiled = best.kernel == MM_KERNEL_SIMD || best.kernel == MM_KERNEL_PACKED ||
+                              best.kernel == MM_KERNEL_BLOCKED;
+            for (int d = 0; tiled && d < 3; ++d) {
+                for (int g = 0; g < 4; ++g) {
+                    MatrixTuneEntry e = best;
+                    int *dim = d == 0 ? &e.tiles.mc : d == 1 ? &e.tiles.kc : &e.tiles.nc;
+                    // a tile past the matrix edge behaves like one the size of the matrix
+                    if (*dim == grid[d][g] || (g > 0 && grid[d][g - 1] >= s)) continue;
+                    *dim = grid[d][g];
+                    try_tune_entry(&e, &A, &B, &C, runs, &best, &best_time);
+                }
+            }
+            // 3. thread count: small sizes often lose more to the fork/join than they gain
+            for (int ti = 0; ti < num_thread_counts; ++ti) {
+                if (ti == widest || thread_counts[ti] == thread_counts[widest]) continue;
+                MatrixTuneEntry e = best;
+                e.threads = thread_counts[ti];
+                try_tune_entry(&e, &A, &B, &C, runs, &best, &best_time);
+            }
+            printf("Best for %d: %s, tiles %d,%d,%d, %d threads (%.2f GFLOP/s)\n", s, matrix_kernel_name(best.kernel),
+                   best.tiles.mc, best.tiles.kc, best.tiles.nc, best.threads, gflop_rate(1, s, s, s, best_time));
+            table.classes[table.count++] = best;
+        }
+        matrix_free(&A);
+        matrix_free(&B);
+        matrix_free(&C);
+    }
+    printf("===================================\n");
+    if (rc != 0) {
+        matrix_tune_set(NULL);
+        return rc;
+    }
+    if (matrix_tune_save(path, &table) != 0) {
+        fprintf(stderr, "[ERROR] could not write the tuning table to %s\n", path);
+        matrix_tune_set(NULL);
+        return 1;
+    }
+    matrix_tune_set(&table);
+    printf("[INFO] Tuning table (%d size classes) saved to %s\n", table.count, path);
+    return 0;
+}
+
+// One multiply of the kernel loop, through the entry point the kernel needs:
+// BT is the transposed B, PB the packed B and scratch the Strassen arena
+static void multiply_once(MatrixKernel kernel, ThreadPool *pool, MatrixArena *scratch, const Matrix *A,
+                          const Matrix *B, const Matrix *BT, const MatrixPacked *PB, Matrix *C) {
+    if (kernel == MM_KERNEL_TRANSPOSED && pool) matrix_multiply_parallel_transposed(pool, A, BT, C);
+    else if (kernel == MM_KERNEL_TRANSPOSED) matrix_multiply_transposed(A, BT, C);
+    else if (kernel == MM_KERNEL_STRASSEN) matrix_multiply_strassen(pool, scratch, A, B, C);
+    else if (kernel == MM_KERNEL_PACKED) matrix_multiply_prepacked(pool, A, PB, C);
+    else if (pool) matrix_multiply_parallel(pool, kernel, A, B, C);
+    else matrix_multiply_with(kernel, A, B, C);
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s <matrix_size> <num_runs> [options]\n", prog);
+    printf("  --kernel K[,K...]   kernels to run:");
+    for (int k = 0; k < MM_KERNEL_COUNT; ++k) printf(" %s", matrix_kernel_name((MatrixKernel)k));
+    printf(" (default naive)\n");
+    printf("  --tiles MC,KC,NC    tile sizes for the blocked kernel\n");
+    printf("  --autotune          search tile sizes before timing\n");
+    printf("  --tune              search kernel, tiles and threads per size class (--sizes/--range, else\n");
+    printf("                      32, 64, ... up to n) and save this host's table for --kernel auto\n");
+    printf("  --shape MxKxN       multiply an MxK by a KxN matrix instead of n x n\n");
+    printf("  --sizes N[,N...]    sweep these square sizes in one process (<matrix_size> is ignored)\n");
+    printf("  --range LO:HI[:ST]  sweep LO..HI, doubling or stepping by ST (\"64\" adds, \"x4\" multiplies)\n");
+    printf("  --json PATH         also write every row to PATH as a JSON array (at exit)\n");
+    printf("  --threads T[,T...]  run through the thread pool with each thread count\n");
+    printf("                      (default: MATMUL_THREADS if set, else single-threaded)\n");
+    printf("  --seed S            seed of the random inputs (default: the current time, logged)\n");
+    printf("  --verify            check every kernel's result after its timed runs: Freivalds' O(n^2) test,\n");
+    printf("                      plus max abs error against the naive kernel up to n = %d\n", VERIFY_REFERENCE_MAX);
+    printf("  --perf              count cycles, instructions, L1D/LLC/dTLB misses per run (Linux perf events)\n");
+    printf("  --warmup W          untimed runs before the recorded ones (default 0)\n");
+    printf("  --target-ci PCT     after <num_runs>, repeat until the median's 95%% bootstrap CI is within\n");
+    printf("                      +/-PCT%% (capped by --max-runs, default 1000, and --time-budget SEC, default 60)\n");
+    printf("  --flush-cache       evict the caches before every run to time cold instead of hot runs\n");
+    printf("  --arena             allocate A, B and C from a matrix arena\n");
+    printf("  --huge-pages        back arena chunks with huge pages where possible\n");
+    printf("  --alloc-bench COUNT time allocating COUNT matrices per run (malloc vs arena) and exit\n");
+    printf("  --batch COUNT       multiply COUNT independent n x n pairs per run, report multiplies/s\n");
+    printf("  --pipeline COUNT    stream COUNT requests through the async executor vs blocking calls,\n");
+    printf("                      report requests/s and p50/p99 latency\n");
+    printf("  --inflight D        requests queued at once for --pipeline (default 2 x threads)\n");
+    printf("  --strassen-cutoff N stop the strassen recursion at N (default %d)\n", matrix_get_strassen().cutoff);
+    printf("  --strassen-base K   kernel for strassen's leaf products (default %s)\n",
+           matrix_kernel_name(matrix_get_strassen().base));
+    printf("  --precision P       fp64 (default), fp32, or mixed (float inputs, double accumulation)\n");
+    printf("  --load A,B          map A and B from matrix files instead of random fill (sets the shape)\n");
+    printf("  --save A,B          write the random inputs to matrix files for later --load runs\n");
+    printf("  --ooc A,B,C         multiply matrix files A and B into C, streaming panels from disk\n");
+    printf("  --mem-budget MB     panel memory for --ooc (default 1024)\n");
+    printf("  --summa strong|weak distributed SUMMA over MPI ranks (needs an mpicc -DMATMUL_MPI build)\n");
+    printf("  --ranks P[,P...]    rank counts for --summa (default 1, 2, 4, ... up to the job size)\n");
+    printf("  --panel NB          SUMMA broadcast panel width (default: the kc tile)\n");
+    printf("  --density D[,D...]  sparse A with this fraction of non-zeros: dense vs CSR vs BSR SpMM\n");
+    printf("  --backend B         cpu (default) or cuda (needs a -DMATMUL_CUDA build)\n");
+    printf("  --isa NAME          force the simd micro-kernel (scalar, neon, avx2, avx512)\n");
+    printf("  --affinity P        pin pool threads: none, compact (fill one NUMA node first) or scatter\n");
+    printf("                      (alternate nodes); default MATMUL_AFFINITY or none\n");
+}
+
+static int run_benchmark(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <matrix_size> <num_runs>\n", argv[0]);
+        print_usage(argv[0]);
         return 1;
     }
     int n = atoi(argv[1]);
     int runs = atoi(argv[2]);
-    srand((unsigned)time(NULL));
+    int m = n, k = n;   // C (m x n) = A (m x k) * B (k x n)
+    if (runs <= 0) {
+        fprintf(stderr, "[ERROR] <num_runs> must be positive\n");
+        return 1;
+    }
+    RunPolicy policy = { 0, runs, 1000, 0.0, 60.0, 0 };
+    int sizes[64];
+    int num_sizes = 0;   // > 0 for a --sizes / --range sweep
+
+    MatrixKernel kernels[MM_KERNEL_COUNT] = { MM_KERNEL_NAIVE };
+    int num_kernels = 1;
+    int autotune = 0;
+    int tune = 0;
+    int verify = 0;
+    int verify_failed = 0;
+    // a fresh seed per run unless --seed repeats one; it is logged either way
+    uint64_t seed = (uint64_t) time(NULL);
+    int thread_counts[16] = { 1 };
+    int num_thread_counts = 1;
+    int use_pool = 0;
+    int use_perf = 0;
+    int use_arena = 0;
+    int arena_flags = 0;
+    int alloc_bench = 0;
+    int batch = 0;
+    int pipeline = 0;
+    int inflight = 0;
+    const char *precision = "fp64";
+    char load_buf[1024], save_buf[1024];
+    const char *load_a = NULL, *load_b = NULL, *save_a = NULL, *save_b = NULL;
+    char ooc_buf[1024];
+    const char *ooc_a = NULL, *ooc_b = NULL, *ooc_c = NULL;
+    double mem_budget_mb = 1024.0;
+    const char *summa = NULL;   // "strong" or "weak"
+    int summa_panel = 0;
+    int rank_counts[16];
+    double densities[16];
+    const char *backend = "cpu";
+    int num_densities = 0;
+    int num_rank_counts = 0;
+    int kernel_given = 0;
+    pool_affinity = thread_pool_default_affinity();
+    const char *env_threads = getenv("MATMUL_THREADS");
+    if (env_threads && atoi(env_threads) > 0) {
+        thread_counts[0] = atoi(env_threads);
+        use_pool = 1;
+    }
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            num_kernels = parse_kernel_list(argv[++i], kernels, MM_KERNEL_COUNT);
+            if (num_kernels <= 0) return 1;
+            kernel_given = 1;
+        } else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+            MatrixTiles t;
+            if (sscanf(argv[++i], "%d,%d,%d", &t.mc, &t.kc, &t.nc) != 3) {
+                fprintf(stderr, "[ERROR] --tiles expects MC,KC,NC\n");
+                return 1;
+            }
+            matrix_set_tiles(t);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_thread_counts = parse_int_list(argv[++i], thread_counts, 16);
+            if (num_thread_counts <= 0) {
+                fprintf(stderr, "[ERROR] --threads expects positive counts, e.g. 1,2,4\n");
+                return 1;
+            }
+            use_pool = 1;
+        } else if ((strcmp(argv[i], "--sizes") == 0 || strcmp(argv[i], "--range") == 0) && i + 1 < argc) {
+            const int list = strcmp(argv[i], "--sizes") == 0;
+            num_sizes = list ? parse_int_list(argv[++i], sizes, 64) : parse_size_range(argv[++i], sizes, 64);
+            if (num_sizes <= 0) {
+                fprintf(stderr, list ? "[ERROR] --sizes expects positive sizes, e.g. 64,128,256\n"
+                                     : "[ERROR] --range expects LO:HI[:STEP], e.g. 64:1024 or 64:1024:64\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--shape") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%dx%d", &m, &k, &n) != 3 || m <= 0 || k <= 0 || n <= 0) {
+                fprintf(stderr, "[ERROR] --shape expects MxKxN, e.g. 1000x300x700\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = 1;
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            tune = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            char *end;
+            seed = (uint64_t) strtoull(argv[++i], &end, 0);
+            if (end == argv[i] || *end != '\0') {
+                fprintf(stderr, "[ERROR] --seed expects an unsigned integer\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = 1;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            use_perf = 1;
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            policy.warmup = atoi(argv[++i]);
+            if (policy.warmup < 0) {
+                fprintf(stderr, "[ERROR] --warmup expects a count of 0 or more\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--target-ci") == 0 && i + 1 < argc) {
+            policy.ci_target = atof(argv[++i]) / 100.0;
+            if (policy.ci_target <= 0) {
+                fprintf(stderr, "[ERROR] --target-ci expects a percentage, e.g. 2\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-runs") == 0 && i + 1 < argc) {
+            policy.max_runs = atoi(argv[++i]);
+            if (policy.max_runs <= 0) {
+                fprintf(stderr, "[ERROR] --max-runs expects a positive count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--time-budget") == 0 && i + 1 < argc) {
+            policy.time_budget = atof(argv[++i]);
+            if (policy.time_budget <= 0) {
+                fprintf(stderr, "[ERROR] --time-budget expects seconds\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--flush-cache") == 0) {
+            policy.flush_cache = 1;
+        } else if (strcmp(argv[i], "--arena") == 0) {
+            use_arena = 1;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            arena_flags |= MM_ARENA_HUGE_PAGES;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+            if (batch <= 0) {
+                fprintf(stderr, "[ERROR] --batch expects a positive count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline = atoi(argv[++i]);
+            if (pipeline <= 0) {
+                fprintf(stderr, "[ERROR] --pipeline expects a positive request count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--inflight") == 0 && i + 1 < argc) {
+            inflight = atoi(argv[++i]);
+            if (inflight <= 0) {
+                fprintf(stderr, "[ERROR] --inflight expects a positive count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--alloc-bench") == 0 && i + 1 < argc) {
+            alloc_bench = atoi(argv[++i]);
+            if (alloc_bench <= 0) {
+                fprintf(stderr, "[ERROR] --alloc-bench expects a positive count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--strassen-cutoff") == 0 && i + 1 < argc) {
+            MatrixStrassen st = matrix_get_strassen();
+            st.cutoff = atoi(argv[++i]);
+            if (st.cutoff < 2) {
+                fprintf(stderr, "[ERROR] --strassen-cutoff expects a size of at least 2\n");
+                return 1;
+            }
+            matrix_set_strassen(st);
+        } else if (strcmp(argv[i], "--strassen-base") == 0 && i + 1 < argc) {
+            MatrixStrassen st = matrix_get_strassen();
+            if (matrix_kernel_from_name(argv[++i], &st.base) != 0 || st.base == MM_KERNEL_STRASSEN ||
+                st.base == MM_KERNEL_AUTO) {
+                fprintf(stderr, "[ERROR] --strassen-base expects a classic kernel, e.g. simd or blocked\n");
+                return 1;
+            }
+            matrix_set_strassen(st);
+        } else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision = argv[++i];
+            if (strcmp(precision, "fp64") != 0 && strcmp(precision, "fp32") != 0 && strcmp(precision, "mixed") != 0) {
+                fprintf(stderr, "[ERROR] --precision expects fp64, fp32 or mixed\n");
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "--load") == 0 || strcmp(argv[i], "--save") == 0) && i + 1 < argc) {
+            const int load = strcmp(argv[i], "--load") == 0;
+            char *buf = load ? load_buf : save_buf;
+            snprintf(buf, sizeof(load_buf), "%s", argv[++i]);
+            char *comma = strchr(buf, ',');
+            if (!comma || comma == buf || comma[1] == '\0') {
+                fprintf(stderr, "[ERROR] %s expects A_FILE,B_FILE\n", argv[i - 1]);
+                return 1;
+            }
+            *comma = '\0';
+            if (load) {
+                load_a = buf;
+                load_b = comma + 1;
+            } else {
+                save_a = buf;
+                save_b = comma + 1;
+            }
+        } else if (strcmp(argv[i], "--ooc") == 0 && i + 1 < argc) {
+            snprintf(ooc_buf, sizeof(ooc_buf), "%s", argv[++i]);
+            char *c1 = strchr(ooc_buf, ',');
+            char *c2 = c1 ? strchr(c1 + 1, ',') : NULL;
+            if (!c2 || c1 == ooc_buf || c2 == c1 + 1 || c2[1] == '\0') {
+                fprintf(stderr, "[ERROR] --ooc expects A_FILE,B_FILE,C_FILE\n");
+                return 1;
+            }
+            *c1 = *c2 = '\0';
+            ooc_a = ooc_buf;
+            ooc_b = c1 + 1;
+            ooc_c = c2 + 1;
+        } else if (strcmp(argv[i], "--mem-budget") == 0 && i + 1 < argc) {
+            mem_budget_mb = atof(argv[++i]);
+            if (mem_budget_mb <= 0) {
+                fprintf(stderr, "[ERROR] --mem-budget expects a size in MB\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--summa") == 0 && i + 1 < argc) {
+            summa = argv[++i];
+            if (strcmp(summa, "strong") != 0 && strcmp(summa, "weak") != 0) {
+                fprintf(stderr, "[ERROR] --summa expects strong or weak\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ranks") == 0 && i + 1 < argc) {
+            num_rank_counts = parse_int_list(argv[++i], rank_counts, 16);
+            if (num_rank_counts <= 0) {
+                fprintf(stderr, "[ERROR] --ranks expects positive counts, e.g. 1,4,16\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--panel") == 0 && i + 1 < argc) {
+            summa_panel = atoi(argv[++i]);
+            if (summa_panel <= 0) {
+                fprintf(stderr, "[ERROR] --panel expects a positive width\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            num_densities = parse_fraction_list(argv[++i], densities, 16);
+            if (num_densities <= 0) {
+                fprintf(stderr, "[ERROR] --density expects fractions in (0, 1], e.g. 0.01,0.05,0.1\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            backend = argv[++i];
+            if (strcmp(backend, "cpu") != 0 && strcmp(backend, "cuda") != 0) {
+                fprintf(stderr, "[ERROR] --backend expects cpu or cuda\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--affinity") == 0 && i + 1 < argc) {
+            if (thread_pool_affinity_from_name(argv[++i], &pool_affinity) != 0) {
+                fprintf(stderr, "[ERROR] --affinity expects none, compact or scatter\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--isa") == 0 && i + 1 < argc) {
+            MatrixIsa isa;
+            if (matrix_isa_from_name(argv[++i], &isa) != 0 || matrix_simd_set_isa(isa) != 0) {
+                fprintf(stderr, "[ERROR] ISA '%s' is unknown or not supported on this CPU\n", argv[i]);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    matrix_set_seed(seed);
+    if (summa) {
+#ifdef MATMUL_MPI
+        // every rank runs this; MPI_Init happens inside so the other modes stay MPI-free
+        return run_summa_bench(n, runs, strcmp(summa, "weak") == 0, summa_panel, rank_counts, num_rank_counts, thread_counts,
+                               num_thread_counts);
+#else
+        fprintf(stderr, "[ERROR] --summa needs a build with mpicc -DMATMUL_MPI (see README)\n");
+        return 1;
+#endif
+    }
+    if (num_sizes > 0 && (load_a || save_a || alloc_bench || batch || pipeline || ooc_a || num_densities > 0 ||
+                          strcmp(backend, "cpu") != 0 || strcmp(precision, "fp64") != 0 || m != n || k != n)) {
+        fprintf(stderr, "[ERROR] --sizes/--range sweep square fp64 kernel runs only\n");
+        return 1;
+    }
+
+    if (tune) {
+        if (load_a || save_a || alloc_bench || batch || pipeline || ooc_a || num_densities > 0 ||
+            strcmp(backend, "cpu") != 0 || strcmp(precision, "fp64") != 0 || m != n || k != n) {
+            fprintf(stderr, "[ERROR] --tune times square fp64 products only\n");
+            return 1;
+        }
+        if (kernel_given) printf("[WARN] --kernel is ignored with --tune\n");
+        char tune_path[1024];
+        if (matrix_tune_default_path(tune_path, sizeof(tune_path)) != 0) {
+            fprintf(stderr, "[ERROR] no cache directory for the tuning table; set MATMUL_TUNE_FILE\n");
+            return 1;
+        }
+        if (num_sizes == 0) {
+            for (int s = 32; s < n && num_sizes < MM_TUNE_MAX_CLASSES - 1; s *= 2) sizes[num_sizes++] = s;
+            sizes[num_sizes++] = n;
+        }
+        // without --threads, weigh one thread against the whole machine
+        if (!use_pool) {
+            thread_counts[0] = 1;
+            thread_counts[1] = thread_pool_default_threads();
+            num_thread_counts = thread_counts[1] > 1 ? 2 : 1;
+        }
+        return run_tune_bench(tune_path, sizes, num_sizes, runs, thread_counts, num_thread_counts);
+    }
 
     char csv_path[1024];
     resolve_csv_path(csv_path, sizeof(csv_path));
     ensure_csv(csv_path);
     printf("[INFO] CSV path: %s\n", csv_path);
+    printf("[INFO] Build: %s\n", MATMUL_BUILD_INFO);
+    printf("[INFO] Seed: %llu (repeat the inputs with --seed)\n", (unsigned long long) seed);
 
-    // build matrices once (como en Java/Python)
-    double **A = allocate_matrix(n);
-    double **B = allocate_matrix(n);
-    double **C = allocate_matrix(n);
-    fill_random(A, n);
-    fill_random(B, n);
+    if (alloc_bench) {
+        run_alloc_bench(csv_path, n, alloc_bench, runs, arena_flags);
+        return 0;
+    }
 
-    printf("=========== C BENCHMARK ===========\n");
-    printf("Matrix size: %dx%d | Runs: %d\n", n, n, runs);
-    printf("-----------------------------------\n");
+    if (batch) {
+        return run_batch_bench(csv_path, n, batch, runs, thread_counts, num_thread_counts, arena_flags);
+    }
 
-    double total = 0.0;
-    for (int r = 1; r <= runs; ++r) {
-        long mem_before = get_memory_used_mb();
-        double t0 = now_seconds();
-        matrix_multiply(A, B, C, n);
-        double t1 = now_seconds();
-        long mem_after = get_memory_used_mb();
+    if (pipeline) {
+        int max_threads = 1;
+        for (int t = 0; t < num_thread_counts; ++t)
+            if (thread_counts[t] > max_threads) max_threads = thread_counts[t];
+        return run_pipeline_bench(csv_path, n, pipeline, runs, inflight > 0 ? inflight : 2 * max_threads,
+                                  kernel_given ? kernels[0] : MM_KERNEL_SIMD, thread_counts, num_thread_counts);
+    }
+
+    if (strcmp(backend, "cuda") == 0) {
+#ifdef MATMUL_CUDA
+        if (strcmp(precision, "fp64") != 0 || load_a || save_a || ooc_a || num_densities > 0) {
+            fprintf(stderr, "[ERROR] --backend cuda runs fp64 random inputs only\n");
+            return 1;
+        }
+        if (kernel_given || use_pool) printf("[WARN] --kernel and --threads are ignored with --backend cuda\n");
+        csv_language = "C-CUDA";
+        return run_cuda_bench(csv_path, m, k, n, runs, verify);
+#else
+        fprintf(stderr, "[ERROR] --backend cuda needs a build with -DMATMUL_CUDA (see README)\n");
+        return 1;
+#endif
+    }
 
-        double elapsed = t1 - t0;
-        long mem_used = mem_after - mem_before;
-        if (mem_used < 0) mem_used = 0;
+    if (num_densities > 0) {
+        if (strcmp(precision, "fp64") != 0 || load_a || save_a) {
+            fprintf(stderr, "[ERROR] --density generates fp64 inputs and takes no --load/--save\n");
+            return 1;
+        }
+        if (kernel_given) printf("[WARN] --kernel is ignored with --density\n");
+        return run_sparse_bench(csv_path, m, k, n, runs, densities, num_densities, thread_counts, num_thread_counts);
+    }
 
-        total += elapsed;
-        append_csv(csv_path, n, r, elapsed, mem_used);
-        printf("Run %d: %.6f s | Memory used: %ld MB\n", r, elapsed, mem_used);
+    if (ooc_a) {
+        if (strcmp(precision, "fp64") != 0 || load_a || save_a) {
+            fprintf(stderr, "[ERROR] --ooc takes fp64 files and no --load/--save\n");
+            return 1;
+        }
+        if (kernel_given) printf("[WARN] --kernel is ignored with --ooc\n");
+        return run_ooc_bench(csv_path, ooc_a, ooc_b, ooc_c, (size_t) (mem_budget_mb * 1024.0 * 1024.0), runs,
+                             thread_counts, num_thread_counts);
     }
 
-    printf("-----------------------------------\n");
-    printf("Average time: %.6f s\n", total / runs);
-    printf("===================================\n");
+    if (strcmp(precision, "fp64") != 0) {
+        if (load_a || save_a) {
+            fprintf(stderr, "[ERROR] --load/--save only apply to fp64 runs\n");
+            return 1;
+        }
+        if (kernel_given) printf("[WARN] --kernel is ignored with --precision %s\n", precision);
+        return run_precision_bench(csv_path, m, k, n, runs, precision, thread_counts, num_thread_counts);
+    }
 
-    free_matrix(A, n);
-    free_matrix(B, n);
-    free_matrix(C, n);
-    return 0;
+    // a sweep runs every size in this process from one arena sized for the
+    // largest, reset between sizes, and writes its rows once at the end
+    size_t arena_chunk = 0;
+    if (num_sizes > 0) {
+        int largest = 0;
+        for (int si = 0; si < num_sizes; ++si)
+            if (sizes[si] > largest) largest = sizes[si];
+        const size_t ld = ((size_t) largest + 7) / 8 * 8;
+        arena_chunk = 3 * ((size_t) largest * ld * sizeof(double) + MATRIX_ALIGN);
+        use_arena = 1;
+        defer_csv = 1;
+        n = largest;
+    } else {
+        sizes[num_sizes++] = n;
+    }
+    if (autotune) {
+        printf("[INFO] Autotuning tile sizes...\n");
+        matrix_autotune_tiles(n < 512 ? n : 512);
+    }
+    MatrixTiles tiles = matrix_get_tiles();
+
+    // build matrices once (como en Java/Python)
+    MatrixArena *arena = use_arena ? matrix_arena_create(arena_chunk, arena_flags) : NULL;
+    if (use_arena && !arena) {
+        fprintf(stderr, "[ERROR] could not create matrix arena\n");
+        return 1;
+    }
+    if (policy.max_runs < runs) policy.max_runs = runs;
+    double *times = (double*) malloc((size_t) policy.max_runs * sizeof(double));
+    if (!times) {
+        fprintf(stderr, "[ERROR] could not allocate run times\n");
+        return 1;
+    }
+    for (int si = 0; si < num_sizes; ++si) {
+        if (num_sizes > 1) {
+            m = k = n = sizes[si];
+            matrix_arena_reset(arena);
+        }
+        // --load maps the inputs straight from disk; the shape comes from the files
+        double load_sec = 0.0;
+        Matrix A, B;
+        if (load_a) {
+            double l0 = now_seconds();
+            A = matrix_map(load_a, MM_MAP_POPULATE);
+            B = matrix_map(load_b, MM_MAP_POPULATE);
+            load_sec = now_seconds() - l0;
+            if (!A.data || !B.data) {
+                fprintf(stderr, "[ERROR] could not map %s (not a float64 matrix file?)\n", A.data ? load_b : load_a);
+                return 1;
+            }
+            if (A.cols != B.rows) {
+                fprintf(stderr, "[ERROR] %s is %dx%d but %s is %dx%d\n", load_a, A.rows, A.cols, load_b, B.rows,
+                        B.cols);
+                return 1;
+            }
+            m = A.rows;
+            k = A.cols;
+            n = B.cols;
+            printf("[INFO] Mapped %s and %s in %.6f s\n", load_a, load_b, load_sec);
+        } else {
+            A = arena ? matrix_arena_alloc(arena, m, k) : matrix_alloc(m, k);
+            B = arena ? matrix_arena_alloc(arena, k, n) : matrix_alloc(k, n);
+        }
+        Matrix C = arena ? matrix_arena_alloc(arena, m, n) : matrix_alloc(m, n);
+        if (!A.data || !B.data || !C.data) {
+            fprintf(stderr, "[ERROR] could not allocate %dx%dx%d matrices\n", m, k, n);
+            return 1;
+        }
+        // rectangular runs are logged under the square size with the same flop count
+        char shape[64];
+        snprintf(shape, sizeof(shape), "%dx%dx%d", m, k, n);
+        const int size_equiv = (int) (cbrt((double) m * k * n) + 0.5);
+        if (!load_a) {
+            // first touch from the workers, so each page lands on the NUMA node
+            // of the thread that computes its rows rather than the main thread's;
+            // the same workers then fill, with values independent of their number
+            ThreadPool *filler = NULL;
+            if (use_pool) {
+                int max_threads = 1;
+                for (int t = 0; t < num_thread_counts; ++t)
+                    if (thread_counts[t] > max_threads) max_threads = thread_counts[t];
+                filler = thread_pool_create_pinned(max_threads, pool_affinity);
+            }
+            if (filler && !arena) {
+                matrix_first_touch(filler, &A);
+                matrix_first_touch(filler, &B);
+                matrix_first_touch(filler, &C);
+            }
+            const double f0 = now_seconds();
+            // streams fixed by the shape: --verify or an earlier size does not shift them
+            matrix_fill_random_at(filler, &A, matrix_input_stream(m, k, n, 0), 0, 0);
+            matrix_fill_random_at(filler, &B, matrix_input_stream(m, k, n, 1), 0, 0);
+            printf("[INFO] Filled A and B in %.6f s (%d threads)\n", now_seconds() - f0,
+                   filler ? thread_pool_size(filler) : 1);
+            thread_pool_destroy(filler);
+        }
+        log_page_nodes("A", &A);
+        log_page_nodes("C", &C);
+        if (save_a) {
+            if (matrix_save(save_a, &A) != 0 || matrix_save(save_b, &B) != 0) {
+                fprintf(stderr, "[ERROR] could not write %s / %s\n", save_a, save_b);
+                return 1;
+            }
+            printf("[INFO] Saved inputs to %s and %s\n", save_a, save_b);
+        }
+
+        // Strassen trades accuracy for flops: every row of such a run records how
+        // far its result is from the classic kernel's
+        Matrix Cref = {0};
+        for (int ki = 0; ki < num_kernels; ++ki) {
+            if (kernels[ki] != MM_KERNEL_STRASSEN || Cref.data) continue;
+            Cref = matrix_alloc(m, n);
+            if (!Cref.data) {
+                fprintf(stderr, "[ERROR] could not allocate the reference result\n");
+                return 1;
+            }
+            matrix_multiply_simd(&A, &B, &Cref, NULL);
+        }
+
+        printf("=========== C BENCHMARK ===========\n");
+        printf("Matrix shape (MxKxN): %s | Runs: %d\n", shape, runs);
+        if (arena)
+            printf("Arena: %.1f MB | huge pages: %s\n", matrix_arena_capacity(arena) / (1024.0 * 1024.0),
+                   matrix_arena_huge_pages(arena) ? "yes" : "no");
+        printf("Tiles (mc,kc,nc): %d,%d,%d | SIMD: %s\n", tiles.mc, tiles.kc, tiles.nc,
+               matrix_isa_name(matrix_simd_isa()));
+
+        if (policy.warmup > 0) printf("Warmup runs: %d (not recorded)\n", policy.warmup);
+        if (policy.ci_target > 0)
+            printf("Repeat: until the median's 95%% CI is within +/-%.1f%% (%d..%d runs, %.0f s budget)\n",
+                   policy.ci_target * 100.0, runs, policy.max_runs, policy.time_budget);
+        printf("Cache: %s\n", policy.flush_cache ? "cold (flushed before every run)" : "hot");
+        for (int ki = 0; ki < num_kernels; ++ki) {
+            if (kernels[ki] != MM_KERNEL_AUTO) continue;
+            const MatrixTuneEntry e = matrix_tune_choice(m, k, n);
+            printf("[INFO] auto: %s | %s, tiles %d,%d,%d, %d threads\n",
+                   matrix_tune_active() ? "tuning table" : "no tuning table, built-in choice",
+                   matrix_kernel_name(e.kernel), e.tiles.mc, e.tiles.kc, e.tiles.nc, e.threads);
+            break;
+        }
+
+        double averages[16][MM_KERNEL_COUNT] = {{0}};
+        int ran_threads[16][MM_KERNEL_COUNT] = {{0}};
+        char knames[MM_KERNEL_COUNT][64];
+        for (int ti = 0; ti < num_thread_counts; ++ti) {
+            // the pool is created once per thread count and reused by every run
+            const int threads = thread_counts[ti];
+            ThreadPool *pool = NULL;
+            if (use_pool) {
+                pool = create_pool(threads);
+                if (!pool) {
+                    fprintf(stderr, "[ERROR] could not start %d threads\n", threads);
+                    return 1;
+                }
+            }
+            PerfCounters *perf = use_perf ? perf_open(pool) : NULL;
+            if (use_perf && !perf && ti == 0)
+                printf("[WARN] perf_event_open refused every counter (no PMU access, or perf_event_paranoid too "
+                       "high)\n");
+            for (int ki = 0; ki < num_kernels; ++ki) {
+                MatrixKernel kernel = kernels[ki];
+                // SIMD rows record the micro-kernel that actually ran, e.g. "simd-avx2"
+                char kname[64];
+                if (kernel == MM_KERNEL_SIMD)
+                    snprintf(kname, sizeof(kname), "simd-%s", matrix_isa_name(matrix_simd_isa()));
+                else if (kernel == MM_KERNEL_PACKED)
+                    snprintf(kname, sizeof(kname), "packed-%s", matrix_isa_name(matrix_simd_isa()));
+                else if (kernel == MM_KERNEL_FIXED && matrix_fixed_supported(m, k, n))
+                    snprintf(kname, sizeof(kname), "fixed-%d", n);
+                else if (kernel == MM_KERNEL_FIXED)   // no specialization for this shape
+                    snprintf(kname, sizeof(kname), "fixed-simd-%s", matrix_isa_name(matrix_simd_isa()));
+                else if (kernel == MM_KERNEL_AUTO)   // the kernel the tuning table picked
+                    snprintf(kname, sizeof(kname), "auto-%s", matrix_kernel_name(matrix_tune_choice(m, k, n).kernel));
+                else
+                    snprintf(kname, sizeof(kname), "%s", matrix_kernel_name(kernel));
+                // auto runs on the table's thread count, not on this sweep's pool
+                const int run_threads = kernel == MM_KERNEL_AUTO ? matrix_tune_choice(m, k, n).threads : threads;
+                printf("-----------------------------------\n");
+                printf("Kernel: %s | Threads: %d\n", kname, run_threads);
+
+                // one-time preparation that is not part of the multiply itself
+                double setup = 0.0;
+                Matrix BT = {0};
+                if (kernel == MM_KERNEL_TRANSPOSED) {
+                    BT = matrix_alloc(B.cols, B.rows);
+                    if (!BT.data) {
+                        fprintf(stderr, "[ERROR] could not allocate transpose buffer\n");
+                        return 1;
+                    }
+                    double s0 = now_seconds();
+                    matrix_transpose(&B, &BT);
+                    setup = now_seconds() - s0;
+                    printf("Transpose (one-time): %.6f s\n", setup);
+                }
+                // B is packed once and every run reuses it, as a caller multiplying
+                // many left-hand sides by the same B would
+                MatrixPacked PB = {0};
+                if (kernel == MM_KERNEL_PACKED) {
+                    double s0 = now_seconds();
+                    PB = matrix_pack_b(&B, NULL);
+                    setup = now_seconds() - s0;
+                    if (!PB.data) {
+                        fprintf(stderr, "[ERROR] could not allocate packed B\n");
+                        return 1;
+                    }
+                    printf("Pack B (one-time): %.6f s\n", setup);
+                }
+                // Strassen temporaries come from one arena that every run reuses
+                MatrixArena *scratch = NULL;
+                if (kernel == MM_KERNEL_STRASSEN) {
+                    const MatrixStrassen st = matrix_get_strassen();
+                    const size_t bytes = matrix_strassen_scratch_bytes(m, k, n);
+                    scratch = arena ? arena : matrix_arena_create(bytes ? bytes : MATRIX_ALIGN, arena_flags);
+                    if (!scratch) {
+                        fprintf(stderr, "[ERROR] could not create Strassen scratch arena\n");
+                        return 1;
+                    }
+                    printf("Strassen cutoff: %d | base: %s | scratch: %.1f MB\n", st.cutoff,
+                           matrix_kernel_name(st.base), bytes / (1024.0 * 1024.0));
+                }
+
+                double total = 0.0;
+                int done = 0;
+                // r <= 0 are the warmup runs: same work, neither recorded nor logged
+                for (int r = 1 - policy.warmup; r <= 0 || need_more_runs(&policy, times, done, total); ++r) {
+                    if (policy.flush_cache) flush_caches(pool);
+                    if (r <= 0) {
+                        multiply_once(kernel, pool, scratch, &A, &B, &BT, &PB, &C);
+                        continue;
+                    }
+                    MemProbe probe;
+                    mem_probe_start(&probe);
+                    double counters[PERF_EVENT_COUNT];
+                    perf_start(perf);
+                    double t0 = now_seconds();
+                    multiply_once(kernel, pool, scratch, &A, &B, &BT, &PB, &C);
+                    double t1 = now_seconds();
+                    perf_stop(perf, counters);
+                    MemStats mem;
+                    const double mem_used = mem_probe_stop(&probe, &mem);
+
+                    double elapsed = t1 - t0;
+
+                    total += elapsed;
+                    times[done++] = elapsed;
+                    const double err = Cref.data ? relative_error(&C, &Cref) : -1.0;
+                    BenchRow row = bench_row(size_equiv, r, elapsed, kname, run_threads, shape);
+                    row.mem_used_mb = mem_used;
+                    row.setup_sec = setup;
+                    row.rel_error = err;
+                    row.load_sec = load_sec;
+                    row.gflops = gflop_rate(1, m, k, n, elapsed);
+                    memcpy(row.perf, counters, sizeof(row.perf));
+                    row.mem = mem;
+                    row.cache = policy.flush_cache ? "cold" : "hot";
+                    append_csv(csv_path, &row);
+                    printf("Run %d: %.6f s | %.2f GFLOP/s | Memory used: %.3f MB", r, elapsed, row.gflops, mem_used);
+                    if (mem.alloc_peak_bytes > 0)
+                        printf(" | allocated %.3f MB", mem.alloc_peak_bytes / (1024.0 * 1024.0));
+                    if (mem.peak_rss_mb >= 0) printf(" | peak RSS %.1f MB", mem.peak_rss_mb);
+                    if (mem.minor_faults >= 0)
+                        printf(" | faults %.0f", mem.minor_faults + (mem.major_faults > 0 ? mem.major_faults : 0));
+                    if (err >= 0) printf(" | rel. error: %.3e", err);
+                    if (counters[PERF_CYCLES] > 0 && counters[PERF_INSTRUCTIONS] >= 0)
+                        printf(" | IPC %.2f", counters[PERF_INSTRUCTIONS] / counters[PERF_CYCLES]);
+                    if (counters[PERF_LLC_MISSES] >= 0) printf(" | LLC misses %.3g", counters[PERF_LLC_MISSES]);
+                    printf("\n");
+                }
+                averages[ti][ki] = total / done;
+                ran_threads[ti][ki] = run_threads;
+                snprintf(knames[ki], sizeof(knames[ki]), "%s", kname);
+                printf("Average time (%s, %d threads): %.6f s", kname, run_threads, total / done);
+                if (pool && kernel != MM_KERNEL_AUTO) printf(" | steals so far: %ld", thread_pool_steals(pool));
+                printf("\n");
+                double ci_lo, ci_hi;
+                bootstrap_median_ci(times, done, &ci_lo, &ci_hi);
+                const double p95 = percentile(times, done, 95.0);
+                printf("Median %.6f s | p95 %.6f s | 95%% CI of median [%.6f, %.6f] | %d runs",
+                       percentile(times, done, 50.0), p95, ci_lo, ci_hi, done);
+                if (policy.ci_target > 0 && median_ci_width(times, done) > policy.ci_target)
+                    printf(" (CI target not reached)");
+                printf("\n");
+                // C still holds the last run's product; checking it is not timed
+                if (verify && verify_product(&A, &B, &C, kname) != 0) verify_failed = 1;
+                matrix_free(&BT);
+                matrix_packed_free(&PB);
+                if (scratch != arena) matrix_arena_destroy(scratch);
+            }
+            perf_close(perf);
+            thread_pool_destroy(pool);
+        }
+        printf("===================================\n");
+
+        // e.g. --kernel simd,fixed puts the generic and the size-specialized kernel next to each other
+        if (num_kernels > 1) {
+            printf("Summary (speedup vs %s):\n", knames[0]);
+            for (int ti = 0; ti < num_thread_counts; ++ti)
+                for (int ki = 0; ki < num_kernels; ++ki)
+                    printf("  %-20s | threads %2d | %12.3f us | x%.2f\n", knames[ki], ran_threads[ti][ki],
+                           averages[ti][ki] * 1e6, averages[ti][ki] > 0 ? averages[ti][0] / averages[ti][ki] : 0.0);
+        }
+
+        matrix_free(&A);
+        matrix_free(&B);
+        matrix_free(&C);
+        matrix_free(&Cref);
+    }
+    if (num_sizes > 1) printf("[INFO] Sweep of %d sizes done, writing %s\n", num_sizes, csv_path);
+    matrix_arena_destroy(arena);
+    free(times);
+    free((void*) cache_flush.buf);
+    return verify_failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const int rc = run_benchmark(argc, argv);
+    flush_results();
+    return rc;
 }
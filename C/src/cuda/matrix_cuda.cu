@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <cuda_runtime.h>
+
+#include "matrix_cuda.h"
+
+// Block tile of C and depth of one shared-memory stage. A 16 x 16 thread
+// block computes BM x BN outputs, TM x TN per thread in registers.
+#define BM 64
+#define BN 64
+#define BK 16
+#define THREADS_X 16
+#define THREADS_Y 16
+#define TM (BM / THREADS_Y)
+#define TN (BN / THREADS_X)
+
+struct MatrixDevice {
+    int m, k, n;
+    double *A, *B, *C;
+    size_t lda, ldb, ldc;   // pitches in elements (cudaMallocPitch)
+    cudaEvent_t start, stop;
+};
+
+// C = A * B. Each stage stages a BM x BK slice of A (transposed, so the
+// inner loop reads consecutive rows) and a BK x BN slice of B in shared
+// memory; edges are zero-filled, so any m, n, k works.
+static __global__ void dgemm_tiled(int m, int n, int k, const double *__restrict__ A, size_t lda,
+                                   const double *__restrict__ B, size_t ldb, double *__restrict__ C, size_t ldc) {
+    __shared__ double As[BK][BM + 1];   // +1 avoids bank conflicts on the transposed store
+    __shared__ double Bs[BK][BN];
+    const int tx = threadIdx.x, ty = threadIdx.y;
+    const int tid = ty * THREADS_X + tx;
+    const int row0 = blockIdx.y * BM, col0 = blockIdx.x * BN;
+
+    double acc[TM][TN];
+    for (int r = 0; r < TM; r++)
+        for (int c = 0; c < TN; c++) acc[r][c] = 0.0;
+
+    for (int p0 = 0; p0 < k; p0 += BK) {
+        for (int e = tid; e < BM * BK; e += THREADS_X * THREADS_Y) {
+            const int i = e / BK, p = e % BK;
+            const int gi = row0 + i, gp = p0 + p;
+            As[p][i] = (gi < m && gp < k) ? A[(size_t) gi * lda + gp] : 0.0;
+        }
+        for (int e = tid; e < BK * BN; e += THREADS_X * THREADS_Y) {
+            const int p = e / BN, j = e % BN;
+            const int gp = p0 + p, gj = col0 + j;
+            Bs[p][j] = (gp < k && gj < n) ? B[(size_t) gp * ldb + gj] : 0.0;
+        }
+        __syncthreads();
+#pragma unroll
+        for (int p = 0; p < BK; p++) {
+            double a[TM], b[TN];
+#pragma unroll
+            for (int r = 0; r < TM; r++) a[r] = As[p][ty + THREADS_Y * r];
+#pragma unroll
+            for (int c = 0; c < TN; c++) b[c] = Bs[p][tx + THREADS_X * c];
+#pragma unroll
+            for (int r = 0; r < TM; r++)
+#pragma unroll
+                for (int c = 0; c < TN; c++) acc[r][c] += a[r] * b[c];
+        }
+        __syncthreads();
+    }
+
+    for (int r = 0; r < TM; r++) {
+        const int gi = row0 + ty + THREADS_Y * r;
+        if (gi >= m) continue;
+        for (int c = 0; c < TN; c++) {
+            const int gj = col0 + tx + THREADS_X * c;
+            if (gj < n) C[(size_t) gi * ldc + gj] = acc[r][c];
+        }
+    }
+}
+
+int matrix_cuda_available(char *name, size_t name_size) {
+    int count = 0;
+    if (cudaGetDeviceCount(&count) != cudaSuccess || count == 0) return 0;
+    if (name && name_size > 0) {
+        cudaDeviceProp prop;
+        if (cudaGetDeviceProperties(&prop, 0) == cudaSuccess) {
+            strncpy(name, prop.name, name_size - 1);
+            name[name_size - 1] = '\0';
+        } else {
+            name[0] = '\0';
+        }
+    }
+    return 1;
+}
+
+MatrixDevice *matrix_cuda_create(int m, int k, int n) {
+    if (m <= 0 || k <= 0 || n <= 0 || !matrix_cuda_available(NULL, 0)) return NULL;
+    MatrixDevice *dev = (MatrixDevice*) calloc(1, sizeof(MatrixDevice));
+    if (!dev) return NULL;
+    dev->m = m;
+    dev->k = k;
+    dev->n = n;
+    size_t pa = 0, pb = 0, pc = 0;
+    int ok = cudaMallocPitch((void**) &dev->A, &pa, (size_t) k * sizeof(double), (size_t) m) == cudaSuccess &&
+             cudaMallocPitch((void**) &dev->B, &pb, (size_t) n * sizeof(double), (size_t) k) == cudaSuccess &&
+             cudaMallocPitch((void**) &dev->C, &pc, (size_t) n * sizeof(double), (size_t) m) == cudaSuccess &&
+             cudaEventCreate(&dev->start) == cudaSuccess && cudaEventCreate(&dev->stop) == cudaSuccess;
+    dev->lda = pa / sizeof(double);
+    dev->ldb = pb / sizeof(double);
+    dev->ldc = pc / sizeof(double);
+    if (!ok) {
+        matrix_cuda_destroy(dev);
+        return NULL;
+    }
+    return dev;
+}
+
+void matrix_cuda_destroy(MatrixDevice *dev) {
+    if (!dev) return;
+    cudaFree(dev->A);
+    cudaFree(dev->B);
+    cudaFree(dev->C);
+    if (dev->start) cudaEventDestroy(dev->start);
+    if (dev->stop) cudaEventDestroy(dev->stop);
+    free(dev);
+}
+
+// Elapsed time between the two events recorded around an operation
+static int event_seconds(MatrixDevice *dev, double *sec) {
+    float ms = 0.0f;
+    if (cudaEventSynchronize(dev->stop) != cudaSuccess || cudaEventElapsedTime(&ms, dev->start, dev->stop) != cudaSuccess)
+        return -1;
+    if (sec) *sec = ms * 1e-3;
+    return 0;
+}
+
+int matrix_cuda_upload(MatrixDevice *dev, const Matrix *A, const Matrix *B, double *sec) {
+    if (!A->data || !B->data || A->rows != dev->m || A->cols != dev->k || B->rows != dev->k || B->cols != dev->n)
+        return -1;
+    cudaEventRecord(dev->start);
+    // host rows are padded to ld; cudaMemcpy2D handles both pitches in one call
+    int ok = cudaMemcpy2D(dev->A, dev->lda * sizeof(double), A->data, (size_t) A->ld * sizeof(double),
+                          (size_t) dev->k * sizeof(double), (size_t) dev->m, cudaMemcpyHostToDevice) == cudaSuccess &&
+             cudaMemcpy2D(dev->B, dev->ldb * sizeof(double), B->data, (size_t) B->ld * sizeof(double),
+                          (size_t) dev->n * sizeof(double), (size_t) dev->k, cudaMemcpyHostToDevice) == cudaSuccess;
+    cudaEventRecord(dev->stop);
+    return ok ? event_seconds(dev, sec) : -1;
+}
+
+int matrix_cuda_multiply(MatrixDevice *dev, double *sec) {
+    const dim3 block(THREADS_X, THREADS_Y);
+    const dim3 grid((dev->n + BN - 1) / BN, (dev->m + BM - 1) / BM);
+    cudaEventRecord(dev->start);
+    dgemm_tiled<<<grid, block>>>(dev->m, dev->n, dev->k, dev->A, dev->lda, dev->B, dev->ldb, dev->C, dev->ldc);
+    cudaEventRecord(dev->stop);
+    if (cudaGetLastError() != cudaSuccess) return -1;
+    return event_seconds(dev, sec);
+}
+
+int matrix_cuda_download(MatrixDevice *dev, Matrix *C, double *sec) {
+    if (!C->data || C->rows != dev->m || C->cols != dev->n) return -1;
+    cudaEventRecord(dev->start);
+    const int ok = cudaMemcpy2D(C->data, (size_t) C->ld * sizeof(double), dev->C, dev->ldc * sizeof(double),
+                                (size_t) dev->n * sizeof(double), (size_t) dev->m, cudaMemcpyDeviceToHost) == cudaSuccess;
+    cudaEventRecord(dev->stop);
+    return ok ? event_seconds(dev, sec) : -1;
+}
@@ -0,0 +1,38 @@
+#ifndef MATRIX_CUDA_H
+#define MATRIX_CUDA_H
+
+// GPU backend. Built only with the CUDA toolkit:
+//   nvcc -O3 -Isrc -c src/cuda/matrix_cuda.cu -o build/matrix_cuda.o
+// and linked with -lcudart into a build compiled with -DMATMUL_CUDA.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "matrix_mult.h"
+
+// Device-resident A (m x k), B (k x n) and C (m x n). Uploading the inputs
+// once lets repeated multiplies run without any host transfers.
+typedef struct MatrixDevice MatrixDevice;
+
+// Non-zero if a CUDA device is present; writes its name when name != NULL
+int matrix_cuda_available(char *name, size_t name_size);
+
+// NULL if there is no device or not enough device memory
+MatrixDevice *matrix_cuda_create(int m, int k, int n);
+void matrix_cuda_destroy(MatrixDevice *dev);
+
+// Host -> device copy of A and B; *sec receives the transfer time.
+// Returns -1 on a shape mismatch or CUDA error.
+int matrix_cuda_upload(MatrixDevice *dev, const Matrix *A, const Matrix *B, double *sec);
+// C = A * B on the device with a tiled shared-memory kernel; *sec is the
+// kernel time alone (CUDA events)
+int matrix_cuda_multiply(MatrixDevice *dev, double *sec);
+// Device -> host copy of C
+int matrix_cuda_download(MatrixDevice *dev, Matrix *C, double *sec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
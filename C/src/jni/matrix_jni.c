@@ -0,0 +1,86 @@
+// JNI side of Java/src/NativeMatrix.java. Built only with a JDK:
+//   cmake -S . -B build-jni -DMATMUL_JNI=ON
+// Matrices cross as direct ByteBuffers, whose memory the kernels read and
+// write in place; heap arrays would have to be pinned or copied on every call.
+
+#include <stdio.h>
+#include <jni.h>
+
+#include "matrix_mult.h"
+
+// Address of a direct buffer holding at least rows x cols doubles, or NULL
+// with an IllegalArgumentException pending
+static double *buffer_doubles(JNIEnv *env, jobject buf, int rows, int cols, const char *what) {
+    double *p = buf ? (double*) (*env)->GetDirectBufferAddress(env, buf) : NULL;
+    const jlong bytes = buf ? (*env)->GetDirectBufferCapacity(env, buf) : -1;
+    const char *problem = NULL;
+    if (!p) problem = "must be a direct ByteBuffer";
+    else if (bytes < (jlong) rows * cols * (jlong) sizeof(double)) problem = "is smaller than its matrix";
+    if (!problem) return p;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s %s", what, problem);
+    jclass cls = (*env)->FindClass(env, "java/lang/IllegalArgumentException");
+    if (cls) (*env)->ThrowNew(env, cls, msg);
+    return NULL;
+}
+
+JNIEXPORT jint JNICALL Java_NativeMatrix_kernelId(JNIEnv *env, jclass cls, jstring name) {
+    (void) cls;
+    const char *s = name ? (*env)->GetStringUTFChars(env, name, NULL) : NULL;
+    if (!s) return -1;
+    MatrixKernel k;
+    const int rc = matrix_kernel_from_name(s, &k);
+    (*env)->ReleaseStringUTFChars(env, name, s);
+    return rc == 0 ? (jint) k : -1;
+}
+
+JNIEXPORT jstring JNICALL Java_NativeMatrix_kernelName(JNIEnv *env, jclass cls, jint kernel) {
+    (void) cls;
+    if (kernel < 0 || kernel >= MM_KERNEL_COUNT) return NULL;
+    return (*env)->NewStringUTF(env, matrix_kernel_name((MatrixKernel) kernel));
+}
+
+JNIEXPORT jstring JNICALL Java_NativeMatrix_isaName(JNIEnv *env, jclass cls) {
+    (void) cls;
+    return (*env)->NewStringUTF(env, matrix_isa_name(matrix_simd_isa()));
+}
+
+JNIEXPORT void JNICALL Java_NativeMatrix_setSeed(JNIEnv *env, jclass cls, jlong seed) {
+    (void) env;
+    (void) cls;
+    matrix_set_seed((uint64_t) seed);
+}
+
+JNIEXPORT void JNICALL Java_NativeMatrix_fill(JNIEnv *env, jclass cls, jobject buf, jint rows, jint cols,
+                                              jlong stream) {
+    (void) cls;
+    double *p = buffer_doubles(env, buf, rows, cols, "matrix");
+    if (p) matrix_fill_buffer(p, rows, cols, cols, (uint64_t) stream);
+}
+
+JNIEXPORT jlong JNICALL Java_NativeMatrix_inputStream(JNIEnv *env, jclass cls, jint m, jint k, jint n,
+                                                      jint operand) {
+    (void) env;
+    (void) cls;
+    return (jlong) matrix_input_stream(m, k, n, operand);
+}
+
+// Returns the multiply's own time in seconds, -1 if the library refused the
+// arguments (with an exception pending when a buffer was the problem)
+JNIEXPORT jdouble JNICALL Java_NativeMatrix_multiplyNative(JNIEnv *env, jclass cls, jint kernel, jint threads,
+                                                           jint m, jint k, jint n, jobject a, jobject b, jobject c) {
+    (void) cls;
+    const double *A = buffer_doubles(env, a, m, k, "A");
+    const double *B = A ? buffer_doubles(env, b, k, n, "B") : NULL;
+    double *C = B ? buffer_doubles(env, c, m, n, "C") : NULL;
+    if (!C) return -1.0;
+    double sec = 0.0;
+    if (matrix_multiply_buffers((MatrixKernel) kernel, threads, m, k, n, A, k, B, n, C, n, &sec) != 0) return -1.0;
+    return sec;
+}
+
+JNIEXPORT void JNICALL Java_NativeMatrix_shutdown(JNIEnv *env, jclass cls) {
+    (void) env;
+    (void) cls;
+    matrix_buffers_shutdown();
+}
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+#define ARENA_DEFAULT_CHUNK ((size_t) 64 << 20)
+#define HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    char *base;
+    size_t capacity;
+    size_t used;
+    int mapped;   // came from mmap/VirtualAlloc rather than aligned_malloc
+} ArenaChunk;
+
+struct MatrixArena {
+    ArenaChunk *head;
+    ArenaChunk *current;
+    size_t chunk_bytes;
+    int flags;
+    int huge_backed;   // at least one chunk got huge pages
+};
+
+// Large chunks try huge pages (explicit, then transparent); everything else is aligned_malloc
+static char *chunk_memory(size_t bytes, int flags, int *mapped, int *huge) {
+    *mapped = 0;
+    *huge = 0;
+    if ((flags & MM_ARENA_HUGE_PAGES) && bytes >= HUGE_PAGE_SIZE) {
+#ifdef _WIN32
+        SIZE_T large = GetLargePageMinimum();
+        if (large > 0) {
+            SIZE_T sz = (bytes + large - 1) / large * large;
+            // needs SeLockMemoryPrivilege; fall through to normal pages without it
+            void *p = VirtualAlloc(NULL, sz, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p) {
+                *mapped = 1;
+                *huge = 1;
+                return (char*) p;
+            }
+        }
+#else
+        size_t sz = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  #ifdef MAP_HUGETLB
+        void *p = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *mapped = 1;
+            *huge = 1;
+            return (char*) p;
+        }
+  #endif
+        p = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+  #ifdef MADV_HUGEPAGE
+            *huge = madvise(p, sz, MADV_HUGEPAGE) == 0;
+  #endif
+            *mapped = 1;
+            return (char*) p;
+        }
+#endif
+    }
+    return (char*) aligned_malloc(bytes);
+}
+
+static void chunk_release(ArenaChunk *c) {
+    if (!c->mapped) {
+        aligned_free(c->base);
+        return;
+    }
+    matrix_alloc_account(c->capacity, -1);
+#ifdef _WIN32
+    VirtualFree(c->base, 0, MEM_RELEASE);
+#else
+    size_t sz = (c->capacity + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    munmap(c->base, sz);
+#endif
+}
+
+static ArenaChunk *chunk_new(MatrixArena *arena, size_t min_bytes) {
+    size_t bytes = arena->chunk_bytes > min_bytes ? arena->chunk_bytes : min_bytes;
+    ArenaChunk *c = (ArenaChunk*) calloc(1, sizeof(ArenaChunk));
+    if (!c) return NULL;
+    int huge = 0;
+    c->base = chunk_memory(bytes, arena->flags, &c->mapped, &huge);
+    if (!c->base) {
+        free(c);
+        return NULL;
+    }
+    c->capacity = bytes;
+    if (c->mapped) matrix_alloc_account(bytes, 1);
+    arena->huge_backed |= huge;
+    return c;
+}
+
+MatrixArena *matrix_arena_create(size_t chunk_bytes, int flags) {
+    MatrixArena *arena = (MatrixArena*) calloc(1, sizeof(MatrixArena));
+    if (!arena) return NULL;
+    arena->chunk_bytes = chunk_bytes ? chunk_bytes : ARENA_DEFAULT_CHUNK;
+    arena->flags = flags;
+    return arena;
+}
+
+void matrix_arena_destroy(MatrixArena *arena) {
+    if (!arena) return;
+    ArenaChunk *c = arena->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        chunk_release(c);
+        free(c);
+        c = next;
+    }
+    free(arena);
+}
+
+void *matrix_arena_alloc_bytes(MatrixArena *arena, size_t bytes) {
+    bytes = (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+    if (bytes == 0) bytes = MATRIX_ALIGN;
+    ArenaChunk *c = arena->current;
+    if (c && c->capacity - c->used >= bytes) {
+        void *p = c->base + c->used;
+        c->used += bytes;
+        return p;
+    }
+    // reuse the chunk after the current one (left over from before a reset) if it fits
+    ArenaChunk *next = c ? c->next : arena->head;
+    if (!next || next->capacity < bytes) {
+        ArenaChunk *fresh = chunk_new(arena, bytes);
+        if (!fresh) return NULL;
+        fresh->next = next;
+        if (c) c->next = fresh;
+        else arena->head = fresh;
+        next = fresh;
+    }
+    next->used = bytes;
+    arena->current = next;
+    return next->base;
+}
+
+Matrix matrix_arena_alloc(MatrixArena *arena, int rows, int cols) {
+    Matrix M = {0};
+    if (rows <= 0 || cols <= 0) return M;
+    int ld = padded_ld(cols);
+    double *data = (double*) matrix_arena_alloc_bytes(arena, (size_t) rows * ld * sizeof(double));
+    if (!data) return M;
+    M.data = data;
+    M.rows = rows;
+    M.cols = cols;
+    M.ld = ld;
+    M.owns = 0;   // released with the arena, never by matrix_free
+    return M;
+}
+
+void matrix_arena_reset(MatrixArena *arena) {
+    // later chunks are rewound lazily when the allocator advances into them
+    arena->current = arena->head;
+    if (arena->head) arena->head->used = 0;
+}
+
+MatrixArenaMark matrix_arena_mark(const MatrixArena *arena) {
+    MatrixArenaMark mark;
+    mark.chunk = arena->current;
+    mark.used = arena->current ? arena->current->used : 0;
+    return mark;
+}
+
+void matrix_arena_release(MatrixArena *arena, MatrixArenaMark mark) {
+    // chunks past the marked one are rewound lazily, as after a reset
+    arena->current = (ArenaChunk*) mark.chunk;
+    if (arena->current) arena->current->used = mark.used;
+}
+
+size_t matrix_arena_capacity(const MatrixArena *arena) {
+    size_t total = 0;
+    for (const ArenaChunk *c = arena->head; c; c = c->next) total += c->capacity;
+    return total;
+}
+
+int matrix_arena_huge_pages(const MatrixArena *arena) {
+    return arena->huge_backed;
+}
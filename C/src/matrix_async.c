@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+// Requests with at most this many multiply-adds run whole on one worker, side
+// by side with other small ones; larger requests get the entire pool
+#define ASYNC_SMALL_FLOPS ((double) (1 << 21))
+// Most small requests handed to the pool as one job
+#define ASYNC_MAX_GROUP 64
+
+struct MatrixFuture {
+    MatrixExecutor *ex;
+    MatrixKernel kernel;
+    const Matrix *A;
+    const Matrix *B;
+    Matrix *C;
+    int status;                 // result once done
+    int done;                   // guarded by the executor lock
+    struct MatrixFuture *next;  // queue link
+};
+
+struct MatrixExecutor {
+    ThreadPool *pool;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // a request was queued or shutdown began
+    pthread_cond_t finished;    // some request completed
+    MatrixFuture *head;
+    MatrixFuture *tail;
+    int stopping;
+};
+
+static int is_small(const MatrixFuture *f) {
+    return (double) f->A->rows * f->A->cols * f->B->cols <= ASYNC_SMALL_FLOPS;
+}
+
+static void run_group_task(void *arg, int task, int worker) {
+    (void) worker;
+    MatrixFuture *f = ((MatrixFuture**) arg)[task];
+    matrix_multiply_with(f->kernel, f->A, f->B, f->C);
+    f->status = 0;
+}
+
+static void *dispatcher_main(void *arg) {
+    MatrixExecutor *ex = (MatrixExecutor*) arg;
+    MatrixFuture *group[ASYNC_MAX_GROUP];
+    for (;;) {
+        pthread_mutex_lock(&ex->lock);
+        while (!ex->head && !ex->stopping) pthread_cond_wait(&ex->work, &ex->lock);
+        if (!ex->head) {
+            pthread_mutex_unlock(&ex->lock);
+            break;
+        }
+        // a large request alone, or a run of small ones in submission order
+        int count = 0;
+        do {
+            group[count++] = ex->head;
+            ex->head = ex->head->next;
+        } while (ex->head && count < ASYNC_MAX_GROUP && is_small(group[0]) && is_small(ex->head));
+        if (!ex->head) ex->tail = NULL;
+        pthread_mutex_unlock(&ex->lock);
+
+        if (count == 1) {
+            MatrixFuture *f = group[0];
+            f->status = matrix_multiply_parallel(ex->pool, f->kernel, f->A, f->B, f->C);
+        } else {
+            thread_pool_run(ex->pool, count, run_group_task, group);
+        }
+
+        pthread_mutex_lock(&ex->lock);
+        for (int i = 0; i < count; i++) group[i]->done = 1;
+        pthread_cond_broadcast(&ex->finished);
+        pthread_mutex_unlock(&ex->lock);
+    }
+    return NULL;
+}
+
+MatrixExecutor *matrix_executor_create(ThreadPool *pool) {
+    MatrixExecutor *ex = (MatrixExecutor*) calloc(1, sizeof(MatrixExecutor));
+    if (!ex) return NULL;
+    ex->pool = pool;
+    pthread_mutex_init(&ex->lock, NULL);
+    pthread_cond_init(&ex->work, NULL);
+    pthread_cond_init(&ex->finished, NULL);
+    if (pthread_create(&ex->thread, NULL, dispatcher_main, ex) != 0) {
+        pthread_cond_destroy(&ex->finished);
+        pthread_cond_destroy(&ex->work);
+        pthread_mutex_destroy(&ex->lock);
+        free(ex);
+        return NULL;
+    }
+    return ex;
+}
+
+void matrix_executor_destroy(MatrixExecutor *ex) {
+    if (!ex) return;
+    pthread_mutex_lock(&ex->lock);
+    ex->stopping = 1;
+    pthread_cond_signal(&ex->work);
+    pthread_mutex_unlock(&ex->lock);
+    pthread_join(ex->thread, NULL);
+    pthread_cond_destroy(&ex->finished);
+    pthread_cond_destroy(&ex->work);
+    pthread_mutex_destroy(&ex->lock);
+    free(ex);
+}
+
+MatrixFuture *matrix_submit(MatrixExecutor *ex, MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C) {
+    if (k < 0 || k >= MM_KERNEL_COUNT || matrix_check_shapes(A, B, C) != 0) return NULL;
+    MatrixFuture *f = (MatrixFuture*) calloc(1, sizeof(MatrixFuture));
+    if (!f) return NULL;
+    f->ex = ex;
+    f->kernel = k;
+    f->A = A;
+    f->B = B;
+    f->C = C;
+    f->status = -1;
+    pthread_mutex_lock(&ex->lock);
+    if (ex->stopping) {
+        pthread_mutex_unlock(&ex->lock);
+        free(f);
+        return NULL;
+    }
+    if (ex->tail) ex->tail->next = f;
+    else ex->head = f;
+    ex->tail = f;
+    pthread_cond_signal(&ex->work);
+    pthread_mutex_unlock(&ex->lock);
+    return f;
+}
+
+int matrix_future_poll(const MatrixFuture *f) {
+    MatrixExecutor *ex = f->ex;
+    pthread_mutex_lock(&ex->lock);
+    const int done = f->done;
+    pthread_mutex_unlock(&ex->lock);
+    return done;
+}
+
+int matrix_future_wait(MatrixFuture *f) {
+    MatrixExecutor *ex = f->ex;
+    pthread_mutex_lock(&ex->lock);
+    while (!f->done) pthread_cond_wait(&ex->finished, &ex->lock);
+    pthread_mutex_unlock(&ex->lock);
+    const int status = f->status;
+    free(f);
+    return status;
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+// Matrices per interleaved group: lane l of every packed element belongs to matrix l
+#define BATCH_LANES 8
+// Larger operands go through the ordinary SIMD kernel one at a time
+#define BATCH_MAX_DIM 64
+
+typedef struct {
+    // array form
+    const Matrix *A;
+    const Matrix *B;
+    Matrix *C;
+    // strided form (used when A == NULL)
+    int m, n, k;
+    const double *a;
+    const double *b;
+    double *c;
+    int lda, ldb, ldc;
+    size_t stride_a, stride_b, stride_c;
+
+    int count;
+    double *scratch;         // per-worker packing buffers
+    size_t scratch_per_worker;
+} BatchJob;
+
+static Matrix strided_matrix(const double *base, size_t stride, int idx, int rows, int cols, int ld) {
+    Matrix M;
+    M.data = (double*) base + stride * (size_t) idx;
+    M.rows = rows;
+    M.cols = cols;
+    M.ld = ld;
+    M.owns = 0;
+    return M;
+}
+
+static void batch_get(const BatchJob *job, int idx, Matrix *A, Matrix *B, Matrix *C) {
+    if (job->A) {
+        *A = job->A[idx];
+        *B = job->B[idx];
+        *C = job->C[idx];
+        return;
+    }
+    *A = strided_matrix(job->a, job->stride_a, idx, job->m, job->k, job->lda);
+    *B = strided_matrix(job->b, job->stride_b, idx, job->k, job->n, job->ldb);
+    *C = strided_matrix(job->c, job->stride_c, idx, job->m, job->n, job->ldc);
+}
+
+// Register block of the interleaved kernel: IB x JB outputs of BATCH_LANES each
+#define BATCH_IB 2
+#define BATCH_JB 4
+
+// One packed element: the same (i,j) of BATCH_LANES different matrices. The
+// compiler lowers it to whatever vector width the clone targets.
+typedef double lanes_t __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+
+// Ci[i][j] = sum_p Ai[i][p] * Bi[p][j] for lanes_t elements; the IB x JB block of
+// accumulators stays in registers for the whole p loop
+MM_MULTIVERSION
+static void interleaved_multiply(int m, int n, int k, const lanes_t *restrict Ai, const lanes_t *restrict Bi,
+                                 lanes_t *restrict Ci) {
+    for (int i = 0; i < m; i += BATCH_IB) {
+        const int ib = min_int(BATCH_IB, m - i);
+        for (int j = 0; j < n; j += BATCH_JB) {
+            const int jb = min_int(BATCH_JB, n - j);
+            if (ib == BATCH_IB && jb == BATCH_JB) {
+                lanes_t acc[BATCH_IB][BATCH_JB] = {{{0}}};
+                for (int p = 0; p < k; p++) {
+                    const lanes_t *b = Bi + (size_t) p * n + j;
+                    for (int ii = 0; ii < BATCH_IB; ii++) {
+                        const lanes_t a = Ai[(size_t) (i + ii) * k + p];
+                        for (int jj = 0; jj < BATCH_JB; jj++) acc[ii][jj] += a * b[jj];
+                    }
+                }
+                for (int ii = 0; ii < BATCH_IB; ii++)
+                    for (int jj = 0; jj < BATCH_JB; jj++) Ci[(size_t) (i + ii) * n + j + jj] = acc[ii][jj];
+                continue;
+            }
+            // partial block on the bottom/right edge
+            for (int ii = 0; ii < ib; ii++)
+                for (int jj = 0; jj < jb; jj++) {
+                    lanes_t acc = {0};
+                    for (int p = 0; p < k; p++) acc += Ai[(size_t) (i + ii) * k + p] * Bi[(size_t) p * n + j + jj];
+                    Ci[(size_t) (i + ii) * n + j + jj] = acc;
+                }
+        }
+    }
+}
+
+// Interleave row i of 'lanes' matrices at a time, so the 8 * cols output
+// elements being written stay in L1 instead of one strided pass per matrix
+static void pack_group(const Matrix *mats, int lanes, double *dst) {
+    const int rows = mats[0].rows, cols = mats[0].cols;
+    for (int i = 0; i < rows; i++) {
+        double *out = dst + (size_t) i * cols * BATCH_LANES;
+        for (int l = 0; l < lanes; l++) {
+            const double *src = &MAT_AT(&mats[l], i, 0);
+            for (int j = 0; j < cols; j++) out[(size_t) j * BATCH_LANES + l] = src[j];
+        }
+    }
+}
+
+static void unpack_group(const double *src, int lanes, Matrix *mats) {
+    const int rows = mats[0].rows, cols = mats[0].cols;
+    for (int i = 0; i < rows; i++) {
+        const double *in = src + (size_t) i * cols * BATCH_LANES;
+        for (int l = 0; l < lanes; l++) {
+            double *dst = &MAT_AT(&mats[l], i, 0);
+            for (int j = 0; j < cols; j++) dst[j] = in[(size_t) j * BATCH_LANES + l];
+        }
+    }
+}
+
+// One task handles up to BATCH_LANES consecutive products
+static void batch_group(void *arg, int task, int worker) {
+    const BatchJob *job = (const BatchJob*) arg;
+    const int first = task * BATCH_LANES;
+    const int lanes = min_int(BATCH_LANES, job->count - first);
+    if (lanes <= 0) return;
+
+    Matrix A[BATCH_LANES], B[BATCH_LANES], C[BATCH_LANES];
+    for (int l = 0; l < lanes; l++) batch_get(job, first + l, &A[l], &B[l], &C[l]);
+    int same = A[0].rows <= BATCH_MAX_DIM && A[0].cols <= BATCH_MAX_DIM && B[0].cols <= BATCH_MAX_DIM;
+    for (int l = 1; l < lanes && same; l++)
+        same = A[l].rows == A[0].rows && A[l].cols == A[0].cols && B[l].cols == B[0].cols;
+    if (!same) {
+        for (int l = 0; l < lanes; l++) matrix_multiply_simd(&A[l], &B[l], &C[l], NULL);
+        return;
+    }
+
+    const int m = A[0].rows, k = A[0].cols, n = B[0].cols;
+    double *Ai = job->scratch + job->scratch_per_worker * (size_t) worker;
+    double *Bi = Ai + (size_t) m * k * BATCH_LANES;
+    double *Ci = Bi + (size_t) k * n * BATCH_LANES;
+    if (lanes < BATCH_LANES) {
+        // unused lanes compute on zeros and are never unpacked
+        memset(Ai, 0, (size_t) (m * k + k * n) * BATCH_LANES * sizeof(double));
+    }
+    pack_group(A, lanes, Ai);
+    pack_group(B, lanes, Bi);
+    interleaved_multiply(m, n, k, (const lanes_t*) Ai, (const lanes_t*) Bi, (lanes_t*) Ci);
+    unpack_group(Ci, lanes, C);
+}
+
+static int run_batch(ThreadPool *pool, BatchJob *job) {
+    if (job->count <= 0) return 0;
+    // scratch is sized for the largest interleavable group
+    size_t per_worker = 0;
+    for (int i = 0; i < job->count; i++) {
+        Matrix A, B, C;
+        batch_get(job, i, &A, &B, &C);
+        if (matrix_check_shapes(&A, &B, &C) != 0) return -1;
+        if (A.rows <= BATCH_MAX_DIM && A.cols <= BATCH_MAX_DIM && B.cols <= BATCH_MAX_DIM) {
+            size_t need = ((size_t) A.rows * A.cols + (size_t) A.cols * B.cols + (size_t) A.rows * B.cols)
+                          * BATCH_LANES;
+            if (need > per_worker) per_worker = need;
+        }
+        if (!job->A) break;   // strided batches share one shape
+    }
+    per_worker = (per_worker + 7) / 8 * 8;   // keep each worker's slice on its own cache lines
+    job->scratch_per_worker = per_worker;
+    job->scratch = per_worker
+        ? (double*) aligned_malloc(per_worker * (size_t) thread_pool_size(pool) * sizeof(double))
+        : NULL;
+    if (per_worker && !job->scratch) return -1;
+
+    thread_pool_run(pool, (job->count + BATCH_LANES - 1) / BATCH_LANES, batch_group, job);
+    aligned_free(job->scratch);
+    return 0;
+}
+
+int matrix_multiply_batch(ThreadPool *pool, const Matrix *A, const Matrix *B, Matrix *C, int count) {
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.A = A;
+    job.B = B;
+    job.C = C;
+    job.count = count;
+    return run_batch(pool, &job);
+}
+
+int matrix_dgemm_batch_strided(ThreadPool *pool, int m, int n, int k,
+                               const double *A, int lda, size_t stride_a,
+                               const double *B, int ldb, size_t stride_b,
+                               double *C, int ldc, size_t stride_c, int count) {
+    if (m <= 0 || n <= 0 || k <= 0 || lda < k || ldb < n || ldc < n) return -1;
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.m = m;
+    job.n = n;
+    job.k = k;
+    job.a = A;
+    job.b = B;
+    job.c = C;
+    job.lda = lda;
+    job.ldb = ldb;
+    job.ldc = ldc;
+    job.stride_a = stride_a;
+    job.stride_b = stride_b;
+    job.stride_c = stride_c;
+    job.count = count;
+    return run_batch(pool, &job);
+}
@@ -0,0 +1,36 @@
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+int matrix_multiply_buffers(MatrixKernel kernel, int threads, int m, int k, int n, const double *A, int lda,
+                            const double *B, int ldb, double *C, int ldc, double *sec) {
+    if (sec) *sec = 0.0;
+    if ((int) kernel < 0 || kernel >= MM_KERNEL_COUNT || m <= 0 || k <= 0 || n <= 0 || !A || !B || !C ||
+        lda < k || ldb < n || ldc < n)
+        return -1;
+    // views of the caller's buffers: nothing is copied and matrix_free is never called on them
+    const Matrix Am = { (double*) A, m, k, lda, 0 };
+    const Matrix Bm = { (double*) B, k, n, ldb, 0 };
+    Matrix Cm = { C, m, n, ldc, 0 };
+    if (threads <= 0) threads = thread_pool_default_threads();
+    // the library's own pool, kept between calls since creating workers per call would dominate the
+    // small sizes a binding is measured at. It is unpinned: the calling thread belongs to the JVM or
+    // the interpreter, not to us. MM_KERNEL_AUTO takes the pool itself, at the tuning table's size.
+    ThreadPool *pool = NULL;
+    if (threads > 1 && kernel != MM_KERNEL_AUTO && !(pool = matrix_shared_pool_acquire(threads))) return -1;
+    const double t0 = wall_seconds();
+    const int rc = matrix_multiply_parallel(pool, kernel, &Am, &Bm, &Cm);
+    if (sec) *sec = wall_seconds() - t0;
+    if (pool) matrix_shared_pool_release();
+    return rc;
+}
+
+int matrix_fill_buffer(double *data, int rows, int cols, int ld, uint64_t stream) {
+    if (!data || rows <= 0 || cols <= 0 || ld < cols) return -1;
+    Matrix M = { data, rows, cols, ld, 0 };
+    matrix_fill_random_at(NULL, &M, stream, 0, 0);
+    return 0;
+}
+
+void matrix_buffers_shutdown(void) {
+    matrix_shared_pool_shutdown();
+}
@@ -0,0 +1,97 @@
+#include <string.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+// Eight doubles; lowered to one zmm, two ymm or four xmm registers per clone
+typedef double vec8_t __attribute__((vector_size(8 * sizeof(double))));
+
+// Register block of the fixed kernels: FIXED_RB rows x FIXED_CV vectors of C
+#define FIXED_RB 4
+#define FIXED_CV 2
+
+// C = A * B for N x N operands with N a compile-time constant. All trip counts
+// are constants, so the inner loops unroll completely, the RB x CV block of C
+// stays in vector registers across the whole p loop, and there is no
+// remainder code. N must be a multiple of 8; rows of a view need not be
+// 64-byte aligned, so B and C are accessed through memcpy.
+#define DEFINE_FIXED_KERNEL(N)                                                                      \
+    MM_MULTIVERSION                                                                                 \
+    static void fixed_multiply_##N(const double *restrict A, size_t lda, const double *restrict B,  \
+                                   size_t ldb, double *restrict C, size_t ldc) {                    \
+        enum { CV = (N) / 8 < FIXED_CV ? (N) / 8 : FIXED_CV };                                      \
+        for (int i = 0; i < (N); i += FIXED_RB) {                                                   \
+            for (int j0 = 0; j0 < (N); j0 += 8 * CV) {                                              \
+                vec8_t c[FIXED_RB][CV] = {{{0}}};                                                   \
+                for (int p = 0; p < (N); p++) {                                                     \
+                    const double *Bp = B + (size_t) p * ldb + j0;                                   \
+                    vec8_t b[CV];                                                                   \
+                    for (int v = 0; v < CV; v++) memcpy(&b[v], Bp + 8 * v, sizeof(vec8_t));         \
+                    for (int r = 0; r < FIXED_RB; r++) {                                            \
+                        const double a = A[(size_t) (i + r) * lda + p];                             \
+                        for (int v = 0; v < CV; v++) c[r][v] += a * b[v];                           \
+                    }                                                                               \
+                }                                                                                   \
+                for (int r = 0; r < FIXED_RB; r++) {                                                \
+                    double *Cr = C + (size_t) (i + r) * ldc + j0;                                   \
+                    for (int v = 0; v < CV; v++) memcpy(Cr + 8 * v, &c[r][v], sizeof(vec8_t));      \
+                }                                                                                   \
+            }                                                                                       \
+        }                                                                                           \
+    }
+
+// 4 x 4 is below one vector row; unrolled scalar code is what the compiler
+// packs into registers best
+MM_MULTIVERSION
+static void fixed_multiply_4(const double *restrict A, size_t lda, const double *restrict B, size_t ldb,
+                             double *restrict C, size_t ldc) {
+    for (int i = 0; i < 4; i++) {
+        double c[4] = {0};
+        for (int p = 0; p < 4; p++) {
+            const double a = A[(size_t) i * lda + p];
+            for (int j = 0; j < 4; j++) c[j] += a * B[(size_t) p * ldb + j];
+        }
+        for (int j = 0; j < 4; j++) C[(size_t) i * ldc + j] = c[j];
+    }
+}
+
+DEFINE_FIXED_KERNEL(8)
+DEFINE_FIXED_KERNEL(16)
+DEFINE_FIXED_KERNEL(32)
+DEFINE_FIXED_KERNEL(64)
+
+typedef void (*fixed_kernel_fn)(const double *A, size_t lda, const double *B, size_t ldb, double *C,
+                                size_t ldc);
+
+static const struct {
+    int n;
+    fixed_kernel_fn kernel;
+} fixed_kernels[] = {
+    { 4, fixed_multiply_4 },
+    { 8, fixed_multiply_8 },
+    { 16, fixed_multiply_16 },
+    { 32, fixed_multiply_32 },
+    { 64, fixed_multiply_64 },
+};
+
+#define NUM_FIXED_KERNELS ((int) (sizeof(fixed_kernels) / sizeof(fixed_kernels[0])))
+
+int matrix_fixed_supported(int m, int k, int n) {
+    if (m != k || k != n) return 0;
+    for (int i = 0; i < NUM_FIXED_KERNELS; i++) {
+        if (fixed_kernels[i].n == n) return 1;
+    }
+    return 0;
+}
+
+int matrix_multiply_fixed(const Matrix *A, const Matrix *B, Matrix *C) {
+    const int n = B->cols;
+    if (!matrix_fixed_supported(A->rows, A->cols, n)) return -1;
+    for (int i = 0; i < NUM_FIXED_KERNELS; i++) {
+        if (fixed_kernels[i].n == n) {
+            fixed_kernels[i].kernel(A->data, (size_t) A->ld, B->data, (size_t) B->ld, C->data, (size_t) C->ld);
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+// Sixteen floats fill one 64-byte line, like eight doubles do
+#define FLOATS_PER_LINE (MATRIX_ALIGN / (int) sizeof(float))
+
+// Register block of both kernels: MR rows of C by two vectors
+#define F32_MR 4
+#define F32_NR 32      // two 16-float vectors
+#define MIXED_NR 16    // two 8-double vectors
+
+typedef float vf8_t __attribute__((vector_size(8 * sizeof(float))));
+typedef float vf16_t __attribute__((vector_size(16 * sizeof(float))));
+typedef double vd8_t __attribute__((vector_size(8 * sizeof(double))));
+
+// ---------- Float matrices ----------
+MatrixF matrix_alloc_f(int rows, int cols) {
+    MatrixF M = {0};
+    if (rows <= 0 || cols <= 0) return M;
+    int ld = (cols + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+    float *data = (float*) aligned_malloc((size_t) rows * (size_t) ld * sizeof(float));
+    if (!data) return M;
+    M.data = data;
+    M.rows = rows;
+    M.cols = cols;
+    M.ld = ld;
+    M.owns = MM_OWNS_HEAP;
+    return M;
+}
+
+void matrix_free_f(MatrixF *M) {
+    if (M->owns == MM_OWNS_MAPPED) matrix_unmap_data(M->data, (size_t) M->rows * M->ld * sizeof(float));
+    else if (M->owns) aligned_free(M->data);
+    M->data = NULL;
+    M->rows = M->cols = M->ld = 0;
+    M->owns = 0;
+}
+
+void matrix_zero_f(MatrixF *M) {
+    for (int i = 0; i < M->rows; i++) {
+        memset(&MAT_AT(M, i, 0), 0, (size_t) M->cols * sizeof(float));
+    }
+}
+
+void matrix_fill_random_f(MatrixF *M) {
+    // the double stream rounded, in row chunks through a stack buffer
+    const uint64_t stream = matrix_next_stream();
+    double buf[256];
+    for (int i = 0; i < M->rows; i++) {
+        float *Mi = &MAT_AT(M, i, 0);
+        for (int j0 = 0; j0 < M->cols; j0 += 256) {
+            const int len = min_int(256, M->cols - j0);
+            matrix_random_row(stream, i, j0, len, buf);
+            for (int j = 0; j < len; j++) Mi[j0 + j] = (float) buf[j];
+        }
+    }
+}
+
+void matrix_to_f(const Matrix *src, MatrixF *dst) {
+    for (int i = 0; i < src->rows; i++) {
+        const double *Si = &MAT_AT(src, i, 0);
+        float *Di = &MAT_AT(dst, i, 0);
+        for (int j = 0; j < src->cols; j++) Di[j] = (float) Si[j];
+    }
+}
+
+void matrix_from_f(const MatrixF *src, Matrix *dst) {
+    for (int i = 0; i < src->rows; i++) {
+        const float *Si = &MAT_AT(src, i, 0);
+        double *Di = &MAT_AT(dst, i, 0);
+        for (int j = 0; j < src->cols; j++) Di[j] = Si[j];
+    }
+}
+
+// ---------- Block kernels ----------
+// C[0:mb, 0:nb] += A[0:mb, 0:kb] * B[0:kb, 0:nb]; MR x NR tiles stay in
+// registers, the right and bottom edges use plain loops
+MM_MULTIVERSION
+static void block_f32(int mb, int nb, int kb, const float *restrict A, size_t lda, const float *restrict B,
+                      size_t ldb, float *restrict C, size_t ldc) {
+    int i = 0;
+    for (; i + F32_MR <= mb; i += F32_MR) {
+        int j = 0;
+        for (; j + F32_NR <= nb; j += F32_NR) {
+            vf16_t c[F32_MR][2] = {{{0}}};
+            for (int p = 0; p < kb; p++) {
+                vf16_t b[2];
+                memcpy(b, B + (size_t) p * ldb + j, sizeof(b));
+                for (int r = 0; r < F32_MR; r++) {
+                    const float a = A[(size_t) (i + r) * lda + p];
+                    c[r][0] += a * b[0];
+                    c[r][1] += a * b[1];
+                }
+            }
+            for (int r = 0; r < F32_MR; r++) {
+                float *Cr = C + (size_t) (i + r) * ldc + j;
+                vf16_t old[2];
+                memcpy(old, Cr, sizeof(old));
+                old[0] += c[r][0];
+                old[1] += c[r][1];
+                memcpy(Cr, old, sizeof(old));
+            }
+        }
+        for (int r = i; r < i + F32_MR; r++)
+            for (int p = 0; p < kb; p++) {
+                const float a = A[(size_t) r * lda + p];
+                for (int jj = j; jj < nb; jj++) C[(size_t) r * ldc + jj] += a * B[(size_t) p * ldb + jj];
+            }
+    }
+    for (; i < mb; i++)
+        for (int p = 0; p < kb; p++) {
+            const float a = A[(size_t) i * lda + p];
+            for (int j = 0; j < nb; j++) C[(size_t) i * ldc + j] += a * B[(size_t) p * ldb + j];
+        }
+}
+
+// Same with float operands widened to double before every multiply-add
+MM_MULTIVERSION
+static void block_mixed(int mb, int nb, int kb, const float *restrict A, size_t lda, const float *restrict B,
+                        size_t ldb, double *restrict C, size_t ldc) {
+    int i = 0;
+    for (; i + F32_MR <= mb; i += F32_MR) {
+        int j = 0;
+        for (; j + MIXED_NR <= nb; j += MIXED_NR) {
+            vd8_t c[F32_MR][2] = {{{0}}};
+            for (int p = 0; p < kb; p++) {
+                vf8_t bf[2];
+                memcpy(bf, B + (size_t) p * ldb + j, sizeof(bf));
+                const vd8_t b0 = __builtin_convertvector(bf[0], vd8_t);
+                const vd8_t b1 = __builtin_convertvector(bf[1], vd8_t);
+                for (int r = 0; r < F32_MR; r++) {
+                    const double a = A[(size_t) (i + r) * lda + p];
+                    c[r][0] += a * b0;
+                    c[r][1] += a * b1;
+                }
+            }
+            for (int r = 0; r < F32_MR; r++) {
+                double *Cr = C + (size_t) (i + r) * ldc + j;
+                vd8_t old[2];
+                memcpy(old, Cr, sizeof(old));
+                old[0] += c[r][0];
+                old[1] += c[r][1];
+                memcpy(Cr, old, sizeof(old));
+            }
+        }
+        for (int r = i; r < i + F32_MR; r++)
+            for (int p = 0; p < kb; p++) {
+                const double a = A[(size_t) r * lda + p];
+                for (int jj = j; jj < nb; jj++) C[(size_t) r * ldc + jj] += a * (double) B[(size_t) p * ldb + jj];
+            }
+    }
+    for (; i < mb; i++)
+        for (int p = 0; p < kb; p++) {
+            const double a = A[(size_t) i * lda + p];
+            for (int j = 0; j < nb; j++) C[(size_t) i * ldc + j] += a * (double) B[(size_t) p * ldb + j];
+        }
+}
+
+// ---------- Drivers ----------
+typedef struct {
+    const MatrixF *A;
+    const MatrixF *B;
+    MatrixF *Cf;   // fp32 result
+    Matrix *Cd;    // mixed result
+    MatrixTiles tiles;
+} FloatJob;
+
+// One task owns a panel of tiles.mc rows of C and runs the usual jc/pc loops over it
+static void float_panel(void *arg, int task, int worker) {
+    (void) worker;
+    const FloatJob *job = (const FloatJob*) arg;
+    const MatrixTiles t = job->tiles;
+    const int i0 = task * t.mc;
+    const int mb = min_int(t.mc, job->A->rows - i0);
+    const int k = job->A->cols, n = job->B->cols;
+    const size_t lda = (size_t) job->A->ld, ldb = (size_t) job->B->ld;
+
+    if (job->Cf) {
+        for (int i = i0; i < i0 + mb; i++) memset(&MAT_AT(job->Cf, i, 0), 0, (size_t) n * sizeof(float));
+    } else {
+        for (int i = i0; i < i0 + mb; i++) memset(&MAT_AT(job->Cd, i, 0), 0, (size_t) n * sizeof(double));
+    }
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            const float *Ap = &MAT_AT(job->A, i0, pc);
+            const float *Bp = &MAT_AT(job->B, pc, jc);
+            if (job->Cf)
+                block_f32(mb, nb, kb, Ap, lda, Bp, ldb, &MAT_AT(job->Cf, i0, jc), (size_t) job->Cf->ld);
+            else
+                block_mixed(mb, nb, kb, Ap, lda, Bp, ldb, &MAT_AT(job->Cd, i0, jc), (size_t) job->Cd->ld);
+        }
+    }
+}
+
+static void run_float(ThreadPool *pool, FloatJob *job) {
+    job->tiles = matrix_get_tiles();
+    // narrower panels so every worker gets a few
+    const int want = 4 * thread_pool_size(pool);
+    while (job->tiles.mc > 16 && (job->A->rows + job->tiles.mc - 1) / job->tiles.mc < want) job->tiles.mc /= 2;
+    thread_pool_run(pool, (job->A->rows + job->tiles.mc - 1) / job->tiles.mc, float_panel, job);
+}
+
+static int float_shapes_ok(const MatrixF *A, const MatrixF *B, int c_rows, int c_cols, const void *c_data) {
+    if (!A->data || !B->data || !c_data) return 0;
+    return A->cols == B->rows && c_rows == A->rows && c_cols == B->cols;
+}
+
+int matrix_multiply_f(ThreadPool *pool, const MatrixF *A, const MatrixF *B, MatrixF *C) {
+    if (!float_shapes_ok(A, B, C->rows, C->cols, C->data)) return -1;
+    FloatJob job = { A, B, C, NULL, { 0, 0, 0 } };
+    run_float(pool, &job);
+    return 0;
+}
+
+int matrix_multiply_mixed(ThreadPool *pool, const MatrixF *A, const MatrixF *B, Matrix *C) {
+    if (!float_shapes_ok(A, B, C->rows, C->cols, C->data)) return -1;
+    FloatJob job = { A, B, NULL, C, { 0, 0, 0 } };
+    run_float(pool, &job);
+    return 0;
+}
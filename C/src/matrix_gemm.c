@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+static void scale_c(int m, int n, double beta, double *C, size_t ldc) {
+    if (beta == 1.0) return;
+    for (int i = 0; i < m; i++) {
+        double *Ci = C + i * ldc;
+        if (beta == 0.0) {
+            // BLAS semantics: beta == 0 overwrites C, even NaN/Inf in it
+            memset(Ci, 0, (size_t) n * sizeof(double));
+        } else {
+            for (int j = 0; j < n; j++) Ci[j] *= beta;
+        }
+    }
+}
+
+int matrix_dgemm(MatrixTranspose ta, MatrixTranspose tb, int m, int n, int k, double alpha,
+                 const double *A, int lda, const double *B, int ldb, double beta, double *C, int ldc) {
+    if (m < 0 || n < 0 || k < 0) return -1;
+    // row-major storage: A is m x k (or k x m when transposed), B is k x n (or n x k)
+    const int a_cols = ta == MM_TRANS ? m : k;
+    const int b_cols = tb == MM_TRANS ? k : n;
+    if (lda < (a_cols > 1 ? a_cols : 1) || ldb < (b_cols > 1 ? b_cols : 1) || ldc < (n > 1 ? n : 1))
+        return -1;
+    if (m == 0 || n == 0) return 0;
+
+    const size_t sa = (size_t) lda, sb = (size_t) ldb, sc = (size_t) ldc;
+    scale_c(m, n, beta, C, sc);
+    if (alpha == 0.0 || k == 0) return 0;
+
+    // Transposed operands are copied one cache block at a time so the SIMD
+    // block routine always sees row-major panels; the plain case reads in place.
+    const MatrixTiles t = matrix_get_tiles();
+    double *abuf = ta == MM_TRANS ? (double*) aligned_malloc((size_t) t.mc * t.kc * sizeof(double)) : NULL;
+    double *bbuf = tb == MM_TRANS ? (double*) aligned_malloc((size_t) t.kc * t.nc * sizeof(double)) : NULL;
+    if ((ta == MM_TRANS && !abuf) || (tb == MM_TRANS && !bbuf)) {
+        aligned_free(abuf);
+        aligned_free(bbuf);
+        return -1;
+    }
+
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            const double *Bblk = B + pc * sb + jc;
+            size_t ldbb = sb;
+            if (tb == MM_TRANS) {
+                for (int j = 0; j < nb; j++) {
+                    const double *Bj = B + (size_t) (jc + j) * sb + pc;
+                    for (int p = 0; p < kb; p++) bbuf[(size_t) p * nb + j] = Bj[p];
+                }
+                Bblk = bbuf;
+                ldbb = (size_t) nb;
+            }
+            for (int ic = 0; ic < m; ic += t.mc) {
+                const int mb = min_int(t.mc, m - ic);
+                const double *Ablk = A + ic * sa + pc;
+                size_t ldab = sa;
+                if (ta == MM_TRANS) {
+                    for (int p = 0; p < kb; p++) {
+                        const double *Ap = A + (size_t) (pc + p) * sa + ic;
+                        for (int i = 0; i < mb; i++) abuf[(size_t) i * kb + p] = Ap[i];
+                    }
+                    Ablk = abuf;
+                    ldab = (size_t) kb;
+                }
+                simd_block_multiply(mb, nb, kb, alpha, Ablk, ldab, Bblk, ldbb, C + ic * sc + jc, sc);
+            }
+        }
+    }
+
+    aligned_free(abuf);
+    aligned_free(bbuf);
+    return 0;
+}
+
+int matrix_gemm(MatrixTranspose ta, MatrixTranspose tb, double alpha, const Matrix *A, const Matrix *B,
+                double beta, Matrix *C) {
+    const int m = C->rows, n = C->cols;
+    const int k = ta == MM_TRANS ? A->rows : A->cols;
+    if ((ta == MM_TRANS ? A->cols : A->rows) != m) return -1;
+    if ((tb == MM_TRANS ? B->cols : B->rows) != k) return -1;
+    if ((tb == MM_TRANS ? B->rows : B->cols) != n) return -1;
+    return matrix_dgemm(ta, tb, m, n, k, alpha, A->data, A->ld, B->data, B->ld, beta, C->data, C->ld);
+}
@@ -0,0 +1,77 @@
+#ifndef MATRIX_INTERNAL_H
+#define MATRIX_INTERNAL_H
+
+// Helpers shared by the matrix_mult translation units; not part of the public API.
+
+#include <stddef.h>
+
+#include "matrix_mult.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+static inline int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+// Plain C loops that should vectorize as wide as the running CPU allows. Where
+// the toolchain supports ifunc dispatch (x86-64 ELF) the function is cloned per
+// ISA; elsewhere it is compiled for the baseline target. Clones are keyed on
+// CPU features, not "arch=" names: those match the CPU model, which VMs often
+// hide, and would silently fall back to the default clone.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+  #define MM_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+  #define MM_MULTIVERSION
+#endif
+
+// Round a row length up so that each row starts on a MATRIX_ALIGN boundary
+static inline int padded_ld(int cols) {
+    const int per_line = MATRIX_ALIGN / (int) sizeof(double);
+    return (cols + per_line - 1) / per_line * per_line;
+}
+
+static inline double wall_seconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, ctr;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&ctr);
+    return (double)ctr.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Adds (sign > 0) or removes (sign < 0) bytes in the matrix_alloc_stats counters;
+// aligned_malloc does this itself, direct mappings owned by the library call it
+void matrix_alloc_account(size_t bytes, int sign);
+
+// matrix_multiply_with on the given tiles (NULL: matrix_get_tiles()) for the tiled kernels
+void matrix_multiply_with_tiles(MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C,
+                                const MatrixTiles *tiles);
+
+// Library-owned, unpinned pool of exactly threads workers, for work whose
+// thread count the library picks (MM_KERNEL_AUTO). Kept between calls and
+// recreated when another size is asked for. A pool runs one job at a time, so
+// it is returned locked until matrix_shared_pool_release; NULL (not locked)
+// if the workers could not be started.
+ThreadPool *matrix_shared_pool_acquire(int threads);
+void matrix_shared_pool_release(void);
+void matrix_shared_pool_shutdown(void);
+
+// out[0..count) = elements (row, col0 ..) of a random stream under the current seed
+void matrix_random_row(uint64_t stream, int row, int col0, int count, double *out);
+
+// Releases a matrix_map mapping of bytes bytes starting at element (0,0)
+void matrix_unmap_data(void *data, size_t bytes);
+
+// C[0:mb,0:nb] += alpha * A[0:mb,0:kb] * B[0:kb,0:nb] using the dispatched SIMD micro-kernel
+void simd_block_multiply(int mb, int nb, int kb, double alpha, const double *A, size_t lda,
+                         const double *B, size_t ldb, double *C, size_t ldc);
+
+#endif
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+_Static_assert(sizeof(MatrixFileHeader) == MM_FILE_HEADER_BYTES, "matrix file header must be 64 bytes");
+
+#define MM_FILE_ENDIAN_TAG 0x01020304u
+
+static const char file_magic[8] = MM_FILE_MAGIC;
+
+// Granularity a mapping has to start on: the page size, or on Windows the
+// (larger) allocation granularity
+static size_t map_granularity(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwAllocationGranularity;
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t) page : 4096;
+#endif
+}
+
+// ---------- Writing ----------
+// Header for a freshly written file: rows are padded to whole cache lines on
+// disk, exactly as in memory
+static void init_header(MatrixFileHeader *h, uint32_t dtype, int rows, int cols, size_t elem) {
+    const size_t per_line = MATRIX_ALIGN / elem;
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, file_magic, sizeof(h->magic));
+    h->version = MM_FILE_VERSION;
+    h->dtype = dtype;
+    h->layout = MM_LAYOUT_ROW_MAJOR;
+    h->endian = MM_FILE_ENDIAN_TAG;
+    h->rows = rows;
+    h->cols = cols;
+    h->ld = (int64_t) (((size_t) cols + per_line - 1) / per_line * per_line);
+    h->data_offset = MM_FILE_HEADER_BYTES;
+}
+
+static int write_file(const char *path, uint32_t dtype, const void *data, int rows, int cols, int ld,
+                      size_t elem) {
+    MatrixFileHeader h;
+    init_header(&h, dtype, rows, cols, elem);
+    const size_t file_ld = (size_t) h.ld;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    static const char zeros[MATRIX_ALIGN] = {0};
+    const size_t row_bytes = (size_t) cols * elem, pad = (file_ld - (size_t) cols) * elem;
+    for (int i = 0; ok && i < rows; i++) {
+        const char *row = (const char*) data + (size_t) i * (size_t) ld * elem;
+        ok = fwrite(row, 1, row_bytes, f) == row_bytes && (pad == 0 || fwrite(zeros, 1, pad, f) == pad);
+    }
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+int matrix_save(const char *path, const Matrix *M) {
+    if (!M->data) return -1;
+    return write_file(path, MM_DTYPE_F64, M->data, M->rows, M->cols, M->ld, sizeof(double));
+}
+
+int matrix_save_f(const char *path, const MatrixF *M) {
+    if (!M->data) return -1;
+    return write_file(path, MM_DTYPE_F32, M->data, M->rows, M->cols, M->ld, sizeof(float));
+}
+
+int matrix_file_create(const char *path, int rows, int cols) {
+    if (rows <= 0 || cols <= 0) return -1;
+    MatrixFileHeader h;
+    init_header(&h, MM_DTYPE_F64, rows, cols, sizeof(double));
+    const uint64_t size = h.data_offset + (uint64_t) rows * (uint64_t) h.ld * sizeof(double);
+    // extend without writing the data: the file system hands back zeros (sparse where supported)
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+    DWORD written = 0;
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG) size;
+    int ok = WriteFile(file, &h, sizeof(h), &written, NULL) && written == sizeof(h) &&
+             SetFilePointerEx(file, end, NULL, FILE_BEGIN) && SetEndOfFile(file);
+    CloseHandle(file);
+#else
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int ok = write(fd, &h, sizeof(h)) == (ssize_t) sizeof(h) && ftruncate(fd, (off_t) size) == 0;
+    if (close(fd) != 0) ok = 0;
+#endif
+    return ok ? 0 : -1;
+}
+
+// ---------- Mapping ----------
+int matrix_file_info(const char *path, MatrixFileHeader *out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    MatrixFileHeader h;
+    const int got = fread(&h, sizeof(h), 1, f) == 1;
+    fclose(f);
+    if (!got || memcmp(h.magic, file_magic, sizeof(h.magic)) != 0) return -1;
+    if (h.version != MM_FILE_VERSION || h.endian != MM_FILE_ENDIAN_TAG || h.layout != MM_LAYOUT_ROW_MAJOR)
+        return -1;
+    const size_t elem = h.dtype == MM_DTYPE_F64 ? sizeof(double) : h.dtype == MM_DTYPE_F32 ? sizeof(float) : 0;
+    if (elem == 0 || h.rows <= 0 || h.cols <= 0 || h.rows > INT_MAX || h.cols > INT_MAX || h.ld < h.cols ||
+        h.ld > INT_MAX)
+        return -1;
+    // zero-copy only works if every row is already aligned in the file
+    if (h.data_offset < MM_FILE_HEADER_BYTES || h.data_offset % MATRIX_ALIGN != 0 ||
+        ((uint64_t) h.ld * elem) % MATRIX_ALIGN != 0)
+        return -1;
+    // data_offset + rows * ld * elem must fit a size_t mapping length and an off_t file size; half of
+    // SIZE_MAX leaves room for the lead a mapping adds in front
+    const uint64_t limit = (uint64_t) (SIZE_MAX / 2) < (uint64_t) INT64_MAX ? (uint64_t) (SIZE_MAX / 2)
+                                                                            : (uint64_t) INT64_MAX;
+    if (h.data_offset > limit || (uint64_t) h.rows > (limit - h.data_offset) / ((uint64_t) h.ld * elem)) return -1;
+    *out = h;
+    return 0;
+}
+
+// Maps the data section of a validated file; returns a pointer to element (0,0)
+static void *map_data(const char *path, const MatrixFileHeader *h, size_t elem, int flags) {
+    const size_t gran = map_granularity();
+    const uint64_t map_off = h->data_offset / gran * gran;
+    const size_t lead = (size_t) (h->data_offset - map_off);
+    const size_t bytes = lead + (size_t) h->rows * (size_t) h->ld * elem;
+    const int writable = (flags & MM_MAP_WRITE) != 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (uint64_t) size.QuadPart < map_off + bytes) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+    // the view keeps the mapping alive after its handle is closed
+    char *base = (char*) MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                       (DWORD) (map_off >> 32), (DWORD) (map_off & 0xffffffffu), bytes);
+    CloseHandle(mapping);
+    if (!base) return NULL;
+    if (flags & MM_MAP_POPULATE) {
+        volatile char sink = 0;
+        for (size_t off = 0; off < bytes; off += 4096) sink += base[off];
+        (void) sink;
+    }
+    return base + lead;
+#else
+    int fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < map_off + bytes) {
+        close(fd);
+        return NULL;
+    }
+    int mflags = MAP_SHARED;
+  #ifdef MAP_POPULATE
+    if (flags & MM_MAP_POPULATE) mflags |= MAP_POPULATE;
+  #endif
+    char *base = (char*) mmap(NULL, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, mflags, fd, (off_t) map_off);
+    close(fd);   // the mapping holds its own reference to the file
+    if (base == MAP_FAILED) return NULL;
+  #ifndef MAP_POPULATE
+    if (flags & MM_MAP_POPULATE) {
+        volatile char sink = 0;
+        for (size_t off = 0; off < bytes; off += 4096) sink += base[off];
+        (void) sink;
+    }
+  #endif
+    return base + lead;
+#endif
+}
+
+void matrix_unmap_data(void *data, size_t bytes) {
+    // the mapping starts at the granularity boundary at or below element (0,0)
+    const size_t gran = map_granularity();
+    char *base = (char*) ((uintptr_t) data / gran * gran);
+#ifdef _WIN32
+    (void) bytes;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, (size_t) ((char*) data - base) + bytes);
+#endif
+}
+
+Matrix matrix_map(const char *path, int flags) {
+    Matrix M = {0};
+    MatrixFileHeader h;
+    if (matrix_file_info(path, &h) != 0 || h.dtype != MM_DTYPE_F64) return M;
+    double *data = (double*) map_data(path, &h, sizeof(double), flags);
+    if (!data) return M;
+    M.data = data;
+    M.rows = (int) h.rows;
+    M.cols = (int) h.cols;
+    M.ld = (int) h.ld;
+    M.owns = MM_OWNS_MAPPED;
+    return M;
+}
+
+MatrixF matrix_map_f(const char *path, int flags) {
+    MatrixF M = {0};
+    MatrixFileHeader h;
+    if (matrix_file_info(path, &h) != 0 || h.dtype != MM_DTYPE_F32) return M;
+    float *data = (float*) map_data(path, &h, sizeof(float), flags);
+    if (!data) return M;
+    M.data = data;
+    M.rows = (int) h.rows;
+    M.cols = (int) h.cols;
+    M.ld = (int) h.ld;
+    M.owns = MM_OWNS_MAPPED;
+    return M;
+}
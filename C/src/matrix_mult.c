@@ -1,20 +1,364 @@
 #include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
 
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#ifdef _WIN32
+  #include <malloc.h>
+#endif
+
+// ---------- Aligned memory ----------
+// Every block carries one MATRIX_ALIGN-sized header in front of the caller's
+// bytes holding the requested size, so aligned_free can keep the counters exact
+static atomic_size_t alloc_current;
+static atomic_size_t alloc_peak;
+static atomic_size_t alloc_total;
+static atomic_long alloc_count;
+
+void matrix_alloc_account(size_t bytes, int sign) {
+    if (sign < 0) {
+        atomic_fetch_sub_explicit(&alloc_current, bytes, memory_order_relaxed);
+        return;
+    }
+    const size_t now = atomic_fetch_add_explicit(&alloc_current, bytes, memory_order_relaxed) + bytes;
+    atomic_fetch_add_explicit(&alloc_total, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    size_t peak = atomic_load_explicit(&alloc_peak, memory_order_relaxed);
+    while (now > peak && !atomic_compare_exchange_weak_explicit(&alloc_peak, &peak, now,
+                                                                memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void *aligned_malloc(size_t bytes) {
+    if (bytes == 0) bytes = MATRIX_ALIGN;
+    if (bytes > SIZE_MAX - MATRIX_ALIGN) return NULL;
+#ifdef _WIN32
+    char *p = (char*) _aligned_malloc(bytes + MATRIX_ALIGN, MATRIX_ALIGN);
+    if (!p) return NULL;
+#else
+    void *raw = NULL;
+    if (posix_memalign(&raw, MATRIX_ALIGN, bytes + MATRIX_ALIGN) != 0) return NULL;
+    char *p = (char*) raw;
+#endif
+    *(size_t*) p = bytes;
+    matrix_alloc_account(bytes, 1);
+    return p + MATRIX_ALIGN;
+}
+
+void aligned_free(void *p) {
+    if (!p) return;
+    char *base = (char*) p - MATRIX_ALIGN;
+    matrix_alloc_account(*(size_t*) base, -1);
+#ifdef _WIN32
+    _aligned_free(base);
+#else
+    free(base);
+#endif
+}
+
+MatrixAllocStats matrix_alloc_stats(void) {
+    MatrixAllocStats s;
+    s.current_bytes = atomic_load_explicit(&alloc_current, memory_order_relaxed);
+    s.peak_bytes = atomic_load_explicit(&alloc_peak, memory_order_relaxed);
+    s.total_bytes = atomic_load_explicit(&alloc_total, memory_order_relaxed);
+    s.allocations = atomic_load_explicit(&alloc_count, memory_order_relaxed);
+    return s;
+}
+
+void matrix_alloc_stats_reset(void) {
+    atomic_store_explicit(&alloc_peak, atomic_load_explicit(&alloc_current, memory_order_relaxed),
+                          memory_order_relaxed);
+    atomic_store_explicit(&alloc_total, 0, memory_order_relaxed);
+    atomic_store_explicit(&alloc_count, 0, memory_order_relaxed);
+}
+
+// ---------- Contiguous matrix API ----------
+Matrix matrix_alloc(int rows, int cols) {
+    Matrix M = {0};
+    if (rows <= 0 || cols <= 0) return M;
+    int ld = padded_ld(cols);
+    double *data = (double*) aligned_malloc((size_t)rows * (size_t)ld * sizeof(double));
+    if (!data) return M;
+    M.data = data;
+    M.rows = rows;
+    M.cols = cols;
+    M.ld = ld;
+    M.owns = MM_OWNS_HEAP;
+    return M;
+}
+
+void matrix_free(Matrix *M) {
+    if (M->owns == MM_OWNS_MAPPED) matrix_unmap_data(M->data, (size_t) M->rows * M->ld * sizeof(double));
+    else if (M->owns) aligned_free(M->data);
+    M->data = NULL;
+    M->rows = M->cols = M->ld = 0;
+    M->owns = 0;
+}
+
+Matrix matrix_view(const Matrix *M, int r0, int c0, int rows, int cols) {
+    Matrix V = *M;
+    V.data = &MAT_AT(M, r0, c0);
+    V.rows = rows;
+    V.cols = cols;
+    V.owns = 0;
+    return V;
+}
+
+void matrix_zero(Matrix *M) {
+    for (int i = 0; i < M->rows; i++) {
+        memset(&MAT_AT(M, i, 0), 0, (size_t)M->cols * sizeof(double));
+    }
+}
+
+int matrix_check_shapes(const Matrix *A, const Matrix *B, const Matrix *C) {
+    if (!A->data || !B->data || !C->data) return -1;
+    if (A->cols != B->rows || C->rows != A->rows || C->cols != B->cols) return -1;
+    return 0;
+}
+
+void matrix_multiply_naive(const Matrix *A, const Matrix *B, Matrix *C) {
+    const int m = A->rows, k = A->cols, n = B->cols;
+    const size_t ldb = (size_t) B->ld;
+    for (int i = 0; i < m; i++) {
+        const double *Ai = &MAT_AT(A, i, 0);
+        double *Ci = &MAT_AT(C, i, 0);
+        for (int j = 0; j < n; j++) {
+            const double *Bj = B->data + j;
+            double sum = 0.0;
+            for (int p = 0; p < k; p++) {
+                sum += Ai[p] * Bj[p * ldb];
+            }
+            Ci[j] = sum;
+        }
+    }
+}
+
+void matrix_multiply_ikj(const Matrix *A, const Matrix *B, Matrix *C) {
+    const int m = A->rows, k = A->cols, n = B->cols;
+    matrix_zero(C);
+    for (int i = 0; i < m; i++) {
+        const double *Ai = &MAT_AT(A, i, 0);
+        double *restrict Ci = &MAT_AT(C, i, 0);
+        for (int p = 0; p < k; p++) {
+            const double a = Ai[p];
+            const double *restrict Bp = &MAT_AT(B, p, 0);
+            for (int j = 0; j < n; j++) {
+                Ci[j] += a * Bp[j];
+            }
+        }
+    }
+}
+
+void matrix_transpose(const Matrix *B, Matrix *BT) {
+    const int tile = 32;
+    for (int ii = 0; ii < B->rows; ii += tile) {
+        const int iend = ii + tile < B->rows ? ii + tile : B->rows;
+        for (int jj = 0; jj < B->cols; jj += tile) {
+            const int jend = jj + tile < B->cols ? jj + tile : B->cols;
+            for (int i = ii; i < iend; i++)
+                for (int j = jj; j < jend; j++)
+                    MAT_AT(BT, j, i) = MAT_AT(B, i, j);
+        }
+    }
+}
+
+void matrix_multiply_transposed(const Matrix *A, const Matrix *BT, Matrix *C) {
+    const int m = A->rows, k = A->cols, n = BT->rows;
+    for (int i = 0; i < m; i++) {
+        const double *Ai = &MAT_AT(A, i, 0);
+        double *Ci = &MAT_AT(C, i, 0);
+        for (int j = 0; j < n; j++) {
+            const double *BTj = &MAT_AT(BT, j, 0);
+            double sum = 0.0;
+            for (int p = 0; p < k; p++) {
+                sum += Ai[p] * BTj[p];
+            }
+            Ci[j] = sum;
+        }
+    }
+}
+
+// ---------- Cache blocking ----------
+static MatrixTiles g_tiles = { 64, 128, 512 };
+
+MatrixTiles matrix_get_tiles(void) {
+    return g_tiles;
+}
+
+void matrix_set_tiles(MatrixTiles t) {
+    if (t.mc > 0 && t.kc > 0 && t.nc > 0) g_tiles = t;
+}
+
+void matrix_multiply_blocked(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles) {
+    const MatrixTiles t = tiles ? *tiles : g_tiles;
+    const int m = A->rows, k = A->cols, n = B->cols;
+    matrix_zero(C);
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            for (int ic = 0; ic < m; ic += t.mc) {
+                const int mb = min_int(t.mc, m - ic);
+                for (int i = ic; i < ic + mb; i++) {
+                    const double *Ai = &MAT_AT(A, i, pc);
+                    double *restrict Ci = &MAT_AT(C, i, jc);
+                    for (int p = 0; p < kb; p++) {
+                        const double a = Ai[p];
+                        const double *restrict Bp = &MAT_AT(B, pc + p, jc);
+                        for (int j = 0; j < nb; j++) {
+                            Ci[j] += a * Bp[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+MatrixTiles matrix_autotune_tiles(int n) {
+    static const int mcs[] = { 32, 64, 128 };
+    static const int kcs[] = { 64, 128, 256 };
+    static const int ncs[] = { 256, 512, 1024 };
+    MatrixTiles best = g_tiles;
+
+    Matrix A = matrix_alloc(n, n);
+    Matrix B = matrix_alloc(n, n);
+    Matrix C = matrix_alloc(n, n);
+    if (!A.data || !B.data || !C.data) goto done;
+    matrix_fill_random(&A);
+    matrix_fill_random(&B);
+
+    double best_time = -1.0;
+    for (size_t a = 0; a < sizeof(mcs) / sizeof(mcs[0]); a++)
+        for (size_t b = 0; b < sizeof(kcs) / sizeof(kcs[0]); b++)
+            for (size_t c = 0; c < sizeof(ncs) / sizeof(ncs[0]); c++) {
+                MatrixTiles t = { mcs[a], kcs[b], ncs[c] };
+                // best of two to filter out one-off noise
+                double elapsed = -1.0;
+                for (int rep = 0; rep < 2; rep++) {
+                    double t0 = wall_seconds();
+                    matrix_multiply_blocked(&A, &B, &C, &t);
+                    double e = wall_seconds() - t0;
+                    if (elapsed < 0 || e < elapsed) elapsed = e;
+                }
+                if (best_time < 0 || elapsed < best_time) {
+                    best_time = elapsed;
+                    best = t;
+                }
+            }
+    g_tiles = best;
+
+done:
+    matrix_free(&A);
+    matrix_free(&B);
+    matrix_free(&C);
+    return best;
+}
+
+// ---------- Kernel selection ----------
+static const char *const kernel_names[MM_KERNEL_COUNT] = {
+    "naive",
+    "ikj",
+    "transposed",
+    "blocked",
+    "simd",
+    "fixed",
+    "strassen",
+    "packed",
+    "auto",
+};
+
+const char *matrix_kernel_name(MatrixKernel k) {
+    if (k < 0 || k >= MM_KERNEL_COUNT) return "unknown";
+    return kernel_names[k];
+}
+
+int matrix_kernel_from_name(const char *name, MatrixKernel *out) {
+    for (int k = 0; k < MM_KERNEL_COUNT; k++) {
+        if (strcmp(name, kernel_names[k]) == 0) {
+            *out = (MatrixKernel) k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void matrix_multiply_with(MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C) {
+    matrix_multiply_with_tiles(k, A, B, C, NULL);
+}
+
+void matrix_multiply_with_tiles(MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C,
+                                const MatrixTiles *tiles) {
+    switch (k) {
+    case MM_KERNEL_IKJ:
+        matrix_multiply_ikj(A, B, C);
+        break;
+    case MM_KERNEL_TRANSPOSED: {
+        Matrix BT = matrix_alloc(B->cols, B->rows);
+        if (!BT.data) {
+            matrix_multiply_naive(A, B, C);
+            break;
+        }
+        matrix_transpose(B, &BT);
+        matrix_multiply_transposed(A, &BT, C);
+        matrix_free(&BT);
+        break;
+    }
+    case MM_KERNEL_BLOCKED:
+        matrix_multiply_blocked(A, B, C, tiles);
+        break;
+    case MM_KERNEL_FIXED:
+        if (matrix_multiply_fixed(A, B, C) != 0) matrix_multiply_simd(A, B, C, tiles);
+        break;
+    case MM_KERNEL_STRASSEN:
+        if (matrix_multiply_strassen(NULL, NULL, A, B, C) != 0) matrix_multiply_simd(A, B, C, tiles);
+        break;
+    case MM_KERNEL_SIMD:
+        matrix_multiply_simd(A, B, C, tiles);
+        break;
+    case MM_KERNEL_PACKED:
+        matrix_multiply_packed(A, B, C, tiles);
+        break;
+    case MM_KERNEL_AUTO:
+        // the table's kernel, tiles and thread count; tiles passed here do not apply
+        matrix_multiply_parallel(NULL, MM_KERNEL_AUTO, A, B, C);
+        break;
+    case MM_KERNEL_NAIVE:
+    default:
+        matrix_multiply_naive(A, B, C);
+        break;
+    }
+}
+
+// ---------- Legacy double** API ----------
 double** allocate_matrix(int n) {
     double** M = (double**) malloc(n * sizeof(double*));
+    if (!M) return NULL;
+    int ld = padded_ld(n);
+    double* block = (double*) aligned_malloc((size_t)n * (size_t)ld * sizeof(double));
+    if (!block) {
+        free(M);
+        return NULL;
+    }
     for (int i = 0; i < n; i++) {
-        M[i] = (double*) malloc(n * sizeof(double));
+        M[i] = block + (size_t)i * ld;
     }
     return M;
 }
 
 void free_matrix(double** M, int n) {
-    for (int i = 0; i < n; i++) {
-        free(M[i]);
-    }
+    if (!M) return;
+    if (n > 0) aligned_free(M[0]);
     free(M);
 }
 
+void fill_random(double** M, int n) {
+    const uint64_t stream = matrix_next_stream();
+    for (int i = 0; i < n; i++) matrix_random_row(stream, i, 0, n, M[i]);
+}
+
 void matrix_multiply(double** A, double** B, double** C, int n) {
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
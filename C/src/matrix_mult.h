@@ -0,0 +1,495 @@
+#ifndef MATRIX_MULT_H
+#define MATRIX_MULT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "thread_pool.h"
+
+// Alignment (bytes) of every buffer handed out by matrix_alloc
+#define MATRIX_ALIGN 64
+
+// Row-major matrix backed by one contiguous aligned buffer.
+// Element (i,j) lives at data[i*ld + j]; ld >= cols is padded so every row
+// starts on a MATRIX_ALIGN boundary.
+typedef struct {
+    double *data;
+    int rows;
+    int cols;
+    int ld;
+    int owns;   // non-zero if matrix_free must release data (MM_OWNS_*)
+} Matrix;
+
+#define MM_OWNS_HEAP 1     // aligned_malloc block
+#define MM_OWNS_MAPPED 2   // file mapping from matrix_map
+
+#define MAT_AT(M, i, j) ((M)->data[(size_t)(i) * (size_t)(M)->ld + (size_t)(j)])
+
+// ---------- Aligned memory ----------
+void *aligned_malloc(size_t bytes);
+void aligned_free(void *p);
+
+// Bytes handed out by aligned_malloc (plus arena chunks mapped directly), kept
+// by process-wide counters; file mappings from matrix_map are not included
+typedef struct {
+    size_t current_bytes;   // live right now
+    size_t peak_bytes;      // high-water mark of current_bytes since the last reset
+    size_t total_bytes;     // allocated since the last reset, frees not subtracted
+    long allocations;       // blocks allocated since the last reset
+} MatrixAllocStats;
+
+MatrixAllocStats matrix_alloc_stats(void);
+// Restart the peak at the current level and zero the totals
+void matrix_alloc_stats_reset(void);
+
+// ---------- Contiguous matrix API ----------
+// On failure the returned matrix has data == NULL.
+Matrix matrix_alloc(int rows, int cols);
+void matrix_free(Matrix *M);
+// Non-owning window of rows x cols starting at (r0, c0); shares M's storage and ld
+Matrix matrix_view(const Matrix *M, int r0, int c0, int rows, int cols);
+void matrix_zero(Matrix *M);
+
+// ---------- Random fill ----------
+// Uniform [0, 1) values from the counter-based Philox4x32-10 generator. Each
+// fill draws from its own stream, and element (i, j) of a stream depends only on
+// the seed, the stream and (i, j): not on ld, the pool size or the fill order.
+// Fills made in the same order after the same matrix_set_seed are identical.
+// Sets the seed (default 0) and restarts the stream numbering at 0
+void matrix_set_seed(uint64_t seed);
+uint64_t matrix_get_seed(void);
+// Hands out stream numbers 0, 1, 2, ... (thread-safe); every fill below takes one
+uint64_t matrix_next_stream(void);
+void matrix_fill_random(Matrix *M);
+// Same values as matrix_fill_random, rows spread over the pool (NULL: calling thread)
+void matrix_fill_random_parallel(ThreadPool *pool, Matrix *M);
+// Fills M with the window at (row0, col0) of the given stream, for example one
+// rank's block of a distributed matrix
+void matrix_fill_random_at(ThreadPool *pool, Matrix *M, uint64_t stream, int row0, int col0);
+// Stream of operand 0 (A) or 1 (B) of an m x k times k x n benchmark input:
+// fixed by the shape, so a size gets the same matrices whatever was filled
+// before it, in the C sweep and in the Java and Python native runs alike.
+// Outside the numbers matrix_next_stream hands out; distinct for dimensions
+// below 2^20.
+uint64_t matrix_input_stream(int m, int k, int n, int operand);
+// One Philox4x32-10 block: 128 random bits for a counter and key
+void matrix_philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+// C = A * B with the classic i-j-k loop (A: m x k, B: k x n, C: m x n)
+void matrix_multiply_naive(const Matrix *A, const Matrix *B, Matrix *C);
+
+// C = A * B with the i-k-j order: the inner loop streams rows of B and C
+void matrix_multiply_ikj(const Matrix *A, const Matrix *B, Matrix *C);
+
+// BT = B^T (BT must be B->cols x B->rows)
+void matrix_transpose(const Matrix *B, Matrix *BT);
+// C = A * B given BT = B^T, so both operands are read row-wise
+void matrix_multiply_transposed(const Matrix *A, const Matrix *BT, Matrix *C);
+
+// ---------- Cache blocking ----------
+// mc: rows of A per block (L2), kc: shared depth (L1), nc: cols of B (L3)
+typedef struct {
+    int mc;
+    int kc;
+    int nc;
+} MatrixTiles;
+
+MatrixTiles matrix_get_tiles(void);
+void matrix_set_tiles(MatrixTiles t);
+// Times a grid of candidate tiles on an n x n problem, installs and returns the fastest
+MatrixTiles matrix_autotune_tiles(int n);
+
+// C = A * B, tiled; tiles == NULL uses the current matrix_get_tiles()
+void matrix_multiply_blocked(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles);
+
+// ---------- SIMD micro-kernels ----------
+// Instruction sets with a register-blocked micro-kernel, in order of preference
+typedef enum {
+    MM_ISA_SCALAR,
+    MM_ISA_NEON,     // AArch64, 4x8 tile
+    MM_ISA_AVX2,     // AVX2 + FMA, 6x8 tile
+    MM_ISA_AVX512,   // AVX-512F, 6x16 tile
+    MM_ISA_COUNT
+} MatrixIsa;
+
+// Best instruction set of the running CPU (cpuid / hwcaps, detected on first call)
+MatrixIsa matrix_simd_isa(void);
+// Force a specific ISA; returns -1 if this CPU does not support it
+int matrix_simd_set_isa(MatrixIsa isa);
+const char *matrix_isa_name(MatrixIsa isa);
+int matrix_isa_from_name(const char *name, MatrixIsa *out);
+
+// C = A * B, tiled like matrix_multiply_blocked with a SIMD micro-kernel inside each tile
+void matrix_multiply_simd(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles);
+
+// ---------- Packed panels ----------
+// GotoBLAS-style blocking: every kc x nc block of B and mc x kc block of A is
+// copied into contiguous micro-panels (NR columns of B / MR rows of A,
+// interleaved along k and zero-padded at the edges) before the micro-kernel
+// runs. The kernel then reads two unit-stride streams whatever ld is, which
+// avoids the TLB misses and cache-set conflicts of power-of-two sizes.
+void matrix_multiply_packed(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles);
+
+// B packed once for products that reuse the same right-hand side. The panel
+// layout belongs to the tiles and micro-kernel in use when it was packed.
+typedef struct {
+    double *data;        // NULL on failure
+    int rows;            // k
+    int cols;            // n
+    MatrixTiles tiles;   // kc x nc blocks (mc sizes the row blocks of A)
+    MatrixIsa isa;       // micro-kernel the panels are laid out for
+} MatrixPacked;
+
+// tiles == NULL uses the current matrix_get_tiles()
+MatrixPacked matrix_pack_b(const Matrix *B, const MatrixTiles *tiles);
+void matrix_packed_free(MatrixPacked *P);
+// C = A * B with B from matrix_pack_b; A is packed on the fly. Row blocks of
+// C are spread over the pool (NULL: calling thread), each worker reusing one
+// packing buffer. Returns -1 on a shape mismatch or when out of memory.
+int matrix_multiply_prepacked(ThreadPool *pool, const Matrix *A, const MatrixPacked *B, Matrix *C);
+
+// ---------- General GEMM ----------
+typedef enum {
+    MM_NO_TRANS = 0,
+    MM_TRANS = 1
+} MatrixTranspose;
+
+// C = alpha * op(A) * op(B) + beta * C on row-major buffers, BLAS style:
+// op(A) is m x k, op(B) is k x n, and lda/ldb/ldc are the row strides of the
+// stored arrays, so any sub-block of a larger buffer can be used in place.
+// beta == 0 ignores the previous contents of C. Returns -1 on bad arguments.
+int matrix_dgemm(MatrixTranspose ta, MatrixTranspose tb, int m, int n, int k, double alpha,
+                 const double *A, int lda, const double *B, int ldb, double beta, double *C, int ldc);
+// matrix_dgemm on Matrix operands (or matrix_view windows); checks the shapes
+int matrix_gemm(MatrixTranspose ta, MatrixTranspose tb, double alpha, const Matrix *A, const Matrix *B,
+                double beta, Matrix *C);
+
+// ---------- Fixed-size kernels ----------
+// Square products of size 4, 8, 16, 32 and 64 have kernels compiled with the
+// size as a constant, so their loops are fully unrolled.
+// Non-zero if an m x k times k x n product has a specialized kernel
+int matrix_fixed_supported(int m, int k, int n);
+// C = A * B with the specialized kernel; returns -1 (C untouched) if none matches
+int matrix_multiply_fixed(const Matrix *A, const Matrix *B, Matrix *C);
+
+// ---------- Kernel selection ----------
+typedef enum {
+    MM_KERNEL_NAIVE,
+    MM_KERNEL_IKJ,
+    MM_KERNEL_TRANSPOSED,   // transposes B on every call; see matrix_multiply_transposed
+    MM_KERNEL_BLOCKED,
+    MM_KERNEL_SIMD,
+    MM_KERNEL_FIXED,        // size-specialized kernel when one matches, otherwise SIMD
+    MM_KERNEL_STRASSEN,     // Strassen-Winograd recursion over matrix_get_strassen().base
+    MM_KERNEL_PACKED,       // SIMD micro-kernel on packed panels; see matrix_multiply_packed
+    MM_KERNEL_AUTO,         // kernel, tiles and threading from the tuning table; see matrix_tune_choice
+    MM_KERNEL_COUNT
+} MatrixKernel;
+
+const char *matrix_kernel_name(MatrixKernel k);
+// Returns 0 and sets *out on success, -1 if the name is unknown
+int matrix_kernel_from_name(const char *name, MatrixKernel *out);
+void matrix_multiply_with(MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C);
+
+// Returns 0 if C (m x n) = A (m x k) * B (k x n) is well formed, -1 otherwise
+int matrix_check_shapes(const Matrix *A, const Matrix *B, const Matrix *C);
+
+// ---------- Tuning tables ----------
+// What MM_KERNEL_AUTO runs for products around one size (cube root of m*k*n).
+// A table is measured per host (the benchmark's --tune) and saved as a small
+// text file. The first MM_KERNEL_AUTO multiply loads the default file; with
+// no usable file it falls back to a built-in choice.
+typedef struct {
+    int size;              // size class the entry was measured at
+    MatrixKernel kernel;   // never MM_KERNEL_AUTO
+    MatrixTiles tiles;
+    int threads;           // fastest pool size; 1 runs on the calling thread, more on a library-owned pool
+} MatrixTuneEntry;
+
+#define MM_TUNE_MAX_CLASSES 16
+
+typedef struct {
+    char cpu[128];   // matrix_cpu_model() of the host it was measured on
+    int count;
+    MatrixTuneEntry classes[MM_TUNE_MAX_CLASSES];   // ascending size
+} MatrixTuneTable;
+
+// CPU model string of this host (x86 brand string or /proc/cpuinfo), "unknown" if neither
+const char *matrix_cpu_model(void);
+// MATMUL_TUNE_FILE if set, else <cache dir>/matmul/tune-<hostname>.txt; -1 if no directory is known
+int matrix_tune_default_path(char *out, size_t size);
+// Returns -1 if the file is missing, malformed or was measured on another CPU model
+int matrix_tune_load(const char *path, MatrixTuneTable *out);
+// Creates missing parent directories; returns -1 on I/O errors
+int matrix_tune_save(const char *path, const MatrixTuneTable *table);
+// Installs table for MM_KERNEL_AUTO (NULL: built-in choice) instead of the default file
+void matrix_tune_set(const MatrixTuneTable *table);
+// Non-zero if MM_KERNEL_AUTO dispatches by a table (loading the default file if not done yet)
+int matrix_tune_active(void);
+// Entry MM_KERNEL_AUTO uses for an m x k times k x n product: the class closest in size
+MatrixTuneEntry matrix_tune_choice(int m, int k, int n);
+
+// ---------- Multithreading ----------
+// C = A * B with tiles of C spread over the pool by work stealing; each tile
+// runs kernel k. Shapes may be rectangular. pool == NULL runs on the calling
+// thread. MM_KERNEL_AUTO ignores pool and runs on the tuning table's thread
+// count instead (an unpinned pool the library keeps, shared by all callers).
+// Returns -1 (and leaves C untouched) if the shapes do not match.
+int matrix_multiply_parallel(ThreadPool *pool, MatrixKernel k, const Matrix *A, const Matrix *B,
+                             Matrix *C);
+// Parallel matrix_multiply_transposed: BT = B^T prepared by the caller
+int matrix_multiply_parallel_transposed(ThreadPool *pool, const Matrix *A, const Matrix *BT, Matrix *C);
+// C = alpha * A * B + beta * C (matrix_gemm) on tiles of C spread over the pool,
+// e.g. to accumulate panel products; -1 if the shapes do not match
+int matrix_gemm_parallel(ThreadPool *pool, double alpha, const Matrix *A, const Matrix *B, double beta, Matrix *C);
+// Zeroes M with worker w itself writing the w-th of thread_pool_size(pool)
+// row slabs (thread_pool_run_each, no stealing). Called on a fresh
+// matrix_alloc buffer, Linux's first-touch policy then leaves each slab's
+// pages on worker w's NUMA node. The parallel drivers start worker w on the
+// same rows but may steal, so this places most pages well, not all.
+void matrix_first_touch(ThreadPool *pool, Matrix *M);
+
+// ---------- Batched multiply ----------
+// C[i] = A[i] * B[i] for i < count in one call. Runs of up to 8 consecutive
+// products with the same small shape (every dimension <= 64) are interleaved
+// element-wise so each SIMD lane works on a different matrix; other products
+// use the SIMD kernel. Groups are spread over the pool (NULL: calling thread).
+// Returns -1 if any shape does not match.
+int matrix_multiply_batch(ThreadPool *pool, const Matrix *A, const Matrix *B, Matrix *C, int count);
+// Same with one strided layout: product i reads A + i*stride_a, B + i*stride_b
+// and writes C + i*stride_c (strides in elements), all m x k times k x n
+int matrix_dgemm_batch_strided(ThreadPool *pool, int m, int n, int k,
+                               const double *A, int lda, size_t stride_a,
+                               const double *B, int ldb, size_t stride_b,
+                               double *C, int ldc, size_t stride_c, int count);
+
+// ---------- Asynchronous multiply ----------
+// An executor owns a dispatcher thread that takes submitted multiplies in
+// order and runs them on the pool: a large product gets the whole pool, a run
+// of small ones (up to 128^3 multiply-adds each) is spread one per worker.
+// The pool must not be used by anyone else while the executor exists.
+typedef struct MatrixExecutor MatrixExecutor;
+typedef struct MatrixFuture MatrixFuture;
+
+// NULL if the dispatcher thread cannot be started
+MatrixExecutor *matrix_executor_create(ThreadPool *pool);
+// Finishes every queued request, then stops the dispatcher
+void matrix_executor_destroy(MatrixExecutor *ex);
+
+// Queues C = A * B with kernel k and returns at once. A, B and C must stay
+// valid (and C untouched) until the future has been waited on. Returns NULL
+// on a shape mismatch or when out of memory.
+MatrixFuture *matrix_submit(MatrixExecutor *ex, MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C);
+// Non-zero once the result is in C; never blocks
+int matrix_future_poll(const MatrixFuture *f);
+// Blocks until done, releases the future and returns the multiply's status
+// (0 or -1). Every future must be waited on exactly once.
+int matrix_future_wait(MatrixFuture *f);
+
+// ---------- Arena allocation ----------
+// Bump allocator for matrix buffers. Memory comes in large chunks that are kept
+// across matrix_arena_reset(), so a whole batch is released in O(1) and the next
+// batch reuses the same pages. Not thread-safe: use one arena per thread.
+typedef struct MatrixArena MatrixArena;
+
+// Back chunks of 2 MiB or more with huge pages when the OS allows it
+#define MM_ARENA_HUGE_PAGES 1
+
+// chunk_bytes == 0 selects a 64 MiB default; flags is 0 or MM_ARENA_HUGE_PAGES
+MatrixArena *matrix_arena_create(size_t chunk_bytes, int flags);
+void matrix_arena_destroy(MatrixArena *arena);
+// MATRIX_ALIGN-aligned block, or NULL when out of memory
+void *matrix_arena_alloc_bytes(MatrixArena *arena, size_t bytes);
+// Same layout as matrix_alloc; matrix_free on the result is a no-op
+Matrix matrix_arena_alloc(MatrixArena *arena, int rows, int cols);
+void matrix_arena_reset(MatrixArena *arena);
+// Stack-like partial release: matrix_arena_release frees everything allocated
+// after the matching matrix_arena_mark, keeping earlier allocations
+typedef struct {
+    void *chunk;
+    size_t used;
+} MatrixArenaMark;
+MatrixArenaMark matrix_arena_mark(const MatrixArena *arena);
+void matrix_arena_release(MatrixArena *arena, MatrixArenaMark mark);
+size_t matrix_arena_capacity(const MatrixArena *arena);
+// Non-zero if any chunk is backed by huge pages
+int matrix_arena_huge_pages(const MatrixArena *arena);
+
+// ---------- Single and mixed precision ----------
+// Float counterpart of Matrix: same layout, rows padded to MATRIX_ALIGN, and
+// MAT_AT works on it too. Half the bytes per element and twice the SIMD lanes.
+typedef struct {
+    float *data;
+    int rows;
+    int cols;
+    int ld;
+    int owns;
+} MatrixF;
+
+MatrixF matrix_alloc_f(int rows, int cols);
+void matrix_free_f(MatrixF *M);
+void matrix_zero_f(MatrixF *M);
+void matrix_fill_random_f(MatrixF *M);
+// Element-wise conversions between equally sized matrices
+void matrix_to_f(const Matrix *src, MatrixF *dst);
+void matrix_from_f(const MatrixF *src, Matrix *dst);
+
+// C = A * B in float throughout. pool == NULL runs on the calling thread.
+// Returns -1 if the shapes do not match.
+int matrix_multiply_f(ThreadPool *pool, const MatrixF *A, const MatrixF *B, MatrixF *C);
+// Mixed precision: float operands (half the memory traffic), products and
+// sums in double, double result
+int matrix_multiply_mixed(ThreadPool *pool, const MatrixF *A, const MatrixF *B, Matrix *C);
+
+// ---------- Matrix files ----------
+// Binary format: a 64-byte header followed by the rows, each padded to a
+// multiple of 64 bytes (ld elements), starting at data_offset (a multiple of
+// 64, past the header). Header and data are in the writer's byte order, which
+// the endian field records; a host of the other order rejects the file. The
+// padded layout is the in-memory one, so a file is mapped straight into a
+// Matrix without parsing or copying.
+#define MM_FILE_MAGIC { 'M', 'A', 'T', 'B', 'I', 'N', '\0', '\0' }
+#define MM_FILE_VERSION 1
+#define MM_FILE_HEADER_BYTES 64
+
+#define MM_DTYPE_F64 1
+#define MM_DTYPE_F32 2
+#define MM_LAYOUT_ROW_MAJOR 0
+
+typedef struct {
+    char magic[8];          // MM_FILE_MAGIC
+    uint32_t version;       // MM_FILE_VERSION
+    uint32_t dtype;         // MM_DTYPE_*
+    uint32_t layout;        // MM_LAYOUT_ROW_MAJOR
+    uint32_t endian;        // 0x01020304 in the writer's byte order
+    int64_t rows;
+    int64_t cols;
+    int64_t ld;             // elements between row starts
+    uint64_t data_offset;   // byte offset of element (0,0)
+    uint8_t reserved[8];
+} MatrixFileHeader;
+
+// Writes M (or a view) to path; returns -1 on I/O errors
+int matrix_save(const char *path, const Matrix *M);
+int matrix_save_f(const char *path, const MatrixF *M);
+// Creates a zero-filled rows x cols float64 file, e.g. as an output to map
+// with MM_MAP_WRITE or to fill with matrix_multiply_ooc; -1 on I/O errors
+int matrix_file_create(const char *path, int rows, int cols);
+// Reads and validates the header only; returns -1 if path is not a matrix file
+int matrix_file_info(const char *path, MatrixFileHeader *out);
+
+#define MM_MAP_WRITE 1      // writable shared mapping: stores go back to the file
+#define MM_MAP_POPULATE 2   // fault every page in now instead of on first touch
+
+// Maps a matrix file without copying; matrix_free unmaps it. On failure
+// (missing file, bad header, wrong dtype) the returned matrix has data == NULL.
+Matrix matrix_map(const char *path, int flags);
+MatrixF matrix_map_f(const char *path, int flags);
+
+// ---------- Out-of-core multiply ----------
+// C = A * B on float64 matrix files without holding any of them in memory.
+// Row panels of A and B are read into double buffers by a prefetch thread
+// while the pool multiplies the previous pair, and each finished row panel
+// of C is written back once.
+typedef struct {
+    double read_sec;          // prefetch thread time spent reading A and B
+    double wait_sec;          // time the multiply stalled waiting for a panel
+    double write_sec;         // time spent writing C panels
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    int panel_rows;           // rows of A / C per panel
+    int panel_depth;          // rows of B per panel
+} MatrixOocStats;
+
+// Creates (or replaces) c_path. mem_bytes bounds the panel buffers (0 = 1 GiB).
+// Returns -1 on unreadable or mismatched files, a budget too small for one
+// row of each panel, or I/O errors; a budget or input failure leaves an
+// existing c_path alone, a later failure removes the partial C. stats may be NULL.
+int matrix_multiply_ooc(ThreadPool *pool, const char *a_path, const char *b_path, const char *c_path,
+                        size_t mem_bytes, MatrixOocStats *stats);
+
+// ---------- Sparse matrices ----------
+// Compressed sparse row: the non-zeros of row i are values[row_ptr[i] ..
+// row_ptr[i+1]) in columns col_idx[...], ascending. Converters drop exact
+// zeros; on failure the returned matrix has row_ptr == NULL.
+typedef struct {
+    int rows;
+    int cols;
+    size_t nnz;
+    size_t *row_ptr;   // rows + 1 entries
+    int *col_idx;
+    double *values;
+} MatrixCsr;
+
+// Blocked CSR with dense MM_BSR_BLOCK x MM_BSR_BLOCK blocks: block row bi holds
+// blocks row_ptr[bi] .. row_ptr[bi+1]) at block columns col_idx[...], each
+// stored row-major in values. Edge blocks are padded with zeros.
+#define MM_BSR_BLOCK 4
+
+typedef struct {
+    int rows;
+    int cols;
+    size_t nblocks;
+    size_t *row_ptr;   // block rows + 1 entries
+    int *col_idx;
+    double *values;    // nblocks * MM_BSR_BLOCK^2
+} MatrixBsr;
+
+// Like matrix_fill_random, but each element is non-zero with probability density
+void matrix_fill_sparse_random(Matrix *M, double density);
+MatrixCsr matrix_to_csr(const Matrix *M);
+void matrix_csr_free(MatrixCsr *S);
+MatrixBsr matrix_to_bsr(const Matrix *M);
+void matrix_bsr_free(MatrixBsr *S);
+
+// C = A * B with sparse A and dense B and C. Rows are split over the pool
+// (NULL: calling thread) so that every task gets a similar number of
+// non-zeros. Returns -1 if the shapes do not match.
+int matrix_multiply_csr(ThreadPool *pool, const MatrixCsr *A, const Matrix *B, Matrix *C);
+int matrix_multiply_bsr(ThreadPool *pool, const MatrixBsr *A, const Matrix *B, Matrix *C);
+
+// ---------- Strassen-Winograd ----------
+// Recursive O(n^2.81) multiply: halves all three dimensions while each is above
+// cutoff, then runs the base kernel. Rounding error grows with the recursion
+// depth, so results differ from the classic kernels by more than a few ulps.
+typedef struct {
+    int cutoff;          // recurse only while m, k and n are all larger
+    MatrixKernel base;   // kernel for the leaf products (not MM_KERNEL_STRASSEN)
+} MatrixStrassen;
+
+MatrixStrassen matrix_get_strassen(void);
+void matrix_set_strassen(MatrixStrassen s);
+// Arena bytes the recursion needs for an m x k times k x n product
+size_t matrix_strassen_scratch_bytes(int m, int k, int n);
+// C = A * B. Temporaries come from arena (released again before returning);
+// arena == NULL uses a private one for the call. Leaf products run on the pool
+// when one is given. Returns -1 on a shape mismatch or when out of memory.
+int matrix_multiply_strassen(ThreadPool *pool, MatrixArena *arena, const Matrix *A, const Matrix *B, Matrix *C);
+
+// ---------- Foreign-language entry points ----------
+// Plain-pointer versions for callers that cannot build a Matrix (Python
+// ctypes, JNI, Java's foreign-function API). The buffers are row-major with
+// row strides lda/ldb/ldc in elements, belong to the caller and are used in
+// place, never copied.
+// C (m x n) = A (m x k) * B (k x n) with kernel on threads threads (<= 0:
+// thread_pool_default_threads()). More than one thread runs on the unpinned
+// pool the library keeps for MM_KERNEL_AUTO, which itself ignores threads;
+// calls sharing it are serialized. The caller's thread is never pinned. *sec (may be NULL) receives
+// the multiply's own time, so a caller can tell it from the cost of the call.
+// Returns -1 on bad arguments or a failed multiply.
+int matrix_multiply_buffers(MatrixKernel kernel, int threads, int m, int k, int n, const double *A, int lda,
+                            const double *B, int ldb, double *C, int ldc, double *sec);
+// matrix_fill_random_at on a rows x cols buffer: the same values as the C
+// benchmark's inputs for the same seed and stream. Returns -1 on bad arguments.
+int matrix_fill_buffer(double *data, int rows, int cols, int ld, uint64_t stream);
+// Stops the pool matrix_multiply_buffers and MM_KERNEL_AUTO keep; the next call restarts it
+void matrix_buffers_shutdown(void);
+
+// ---------- Legacy double** API ----------
+// Row pointers index into a single contiguous aligned block.
+double** allocate_matrix(int n);
+void free_matrix(double** M, int n);
+void fill_random(double** M, int n);
+void matrix_multiply(double** A, double** B, double** C, int n);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+  typedef HANDLE ooc_file;
+  #define OOC_NO_FILE INVALID_HANDLE_VALUE
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  typedef int ooc_file;
+  #define OOC_NO_FILE (-1)
+#endif
+
+#define OOC_DEFAULT_BUDGET ((size_t) 1 << 30)
+
+// ---------- Positioned file I/O ----------
+static ooc_file file_open(const char *path, int writable) {
+#ifdef _WIN32
+    return CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    return open(path, writable ? O_RDWR : O_RDONLY);
+#endif
+}
+
+static void file_close(ooc_file f) {
+    if (f == OOC_NO_FILE) return;
+#ifdef _WIN32
+    CloseHandle(f);
+#else
+    close(f);
+#endif
+}
+
+// Reads or writes exactly 'bytes' at 'offset' without moving a shared file
+// position, so the prefetch thread and the writer never race on it
+static int file_io(ooc_file f, int write, void *buf, size_t bytes, uint64_t offset) {
+    char *p = (char*) buf;
+    while (bytes > 0) {
+#ifdef _WIN32
+        const DWORD chunk = bytes > ((size_t) 1 << 30) ? (DWORD) 1 << 30 : (DWORD) bytes;
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD) (offset & 0xffffffffu);
+        ov.OffsetHigh = (DWORD) (offset >> 32);
+        DWORD done = 0;
+        const BOOL ok = write ? WriteFile(f, p, chunk, &done, &ov) : ReadFile(f, p, chunk, &done, &ov);
+        if (!ok || done == 0) return -1;
+        const size_t got = done;
+#else
+        const ssize_t r = write ? pwrite(f, p, bytes, (off_t) offset) : pread(f, p, bytes, (off_t) offset);
+        if (r <= 0) return -1;
+        const size_t got = (size_t) r;
+#endif
+        p += got;
+        offset += got;
+        bytes -= got;
+    }
+    return 0;
+}
+
+// ---------- Prefetch pipeline ----------
+// Item j is B panel p = j % panels_k for C panel i = j / panels_k, plus A panel
+// i when p == 0. Items go into two slots, so the reader runs one item ahead of
+// the multiply: it may load item j once item j - 2 has been consumed.
+typedef struct {
+    ooc_file fa, fb;
+    MatrixFileHeader ha, hb;
+    int mi, kp;                 // panel rows of A / C and of B
+    int panels_m, panels_k;
+    double *abuf[2];
+    double *bbuf[2];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    long loaded;                // items [0, loaded) are in their slots
+    long consumed;              // items [0, consumed) are no longer needed
+    int failed;
+    int stop;
+
+    double read_sec;            // written by the reader only
+    uint64_t bytes_read;
+} OocStream;
+
+static int read_rows(ooc_file f, const MatrixFileHeader *h, int r0, int rows, double *dst, uint64_t *bytes) {
+    const size_t row_bytes = (size_t) h->ld * sizeof(double);
+    *bytes += (uint64_t) rows * row_bytes;
+    return file_io(f, 0, dst, (size_t) rows * row_bytes, h->data_offset + (uint64_t) r0 * row_bytes);
+}
+
+static void *reader_main(void *arg) {
+    OocStream *s = (OocStream*) arg;
+    const long total = (long) s->panels_m * s->panels_k;
+    const int m = (int) s->ha.rows, k = (int) s->ha.cols;
+    for (long j = 0; j < total; j++) {
+        pthread_mutex_lock(&s->lock);
+        while (j - s->consumed >= 2 && !s->stop) pthread_cond_wait(&s->cond, &s->lock);
+        const int stop = s->stop;
+        pthread_mutex_unlock(&s->lock);
+        if (stop) break;
+
+        const int i = (int) (j / s->panels_k), p = (int) (j % s->panels_k);
+        const double t0 = wall_seconds();
+        int rc = read_rows(s->fb, &s->hb, p * s->kp, min_int(s->kp, k - p * s->kp), s->bbuf[j % 2], &s->bytes_read);
+        if (rc == 0 && p == 0)
+            rc = read_rows(s->fa, &s->ha, i * s->mi, min_int(s->mi, m - i * s->mi), s->abuf[i % 2], &s->bytes_read);
+        s->read_sec += wall_seconds() - t0;
+
+        pthread_mutex_lock(&s->lock);
+        if (rc != 0) s->failed = 1;
+        else s->loaded = j + 1;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        if (rc != 0) break;
+    }
+    return NULL;
+}
+
+// ---------- Driver ----------
+// Largest panels that fit the budget: two A and two B panels in flight plus one C panel
+// Removes a C file this call created but could not finish, so no zero-filled result is left behind
+static void file_remove(const char *path) {
+#ifdef _WIN32
+    DeleteFileA(path);
+#else
+    unlink(path);
+#endif
+}
+
+static int plan_panels(size_t budget, const MatrixFileHeader *ha, const MatrixFileHeader *hb, size_t ldc,
+                       int *mi, int *kp) {
+    const int m = (int) ha->rows, k = (int) ha->cols;
+    const size_t lda = (size_t) ha->ld, ldb = (size_t) hb->ld;
+    const size_t words = budget / sizeof(double);
+    size_t x = words / (2 * lda + 2 * ldb + ldc);
+    if (x == 0) return -1;
+    *mi = x < (size_t) m ? (int) x : m;
+    // whatever A and C leave over goes to deeper B panels
+    size_t rest = words - (size_t) *mi * (2 * lda + ldc);
+    x = rest / (2 * ldb);
+    *kp = x < (size_t) k ? (int) x : k;
+    return *kp > 0 ? 0 : -1;
+}
+
+int matrix_multiply_ooc(ThreadPool *pool, const char *a_path, const char *b_path, const char *c_path,
+                        size_t mem_bytes, MatrixOocStats *stats) {
+    OocStream s;
+    memset(&s, 0, sizeof(s));
+    s.fa = s.fb = OOC_NO_FILE;
+    if (matrix_file_info(a_path, &s.ha) != 0 || matrix_file_info(b_path, &s.hb) != 0) return -1;
+    if (s.ha.dtype != MM_DTYPE_F64 || s.hb.dtype != MM_DTYPE_F64 || s.ha.cols != s.hb.rows) return -1;
+    const int m = (int) s.ha.rows, k = (int) s.ha.cols, n = (int) s.hb.cols;
+
+    // planned before C is created: a budget that fits no panel must not replace an existing C
+    const size_t ldc = (size_t) padded_ld(n);
+    if (plan_panels(mem_bytes ? mem_bytes : OOC_DEFAULT_BUDGET, &s.ha, &s.hb, ldc, &s.mi, &s.kp) != 0) return -1;
+    MatrixFileHeader hc;
+    if (matrix_file_create(c_path, m, n) != 0) return -1;
+    if (matrix_file_info(c_path, &hc) != 0 || (size_t) hc.ld != ldc) {
+        file_remove(c_path);
+        return -1;
+    }
+    s.panels_m = (m + s.mi - 1) / s.mi;
+    s.panels_k = (k + s.kp - 1) / s.kp;
+
+    int rc = -1;
+    ooc_file fc = OOC_NO_FILE;
+    double *cbuf = NULL;
+    s.fa = file_open(a_path, 0);
+    s.fb = file_open(b_path, 0);
+    fc = file_open(c_path, 1);
+    if (s.fa == OOC_NO_FILE || s.fb == OOC_NO_FILE || fc == OOC_NO_FILE) goto done;
+    for (int b = 0; b < 2; b++) {
+        s.abuf[b] = (double*) aligned_malloc((size_t) s.mi * (size_t) s.ha.ld * sizeof(double));
+        s.bbuf[b] = (double*) aligned_malloc((size_t) s.kp * (size_t) s.hb.ld * sizeof(double));
+        if (!s.abuf[b] || !s.bbuf[b]) goto done;
+    }
+    cbuf = (double*) aligned_malloc((size_t) s.mi * ldc * sizeof(double));
+    if (!cbuf) goto done;
+
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.cond, NULL);
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, reader_main, &s) != 0) {
+        pthread_cond_destroy(&s.cond);
+        pthread_mutex_destroy(&s.lock);
+        goto done;
+    }
+
+    double wait_sec = 0.0, write_sec = 0.0;
+    uint64_t bytes_written = 0;
+    const long total = (long) s.panels_m * s.panels_k;
+    int failed = 0;
+    for (long j = 0; j < total && !failed; j++) {
+        const double w0 = wall_seconds();
+        pthread_mutex_lock(&s.lock);
+        while (s.loaded <= j && !s.failed) pthread_cond_wait(&s.cond, &s.lock);
+        failed = s.failed && s.loaded <= j;
+        pthread_mutex_unlock(&s.lock);
+        wait_sec += wall_seconds() - w0;
+        if (failed) break;
+
+        const int i = (int) (j / s.panels_k), p = (int) (j % s.panels_k);
+        const int mb = min_int(s.mi, m - i * s.mi), kb = min_int(s.kp, k - p * s.kp);
+        Matrix Ap = { s.abuf[i % 2], mb, k, (int) s.ha.ld, 0 };
+        Matrix Av = matrix_view(&Ap, 0, p * s.kp, mb, kb);
+        Matrix Bp = { s.bbuf[j % 2], kb, n, (int) s.hb.ld, 0 };
+        Matrix Cp = { cbuf, mb, n, (int) ldc, 0 };
+        matrix_gemm_parallel(pool, 1.0, &Av, &Bp, p == 0 ? 0.0 : 1.0, &Cp);
+
+        pthread_mutex_lock(&s.lock);
+        s.consumed = j + 1;
+        pthread_cond_broadcast(&s.cond);
+        pthread_mutex_unlock(&s.lock);
+
+        if (p == s.panels_k - 1) {
+            // the padding columns go out as well, so each panel is one contiguous write
+            const size_t bytes = (size_t) mb * ldc * sizeof(double);
+            for (int r = 0; r < mb; r++) memset(cbuf + (size_t) r * ldc + n, 0, (ldc - (size_t) n) * sizeof(double));
+            const double t0 = wall_seconds();
+            failed = file_io(fc, 1, cbuf, bytes, hc.data_offset + (uint64_t) i * s.mi * ldc * sizeof(double)) != 0;
+            write_sec += wall_seconds() - t0;
+            bytes_written += bytes;
+        }
+    }
+
+    pthread_mutex_lock(&s.lock);
+    s.stop = 1;
+    pthread_cond_broadcast(&s.cond);
+    pthread_mutex_unlock(&s.lock);
+    pthread_join(reader, NULL);
+    pthread_cond_destroy(&s.cond);
+    pthread_mutex_destroy(&s.lock);
+    rc = failed || s.failed ? -1 : 0;
+
+    if (stats) {
+        stats->read_sec = s.read_sec;
+        stats->write_sec = write_sec;
+        stats->wait_sec = wait_sec;
+        stats->bytes_read = s.bytes_read;
+        stats->bytes_written = bytes_written;
+        stats->panel_rows = s.mi;
+        stats->panel_depth = s.kp;
+    }
+
+done:
+    file_close(s.fa);
+    file_close(s.fb);
+    file_close(fc);
+    for (int b = 0; b < 2; b++) {
+        aligned_free(s.abuf[b]);
+        aligned_free(s.bbuf[b]);
+    }
+    aligned_free(cbuf);
+    if (rc != 0) file_remove(c_path);   // after file_close: Windows cannot delete an open file
+    return rc;
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+typedef struct {
+    MatrixKernel kernel;
+    const Matrix *A;
+    const Matrix *B;
+    Matrix *C;
+    int tile_m;
+    int tile_n;
+    int tiles_n;   // tiles per row of C
+    int b_transposed;   // B holds B^T (MM_KERNEL_TRANSPOSED)
+    MatrixTiles tiles;  // cache blocking inside each task
+} ParallelJob;
+
+// One task computes C[i0:i0+tm, j0:j0+tn] = A[i0:i0+tm, :] * B[:, j0:j0+tn]
+static void multiply_tile(void *arg, int task, int worker) {
+    (void) worker;
+    const ParallelJob *job = (const ParallelJob*) arg;
+    const int i0 = (task / job->tiles_n) * job->tile_m;
+    const int j0 = (task % job->tiles_n) * job->tile_n;
+    const int tm = min_int(job->tile_m, job->C->rows - i0);
+    const int tn = min_int(job->tile_n, job->C->cols - j0);
+
+    Matrix Av = matrix_view(job->A, i0, 0, tm, job->A->cols);
+    Matrix Cv = matrix_view(job->C, i0, j0, tm, tn);
+    if (job->b_transposed) {
+        Matrix BTv = matrix_view(job->B, j0, 0, tn, job->B->cols);
+        matrix_multiply_transposed(&Av, &BTv, &Cv);
+    } else {
+        Matrix Bv = matrix_view(job->B, 0, j0, job->B->rows, tn);
+        matrix_multiply_with_tiles(job->kernel, &Av, &Bv, &Cv, &job->tiles);
+    }
+}
+
+// Halves *tn (down to 128), then *tm (down to 16), until every worker has a few tiles of C
+static void shrink_tiles(ThreadPool *pool, const Matrix *C, int *tm, int *tn) {
+    const int want = 4 * thread_pool_size(pool);
+    for (;;) {
+        const int tiles = ((C->rows + *tm - 1) / *tm) * ((C->cols + *tn - 1) / *tn);
+        if (tiles >= want) break;
+        if (*tn > 128) *tn /= 2;
+        else if (*tm > 16) *tm /= 2;
+        else break;
+    }
+}
+
+// tiles == NULL uses matrix_get_tiles()
+static void run_parallel(ThreadPool *pool, MatrixKernel k, const Matrix *A, const Matrix *B,
+                         Matrix *C, int b_transposed, const MatrixTiles *tiles) {
+    const MatrixTiles t = tiles ? *tiles : matrix_get_tiles();
+    ParallelJob job;
+    job.tiles = t;
+    job.kernel = k;
+    job.A = A;
+    job.B = B;
+    job.C = C;
+    job.b_transposed = b_transposed;
+    job.tile_m = t.mc;
+    job.tile_n = t.nc;
+    shrink_tiles(pool, C, &job.tile_m, &job.tile_n);
+    job.tiles_n = (C->cols + job.tile_n - 1) / job.tile_n;
+    const int tiles_m = (C->rows + job.tile_m - 1) / job.tile_m;
+    thread_pool_run(pool, tiles_m * job.tiles_n, multiply_tile, &job);
+}
+
+// ---------- Library-owned pool ----------
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadPool *shared_pool = NULL;
+
+ThreadPool *matrix_shared_pool_acquire(int threads) {
+    pthread_mutex_lock(&shared_lock);
+    if (shared_pool && thread_pool_size(shared_pool) != threads) {
+        thread_pool_destroy(shared_pool);
+        shared_pool = NULL;
+    }
+    // unpinned: worker 0 is whichever thread calls, and the library does not own it
+    if (!shared_pool) shared_pool = thread_pool_create_pinned(threads, POOL_AFFINITY_NONE);
+    if (!shared_pool) pthread_mutex_unlock(&shared_lock);
+    return shared_pool;
+}
+
+void matrix_shared_pool_release(void) {
+    pthread_mutex_unlock(&shared_lock);
+}
+
+void matrix_shared_pool_shutdown(void) {
+    pthread_mutex_lock(&shared_lock);
+    thread_pool_destroy(shared_pool);
+    shared_pool = NULL;
+    pthread_mutex_unlock(&shared_lock);
+}
+
+// matrix_multiply_parallel for a kernel other than MM_KERNEL_AUTO; tiles == NULL uses matrix_get_tiles()
+static int multiply_on_pool(ThreadPool *pool, MatrixKernel k, const Matrix *A, const Matrix *B, Matrix *C,
+                            const MatrixTiles *tiles) {
+    if (k == MM_KERNEL_FIXED && matrix_multiply_fixed(A, B, C) == 0) {
+        // at most 64 x 64: splitting would lose the specialization for a few microseconds of work
+        return 0;
+    }
+    if (k == MM_KERNEL_STRASSEN && matrix_multiply_strassen(pool, NULL, A, B, C) == 0) {
+        // the recursion is sequential; its leaf products are spread over the pool
+        return 0;
+    }
+    if (k == MM_KERNEL_PACKED) {
+        // pack B once for the whole product, not once per tile
+        MatrixPacked P = matrix_pack_b(B, tiles);
+        const int rc = P.data ? matrix_multiply_prepacked(pool, A, &P, C) : -1;
+        matrix_packed_free(&P);
+        if (rc == 0) return 0;
+    }
+    if (k == MM_KERNEL_TRANSPOSED) {
+        // transpose once for the whole product, not once per tile
+        Matrix BT = matrix_alloc(B->cols, B->rows);
+        if (BT.data) {
+            matrix_transpose(B, &BT);
+            run_parallel(pool, k, A, &BT, C, 1, tiles);
+            matrix_free(&BT);
+            return 0;
+        }
+    }
+    run_parallel(pool, k, A, B, C, 0, tiles);
+    return 0;
+}
+
+int matrix_multiply_parallel(ThreadPool *pool, MatrixKernel k, const Matrix *A, const Matrix *B,
+                             Matrix *C) {
+    if (matrix_check_shapes(A, B, C) != 0) return -1;
+    if (k != MM_KERNEL_AUTO) return multiply_on_pool(pool, k, A, B, C, NULL);
+    // the table's thread count on a pool of exactly that size, whatever the caller passed
+    const MatrixTuneEntry e = matrix_tune_choice(A->rows, A->cols, B->cols);
+    if (e.threads <= 1) return multiply_on_pool(NULL, e.kernel, A, B, C, &e.tiles);
+    ThreadPool *own = matrix_shared_pool_acquire(e.threads);
+    const int rc = multiply_on_pool(own, e.kernel, A, B, C, &e.tiles);   // calling thread only if own is NULL
+    if (own) matrix_shared_pool_release();
+    return rc;
+}
+
+int matrix_multiply_parallel_transposed(ThreadPool *pool, const Matrix *A, const Matrix *BT, Matrix *C) {
+    if (!A->data || !BT->data || !C->data || A->cols != BT->cols || C->rows != A->rows ||
+        C->cols != BT->rows)
+        return -1;
+    run_parallel(pool, MM_KERNEL_TRANSPOSED, A, BT, C, 1, NULL);
+    return 0;
+}
+
+typedef struct {
+    double alpha;
+    double beta;
+    const Matrix *A;
+    const Matrix *B;
+    Matrix *C;
+    int tile_m;
+    int tile_n;
+    int tiles_n;
+} GemmJob;
+
+static void gemm_tile(void *arg, int task, int worker) {
+    (void) worker;
+    const GemmJob *job = (const GemmJob*) arg;
+    const int i0 = (task / job->tiles_n) * job->tile_m;
+    const int j0 = (task % job->tiles_n) * job->tile_n;
+    const int tm = min_int(job->tile_m, job->C->rows - i0);
+    const int tn = min_int(job->tile_n, job->C->cols - j0);
+    Matrix Av = matrix_view(job->A, i0, 0, tm, job->A->cols);
+    Matrix Bv = matrix_view(job->B, 0, j0, job->B->rows, tn);
+    Matrix Cv = matrix_view(job->C, i0, j0, tm, tn);
+    matrix_gemm(MM_NO_TRANS, MM_NO_TRANS, job->alpha, &Av, &Bv, job->beta, &Cv);
+}
+
+int matrix_gemm_parallel(ThreadPool *pool, double alpha, const Matrix *A, const Matrix *B, double beta, Matrix *C) {
+    if (matrix_check_shapes(A, B, C) != 0) return -1;
+    const MatrixTiles t = matrix_get_tiles();
+    GemmJob job = { alpha, beta, A, B, C, t.mc, t.nc, 0 };
+    shrink_tiles(pool, C, &job.tile_m, &job.tile_n);   // the same split as matrix_multiply_parallel
+    job.tiles_n = (C->cols + job.tile_n - 1) / job.tile_n;
+    thread_pool_run(pool, ((C->rows + job.tile_m - 1) / job.tile_m) * job.tiles_n, gemm_tile, &job);
+    return 0;
+}
+
+typedef struct {
+    Matrix *M;
+    int slabs;
+} TouchJob;
+
+static void touch_slab(void *arg, int task, int worker) {
+    (void) task;
+    const TouchJob *job = (const TouchJob*) arg;
+    if (worker >= job->slabs) return;   // more workers than rows
+    const long rows = job->M->rows;
+    const int r0 = (int) (rows * worker / job->slabs), r1 = (int) (rows * (worker + 1) / job->slabs);
+    for (int i = r0; i < r1; i++) memset(&MAT_AT(job->M, i, 0), 0, (size_t) job->M->ld * sizeof(double));
+}
+
+void matrix_first_touch(ThreadPool *pool, Matrix *M) {
+    if (!M->data) return;
+    // run_each, not run: a stolen slab would put its pages on the thief's node
+    TouchJob job = { M, min_int(thread_pool_size(pool), M->rows) };
+    thread_pool_run_each(pool, touch_slab, &job);
+}
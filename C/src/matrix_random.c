@@ -0,0 +1,216 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+#include "thread_pool.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define MM_HAVE_X86 1
+  #include <immintrin.h>
+#endif
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"):
+// ten rounds of two 32x32->64 multiplies scramble a 128-bit counter under a
+// 64-bit key. Counter (pair, row, stream) -> two doubles, so every element is a
+// pure function of (seed, stream, row, col) and any split of the rows over
+// threads, or of a matrix over ranks, produces the same values.
+#define PHILOX_M0 UINT64_C(0xD2511F53)
+#define PHILOX_M1 UINT64_C(0xCD9E8D57)
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+// counters per block: two AVX-512 vectors, four AVX2 ones
+#define PHILOX_LANES 16
+
+static uint64_t g_seed = 0;
+static atomic_uint_fast64_t g_next_stream = 0;
+
+void matrix_set_seed(uint64_t seed) {
+    g_seed = seed;
+    atomic_store(&g_next_stream, 0);
+}
+
+uint64_t matrix_get_seed(void) {
+    return g_seed;
+}
+
+uint64_t matrix_next_stream(void) {
+    return atomic_fetch_add(&g_next_stream, 1);
+}
+
+void matrix_philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3], k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = PHILOX_M0 * c0, p1 = PHILOX_M1 * c2;
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+        k0 += (uint32_t) PHILOX_W0;
+        k1 += (uint32_t) PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// 52 random bits as the mantissa of a double in [1, 2), minus 1: uniform on
+// [0, 1) and exact, so the scalar and vector paths give the same bits
+static inline double unit_double(uint64_t w) {
+    const uint64_t bits = (w >> 12) | UINT64_C(0x3FF0000000000000);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d - 1.0;
+}
+
+// out[0 .. 2 * PHILOX_LANES) = columns 2 * pair0 onwards of one row
+typedef void (*PhiloxBlock)(uint64_t seed, uint64_t stream, uint32_t row, uint32_t pair0, double *out);
+
+static void philox_block_scalar(uint64_t seed, uint64_t stream, uint32_t row, uint32_t pair0, double *out) {
+    const uint32_t key[2] = { (uint32_t) seed, (uint32_t) (seed >> 32) };
+    for (uint32_t l = 0; l < PHILOX_LANES; ++l) {
+        const uint32_t ctr[4] = { pair0 + l, row, (uint32_t) stream, (uint32_t) (stream >> 32) };
+        uint32_t w[4];
+        matrix_philox4x32(ctr, key, w);
+        out[2 * l] = unit_double(((uint64_t) w[0] << 32) | w[1]);
+        out[2 * l + 1] = unit_double(((uint64_t) w[2] << 32) | w[3]);
+    }
+}
+
+#ifdef MM_HAVE_X86
+// One counter per 64-bit lane, its words in the low halves: mul_epu32 is then
+// exactly Philox's 32x32->64 multiply, which plain C does not vectorize
+__attribute__((target("avx2")))
+static void philox_block_avx2(uint64_t seed, uint64_t stream, uint32_t row, uint32_t pair0, double *out) {
+    const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0), m1 = _mm256_set1_epi64x(PHILOX_M1);
+    const __m256i lo = _mm256_set1_epi64x(0xFFFFFFFF), one = _mm256_set1_epi64x(0x3FF0000000000000);
+    for (uint32_t v = 0; v < PHILOX_LANES; v += 4) {
+        __m256i c0 = _mm256_setr_epi64x(pair0 + v, pair0 + v + 1, pair0 + v + 2, pair0 + v + 3);
+        c0 = _mm256_and_si256(c0, lo);
+        __m256i c1 = _mm256_set1_epi64x(row);
+        __m256i c2 = _mm256_set1_epi64x((uint32_t) stream), c3 = _mm256_set1_epi64x(stream >> 32);
+        uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const __m256i p0 = _mm256_mul_epu32(c0, m0), p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(k0));
+            c1 = _mm256_and_si256(p1, lo);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(k1));
+            c3 = _mm256_and_si256(p0, lo);
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        const __m256i w01 = _mm256_or_si256(_mm256_slli_epi64(c0, 32), c1);
+        const __m256i w23 = _mm256_or_si256(_mm256_slli_epi64(c2, 32), c3);
+        const __m256d ones = _mm256_set1_pd(1.0);
+        const __m256d even = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(w01, 12), one)), ones);
+        const __m256d odd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(w23, 12), one)), ones);
+        // even holds columns 0, 2, 4, 6 of the strip and odd 1, 3, 5, 7
+        const __m256d a = _mm256_unpacklo_pd(even, odd), b = _mm256_unpackhi_pd(even, odd);
+        _mm256_storeu_pd(out + 2 * v, _mm256_permute2f128_pd(a, b, 0x20));
+        _mm256_storeu_pd(out + 2 * v + 4, _mm256_permute2f128_pd(a, b, 0x31));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void philox_block_avx512(uint64_t seed, uint64_t stream, uint32_t row, uint32_t pair0, double *out) {
+    const __m512i m0 = _mm512_set1_epi64(PHILOX_M0), m1 = _mm512_set1_epi64(PHILOX_M1);
+    const __m512i lo = _mm512_set1_epi64(0xFFFFFFFF), one = _mm512_set1_epi64(0x3FF0000000000000);
+    // interleave even and odd columns back into order
+    const __m512i first = _mm512_setr_epi64(0, 8, 1, 9, 2, 10, 3, 11);
+    const __m512i second = _mm512_setr_epi64(4, 12, 5, 13, 6, 14, 7, 15);
+    for (uint32_t v = 0; v < PHILOX_LANES; v += 8) {
+        __m512i c0 = _mm512_add_epi64(_mm512_set1_epi64(pair0 + v), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+        c0 = _mm512_and_si512(c0, lo);
+        __m512i c1 = _mm512_set1_epi64(row);
+        __m512i c2 = _mm512_set1_epi64((uint32_t) stream), c3 = _mm512_set1_epi64(stream >> 32);
+        uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const __m512i p0 = _mm512_mul_epu32(c0, m0), p1 = _mm512_mul_epu32(c2, m1);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), _mm512_set1_epi64(k0));
+            c1 = _mm512_and_si512(p1, lo);
+            c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), _mm512_set1_epi64(k1));
+            c3 = _mm512_and_si512(p0, lo);
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        const __m512i w01 = _mm512_or_si512(_mm512_slli_epi64(c0, 32), c1);
+        const __m512i w23 = _mm512_or_si512(_mm512_slli_epi64(c2, 32), c3);
+        const __m512d ones = _mm512_set1_pd(1.0);
+        const __m512d even = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(w01, 12), one)), ones);
+        const __m512d odd = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(w23, 12), one)), ones);
+        _mm512_storeu_pd(out + 2 * v, _mm512_permutex2var_pd(even, first, odd));
+        _mm512_storeu_pd(out + 2 * v + 8, _mm512_permutex2var_pd(even, second, odd));
+    }
+}
+#endif
+
+// the micro-kernel's ISA (matrix_simd_isa, so --isa applies here too)
+static PhiloxBlock philox_block(void) {
+#ifdef MM_HAVE_X86
+    switch (matrix_simd_isa()) {
+    case MM_ISA_AVX512:
+        return philox_block_avx512;
+    case MM_ISA_AVX2:
+        return philox_block_avx2;
+    default:
+        break;
+    }
+#endif
+    return philox_block_scalar;
+}
+
+void matrix_random_row(uint64_t stream, int row, int col0, int count, double *out) {
+    const PhiloxBlock block = philox_block();
+    const uint32_t end = (uint32_t) col0 + (uint32_t) count;
+    double v[2 * PHILOX_LANES];
+    for (uint32_t pair = (uint32_t) col0 / 2; 2 * pair < end; pair += PHILOX_LANES) {
+        block(g_seed, stream, (uint32_t) row, pair, v);
+        const uint32_t first = 2 * pair;
+        const uint32_t lo = first < (uint32_t) col0 ? (uint32_t) col0 : first;
+        const uint32_t hi = first + 2 * PHILOX_LANES < end ? first + 2 * PHILOX_LANES : end;
+        for (uint32_t col = lo; col < hi; ++col) out[col - (uint32_t) col0] = v[col - first];
+    }
+}
+
+// ---------- Fills ----------
+typedef struct {
+    Matrix *M;
+    uint64_t stream;
+    int row0;
+    int col0;
+    int rows_per_task;
+} FillJob;
+
+static void fill_rows(void *arg, int task, int worker) {
+    (void) worker;
+    const FillJob *job = (const FillJob*) arg;
+    const int r0 = task * job->rows_per_task;
+    const int r1 = min_int(r0 + job->rows_per_task, job->M->rows);
+    for (int i = r0; i < r1; i++)
+        matrix_random_row(job->stream, job->row0 + i, job->col0, job->M->cols, &MAT_AT(job->M, i, 0));
+}
+
+void matrix_fill_random_at(ThreadPool *pool, Matrix *M, uint64_t stream, int row0, int col0) {
+    if (!M->data || M->rows <= 0 || M->cols <= 0) return;
+    // tasks of about 64K elements: enough of them to balance, few enough to be cheap
+    const int rows_per_task = M->cols >= 65536 ? 1 : 65536 / M->cols;
+    FillJob job = { M, stream, row0, col0, rows_per_task };
+    thread_pool_run(pool, (M->rows + rows_per_task - 1) / rows_per_task, fill_rows, &job);
+}
+
+uint64_t matrix_input_stream(int m, int k, int n, int operand) {
+    // bit 62 tags the shape streams; bit 63 is left to matrix_fill_sparse_random's values
+    const uint64_t mask = (1u << 20) - 1;
+    return 1ull << 62 | ((uint64_t) m & mask) << 41 | ((uint64_t) k & mask) << 21 | ((uint64_t) n & mask) << 1 |
+           (uint64_t) (operand & 1);
+}
+
+void matrix_fill_random_parallel(ThreadPool *pool, Matrix *M) {
+    matrix_fill_random_at(pool, M, matrix_next_stream(), 0, 0);
+}
+
+void matrix_fill_random(Matrix *M) {
+    matrix_fill_random_at(NULL, M, matrix_next_stream(), 0, 0);
+}
@@ -0,0 +1,458 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define MM_HAVE_X86 1
+  #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+  #define MM_HAVE_NEON 1
+  #include <arm_neon.h>
+  #if defined(__linux__)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+  #endif
+#endif
+
+// A micro-kernel accumulates an MR x NR tile: C[0:MR,0:NR] += alpha * A[0:MR,0:kc] * B[0:kc,0:NR].
+// Element (r,p) of A is A[r*rsa + p*csa]: (lda, 1) reads a row-major block in
+// place, (1, MR) reads a packed micro-panel.
+typedef void (*micro_kernel_fn)(int kc, double alpha, const double *A, size_t rsa, size_t csa, const double *B,
+                                size_t ldb, double *C, size_t ldc);
+
+typedef struct {
+    int mr;
+    int nr;
+    micro_kernel_fn kernel;
+} MicroKernel;
+
+// ---------- Scalar (4x4) ----------
+static void ukernel_scalar_4x4(int kc, double alpha, const double *A, size_t rsa, size_t csa,
+                               const double *B, size_t ldb, double *C, size_t ldc) {
+    double c[4][4] = {{0}};
+    for (int p = 0; p < kc; p++) {
+        const double *Bp = B + p * ldb;
+        for (int r = 0; r < 4; r++) {
+            const double a = A[r * rsa + p * csa];
+            for (int j = 0; j < 4; j++) c[r][j] += a * Bp[j];
+        }
+    }
+    for (int r = 0; r < 4; r++)
+        for (int j = 0; j < 4; j++) C[r * ldc + j] += alpha * c[r][j];
+}
+
+#ifdef MM_HAVE_X86
+// ---------- AVX2 + FMA (6x8) ----------
+// 12 ymm accumulators + 2 B vectors + 1 broadcast fit in the 16 architectural registers
+__attribute__((target("avx2,fma")))
+static void ukernel_avx2_6x8(int kc, double alpha, const double *A, size_t rsa, size_t csa,
+                             const double *B, size_t ldb, double *C, size_t ldc) {
+    __m256d c[6][2];
+    for (int r = 0; r < 6; r++) {
+        c[r][0] = _mm256_setzero_pd();
+        c[r][1] = _mm256_setzero_pd();
+    }
+    for (int p = 0; p < kc; p++) {
+        const __m256d b0 = _mm256_loadu_pd(B + p * ldb);
+        const __m256d b1 = _mm256_loadu_pd(B + p * ldb + 4);
+        for (int r = 0; r < 6; r++) {
+            const __m256d a = _mm256_broadcast_sd(A + r * rsa + p * csa);
+            c[r][0] = _mm256_fmadd_pd(a, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_pd(a, b1, c[r][1]);
+        }
+    }
+    const __m256d va = _mm256_set1_pd(alpha);
+    for (int r = 0; r < 6; r++) {
+        double *Cr = C + r * ldc;
+        _mm256_storeu_pd(Cr, _mm256_fmadd_pd(va, c[r][0], _mm256_loadu_pd(Cr)));
+        _mm256_storeu_pd(Cr + 4, _mm256_fmadd_pd(va, c[r][1], _mm256_loadu_pd(Cr + 4)));
+    }
+}
+
+// ---------- AVX-512F (6x16) ----------
+__attribute__((target("avx512f")))
+static void ukernel_avx512_6x16(int kc, double alpha, const double *A, size_t rsa, size_t csa,
+                                const double *B, size_t ldb, double *C, size_t ldc) {
+    __m512d c[6][2];
+    for (int r = 0; r < 6; r++) {
+        c[r][0] = _mm512_setzero_pd();
+        c[r][1] = _mm512_setzero_pd();
+    }
+    for (int p = 0; p < kc; p++) {
+        const __m512d b0 = _mm512_loadu_pd(B + p * ldb);
+        const __m512d b1 = _mm512_loadu_pd(B + p * ldb + 8);
+        for (int r = 0; r < 6; r++) {
+            const __m512d a = _mm512_set1_pd(A[r * rsa + p * csa]);
+            c[r][0] = _mm512_fmadd_pd(a, b0, c[r][0]);
+            c[r][1] = _mm512_fmadd_pd(a, b1, c[r][1]);
+        }
+    }
+    const __m512d va = _mm512_set1_pd(alpha);
+    for (int r = 0; r < 6; r++) {
+        double *Cr = C + r * ldc;
+        _mm512_storeu_pd(Cr, _mm512_fmadd_pd(va, c[r][0], _mm512_loadu_pd(Cr)));
+        _mm512_storeu_pd(Cr + 8, _mm512_fmadd_pd(va, c[r][1], _mm512_loadu_pd(Cr + 8)));
+    }
+}
+#endif
+
+#ifdef MM_HAVE_NEON
+// ---------- NEON (4x8) ----------
+static void ukernel_neon_4x8(int kc, double alpha, const double *A, size_t rsa, size_t csa,
+                             const double *B, size_t ldb, double *C, size_t ldc) {
+    float64x2_t c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int j = 0; j < 4; j++) c[r][j] = vdupq_n_f64(0.0);
+    for (int p = 0; p < kc; p++) {
+        const double *Bp = B + p * ldb;
+        const float64x2_t b0 = vld1q_f64(Bp);
+        const float64x2_t b1 = vld1q_f64(Bp + 2);
+        const float64x2_t b2 = vld1q_f64(Bp + 4);
+        const float64x2_t b3 = vld1q_f64(Bp + 6);
+        for (int r = 0; r < 4; r++) {
+            const double a = A[r * rsa + p * csa];
+            c[r][0] = vfmaq_n_f64(c[r][0], b0, a);
+            c[r][1] = vfmaq_n_f64(c[r][1], b1, a);
+            c[r][2] = vfmaq_n_f64(c[r][2], b2, a);
+            c[r][3] = vfmaq_n_f64(c[r][3], b3, a);
+        }
+    }
+    for (int r = 0; r < 4; r++) {
+        double *Cr = C + r * ldc;
+        for (int j = 0; j < 4; j++)
+            vst1q_f64(Cr + 2 * j, vfmaq_n_f64(vld1q_f64(Cr + 2 * j), c[r][j], alpha));
+    }
+}
+#endif
+
+static const MicroKernel micro_kernels[] = {
+    [MM_ISA_SCALAR] = { 4, 4, ukernel_scalar_4x4 },
+#ifdef MM_HAVE_NEON
+    [MM_ISA_NEON]   = { 4, 8, ukernel_neon_4x8 },
+#endif
+#ifdef MM_HAVE_X86
+    [MM_ISA_AVX2]   = { 6, 8, ukernel_avx2_6x8 },
+    [MM_ISA_AVX512] = { 6, 16, ukernel_avx512_6x16 },
+#endif
+};
+
+// ---------- Runtime CPU dispatch ----------
+static int isa_supported(MatrixIsa isa) {
+    switch (isa) {
+    case MM_ISA_SCALAR:
+        return 1;
+#ifdef MM_HAVE_NEON
+    case MM_ISA_NEON:
+  #if defined(__linux__) && defined(HWCAP_ASIMD)
+        return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+  #else
+        return 1;   // Advanced SIMD is mandatory on AArch64
+  #endif
+#endif
+#ifdef MM_HAVE_X86
+    case MM_ISA_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case MM_ISA_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return 0;
+    }
+}
+
+// -1 until the first call detects it; read from pool workers, executor threads and foreign callers alike
+static _Atomic int g_isa = -1;
+
+MatrixIsa matrix_simd_isa(void) {
+    int current = atomic_load_explicit(&g_isa, memory_order_relaxed);
+    if (current < 0) {
+        MatrixIsa best = MM_ISA_SCALAR;
+        for (int isa = MM_ISA_SCALAR; isa < MM_ISA_COUNT; isa++) {
+            if (isa_supported((MatrixIsa) isa)) best = (MatrixIsa) isa;
+        }
+        // racing detections agree; a matrix_simd_set_isa that got in first is kept
+        if (atomic_compare_exchange_strong_explicit(&g_isa, &current, (int) best, memory_order_relaxed,
+                                                    memory_order_relaxed))
+            current = best;
+    }
+    return (MatrixIsa) current;
+}
+
+int matrix_simd_set_isa(MatrixIsa isa) {
+    if (isa < 0 || isa >= MM_ISA_COUNT || !isa_supported(isa)) return -1;
+    atomic_store_explicit(&g_isa, (int) isa, memory_order_relaxed);
+    return 0;
+}
+
+static const char *const isa_names[MM_ISA_COUNT] = {
+    "scalar",
+    "neon",
+    "avx2",
+    "avx512",
+};
+
+const char *matrix_isa_name(MatrixIsa isa) {
+    if (isa < 0 || isa >= MM_ISA_COUNT) return "unknown";
+    return isa_names[isa];
+}
+
+int matrix_isa_from_name(const char *name, MatrixIsa *out) {
+    for (int isa = 0; isa < MM_ISA_COUNT; isa++) {
+        if (strcmp(name, isa_names[isa]) == 0) {
+            *out = (MatrixIsa) isa;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ---------- Blocked driver ----------
+// Partial tiles on the right/bottom edges are finished with plain loops
+static void edge_tile(int mb, int nb, int kc, double alpha, const double *A, size_t lda, const double *B,
+                      size_t ldb, double *C, size_t ldc) {
+    for (int i = 0; i < mb; i++) {
+        double *Ci = C + i * ldc;
+        for (int p = 0; p < kc; p++) {
+            const double a = alpha * A[i * lda + p];
+            const double *Bp = B + p * ldb;
+            for (int j = 0; j < nb; j++) Ci[j] += a * Bp[j];
+        }
+    }
+}
+
+void simd_block_multiply(int mb, int nb, int kb, double alpha, const double *A, size_t lda,
+                         const double *B, size_t ldb, double *C, size_t ldc) {
+    const MicroKernel uk = micro_kernels[matrix_simd_isa()];
+    for (int jr = 0; jr < nb; jr += uk.nr) {
+        const int nr = min_int(uk.nr, nb - jr);
+        for (int ir = 0; ir < mb; ir += uk.mr) {
+            const int mr = min_int(uk.mr, mb - ir);
+            const double *Ap = A + ir * lda;
+            const double *Bp = B + jr;
+            double *Cp = C + ir * ldc + jr;
+            if (mr == uk.mr && nr == uk.nr) uk.kernel(kb, alpha, Ap, lda, 1, Bp, ldb, Cp, ldc);
+            else edge_tile(mr, nr, kb, alpha, Ap, lda, Bp, ldb, Cp, ldc);
+        }
+    }
+}
+
+void matrix_multiply_simd(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles) {
+    const MatrixTiles t = tiles ? *tiles : matrix_get_tiles();
+    const int m = A->rows, k = A->cols, n = B->cols;
+    const size_t lda = (size_t) A->ld, ldb = (size_t) B->ld, ldc = (size_t) C->ld;
+
+    matrix_zero(C);
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            for (int ic = 0; ic < m; ic += t.mc) {
+                const int mb = min_int(t.mc, m - ic);
+                simd_block_multiply(mb, nb, kb, 1.0, &MAT_AT(A, ic, pc), lda, &MAT_AT(B, pc, jc), ldb,
+                                    &MAT_AT(C, ic, jc), ldc);
+            }
+        }
+    }
+}
+
+// ---------- Packed driver ----------
+// Largest MR x NR in micro_kernels (AVX-512 6x16)
+#define MAX_TILE 96
+
+static int round_up(int x, int r) {
+    return (x + r - 1) / r * r;
+}
+
+// A[0:mb, 0:kb] as micro-panels of mr rows, one after another: element (r, p)
+// of a panel is at p*mr + r, so the micro-kernel reads it in one stream.
+// Rows past mb are zero.
+static void pack_a(int mb, int kb, int mr, const double *A, size_t lda, double *dst) {
+    for (int ir = 0; ir < mb; ir += mr) {
+        const int rows = min_int(mr, mb - ir);
+        for (int p = 0; p < kb; p++) {
+            double *d = dst + (size_t) p * mr;
+            for (int r = 0; r < rows; r++) d[r] = A[(ir + r) * lda + p];
+            for (int r = rows; r < mr; r++) d[r] = 0.0;
+        }
+        dst += (size_t) mr * kb;
+    }
+}
+
+// B[0:kb, 0:nb] as micro-panels of nr columns: element (p, j) at p*nr + j.
+// Columns past nb are zero.
+static void pack_b(int kb, int nb, int nr, const double *B, size_t ldb, double *dst) {
+    for (int jr = 0; jr < nb; jr += nr) {
+        const int cols = min_int(nr, nb - jr);
+        for (int p = 0; p < kb; p++) {
+            double *d = dst + (size_t) p * nr;
+            memcpy(d, B + p * ldb + jr, (size_t) cols * sizeof(double));
+            for (int j = cols; j < nr; j++) d[j] = 0.0;
+        }
+        dst += (size_t) nr * kb;
+    }
+}
+
+// C[0:mb, 0:nb] += packed A block * packed B block. Edge tiles run the full
+// micro-kernel on the zero padding into a scratch tile and add only the part
+// that lies inside C.
+static void packed_block(const MicroKernel *uk, int mb, int nb, int kb, const double *Ap, const double *Bp,
+                         double *C, size_t ldc) {
+    double tmp[MAX_TILE];
+    for (int jr = 0; jr < nb; jr += uk->nr) {
+        const int nr = min_int(uk->nr, nb - jr);
+        const double *Bj = Bp + (size_t) jr * kb;
+        for (int ir = 0; ir < mb; ir += uk->mr) {
+            const int mr = min_int(uk->mr, mb - ir);
+            const double *Ai = Ap + (size_t) ir * kb;
+            double *Cij = C + ir * ldc + jr;
+            if (mr == uk->mr && nr == uk->nr) {
+                uk->kernel(kb, 1.0, Ai, 1, (size_t) uk->mr, Bj, (size_t) uk->nr, Cij, ldc);
+                continue;
+            }
+            memset(tmp, 0, sizeof(tmp));
+            uk->kernel(kb, 1.0, Ai, 1, (size_t) uk->mr, Bj, (size_t) uk->nr, tmp, (size_t) uk->nr);
+            for (int r = 0; r < mr; r++)
+                for (int j = 0; j < nr; j++) Cij[r * ldc + j] += tmp[r * uk->nr + j];
+        }
+    }
+}
+
+void matrix_multiply_packed(const Matrix *A, const Matrix *B, Matrix *C, const MatrixTiles *tiles) {
+    const MatrixTiles t = tiles ? *tiles : matrix_get_tiles();
+    const MicroKernel uk = micro_kernels[matrix_simd_isa()];
+    const int m = A->rows, k = A->cols, n = B->cols;
+    const size_t lda = (size_t) A->ld, ldb = (size_t) B->ld, ldc = (size_t) C->ld;
+
+    // one buffer per operand, reused by every block of the product
+    const size_t kc = (size_t) min_int(t.kc, k);
+    double *abuf = (double*) aligned_malloc((size_t) round_up(min_int(t.mc, m), uk.mr) * kc * sizeof(double));
+    double *bbuf = (double*) aligned_malloc((size_t) round_up(min_int(t.nc, n), uk.nr) * kc * sizeof(double));
+    if (!abuf || !bbuf) {
+        aligned_free(abuf);
+        aligned_free(bbuf);
+        matrix_multiply_simd(A, B, C, &t);
+        return;
+    }
+
+    matrix_zero(C);
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            pack_b(kb, nb, uk.nr, &MAT_AT(B, pc, jc), ldb, bbuf);
+            for (int ic = 0; ic < m; ic += t.mc) {
+                const int mb = min_int(t.mc, m - ic);
+                pack_a(mb, kb, uk.mr, &MAT_AT(A, ic, pc), lda, abuf);
+                packed_block(&uk, mb, nb, kb, abuf, bbuf, &MAT_AT(C, ic, jc), ldc);
+            }
+        }
+    }
+    aligned_free(abuf);
+    aligned_free(bbuf);
+}
+
+// Start of the packed kc x nb block at (pc, jc): column blocks follow each
+// other, each one all k rows deep and a whole number of micro-panels wide
+static double *packed_block_at(const MatrixPacked *P, int nr, int pc, int jc, int nb) {
+    const size_t col_start = (size_t) (jc / P->tiles.nc) * (size_t) round_up(P->tiles.nc, nr) * (size_t) P->rows;
+    return P->data + col_start + (size_t) pc * (size_t) round_up(nb, nr);
+}
+
+MatrixPacked matrix_pack_b(const Matrix *B, const MatrixTiles *tiles) {
+    MatrixPacked P = {0};
+    if (!B->data) return P;
+    const MatrixTiles t = tiles ? *tiles : matrix_get_tiles();
+    const MatrixIsa isa = matrix_simd_isa();
+    const int nr = micro_kernels[isa].nr;
+    const int k = B->rows, n = B->cols;
+    const int full = n / t.nc, rest = n % t.nc;
+    const size_t width = (size_t) full * round_up(t.nc, nr) + (rest ? (size_t) round_up(rest, nr) : 0);
+    const size_t elems = width * (size_t) k;
+    P.data = (double*) aligned_malloc(elems ? elems * sizeof(double) : MATRIX_ALIGN);
+    if (!P.data) return P;
+    P.rows = k;
+    P.cols = n;
+    P.tiles = t;
+    P.isa = isa;
+    for (int jc = 0; jc < n; jc += t.nc) {
+        const int nb = min_int(t.nc, n - jc);
+        for (int pc = 0; pc < k; pc += t.kc) {
+            const int kb = min_int(t.kc, k - pc);
+            pack_b(kb, nb, nr, &MAT_AT(B, pc, jc), (size_t) B->ld, packed_block_at(&P, nr, pc, jc, nb));
+        }
+    }
+    return P;
+}
+
+void matrix_packed_free(MatrixPacked *P) {
+    aligned_free(P->data);
+    memset(P, 0, sizeof(*P));
+}
+
+typedef struct {
+    const Matrix *A;
+    const MatrixPacked *B;
+    Matrix *C;
+    MicroKernel uk;
+    int tile_m;
+    int tiles_m;     // row blocks per column block of C
+    double **abuf;   // A packing buffer of each worker
+} PackedJob;
+
+// One task owns C[ic:ic+mb, jc:jc+nb] for one nc-wide column block of B;
+// consecutive tasks walk down the same column block, so its packed panels
+// stay in cache while a worker drains its range
+static void packed_task(void *arg, int task, int worker) {
+    const PackedJob *job = (const PackedJob*) arg;
+    const MatrixPacked *P = job->B;
+    const int ic = (task % job->tiles_m) * job->tile_m;
+    const int jc = (task / job->tiles_m) * P->tiles.nc;
+    const int mb = min_int(job->tile_m, job->C->rows - ic);
+    const int nb = min_int(P->tiles.nc, job->C->cols - jc);
+    const size_t ldc = (size_t) job->C->ld;
+    double *Cb = &MAT_AT(job->C, ic, jc);
+    for (int i = 0; i < mb; i++) memset(Cb + i * ldc, 0, (size_t) nb * sizeof(double));
+    for (int pc = 0; pc < P->rows; pc += P->tiles.kc) {
+        const int kb = min_int(P->tiles.kc, P->rows - pc);
+        pack_a(mb, kb, job->uk.mr, &MAT_AT(job->A, ic, pc), (size_t) job->A->ld, job->abuf[worker]);
+        packed_block(&job->uk, mb, nb, kb, job->abuf[worker], packed_block_at(P, job->uk.nr, pc, jc, nb), Cb, ldc);
+    }
+}
+
+int matrix_multiply_prepacked(ThreadPool *pool, const Matrix *A, const MatrixPacked *B, Matrix *C) {
+    if (!A->data || !B->data || !C->data || A->cols != B->rows || C->rows != A->rows || C->cols != B->cols)
+        return -1;
+    PackedJob job;
+    job.A = A;
+    job.B = B;
+    job.C = C;
+    job.uk = micro_kernels[B->isa];
+    job.tile_m = round_up(min_int(B->tiles.mc, C->rows > 0 ? C->rows : 1), job.uk.mr);
+
+    // shorter row blocks until every worker has a few tasks
+    const int workers = thread_pool_size(pool);
+    const int tiles_n = (C->cols + B->tiles.nc - 1) / B->tiles.nc;
+    while (job.tile_m > job.uk.mr && ((C->rows + job.tile_m - 1) / job.tile_m) * tiles_n < 4 * workers)
+        job.tile_m = round_up(job.tile_m / 2, job.uk.mr);
+    job.tiles_m = (C->rows + job.tile_m - 1) / job.tile_m;
+    if (job.tiles_m * tiles_n == 0) return 0;
+
+    const size_t abytes = (size_t) job.tile_m * (size_t) min_int(B->tiles.kc, A->cols > 0 ? A->cols : 1) * sizeof(double);
+    double **abuf = (double**) calloc((size_t) workers, sizeof(double*));
+    int ok = abuf != NULL;
+    for (int w = 0; ok && w < workers; w++) ok = (abuf[w] = (double*) aligned_malloc(abytes)) != NULL;
+    if (ok) {
+        job.abuf = abuf;
+        thread_pool_run(pool, job.tiles_m * tiles_n, packed_task, &job);
+    }
+    for (int w = 0; abuf && w < workers; w++) aligned_free(abuf[w]);
+    free(abuf);
+    return ok ? 0 : -1;
+}
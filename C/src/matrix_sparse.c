@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+// Columns of C one register tile covers: four 8-double vectors for CSR, two
+// for BSR (whose tile is also MM_BSR_BLOCK rows high)
+#define CSR_NR 32
+#define BSR_NR 16
+
+typedef double vec8_t __attribute__((vector_size(8 * sizeof(double))));
+
+// ---------- Generation and conversion ----------
+void matrix_fill_sparse_random(Matrix *M, double density) {
+    // the stream decides which elements are kept, its mirror (top bit set) their values
+    const uint64_t stream = matrix_next_stream();
+    for (int i = 0; i < M->rows; i++) {
+        double *Mi = &MAT_AT(M, i, 0);
+        matrix_random_row(stream | (UINT64_C(1) << 63), i, 0, M->cols, Mi);
+        for (int j0 = 0; j0 < M->cols; j0 += 256) {
+            double keep[256];
+            const int len = min_int(256, M->cols - j0);
+            matrix_random_row(stream, i, j0, len, keep);
+            for (int j = 0; j < len; j++)
+                if (keep[j] >= density) Mi[j0 + j] = 0.0;
+        }
+    }
+}
+
+MatrixCsr matrix_to_csr(const Matrix *M) {
+    MatrixCsr S = {0};
+    if (!M->data) return S;
+    size_t *row_ptr = (size_t*) malloc(((size_t) M->rows + 1) * sizeof(size_t));
+    if (!row_ptr) return S;
+    row_ptr[0] = 0;
+    for (int i = 0; i < M->rows; i++) {
+        const double *Mi = &MAT_AT(M, i, 0);
+        size_t count = 0;
+        for (int j = 0; j < M->cols; j++) count += Mi[j] != 0.0;
+        row_ptr[i + 1] = row_ptr[i] + count;
+    }
+    const size_t nnz = row_ptr[M->rows];
+    // malloc(0) may return NULL; an all-zero matrix still gets valid arrays
+    int *col_idx = (int*) malloc((nnz ? nnz : 1) * sizeof(int));
+    double *values = (double*) malloc((nnz ? nnz : 1) * sizeof(double));
+    if (!col_idx || !values) {
+        free(row_ptr);
+        free(col_idx);
+        free(values);
+        return S;
+    }
+    for (int i = 0; i < M->rows; i++) {
+        const double *Mi = &MAT_AT(M, i, 0);
+        size_t p = row_ptr[i];
+        for (int j = 0; j < M->cols; j++) {
+            if (Mi[j] == 0.0) continue;
+            col_idx[p] = j;
+            values[p++] = Mi[j];
+        }
+    }
+    S.rows = M->rows;
+    S.cols = M->cols;
+    S.nnz = nnz;
+    S.row_ptr = row_ptr;
+    S.col_idx = col_idx;
+    S.values = values;
+    return S;
+}
+
+void matrix_csr_free(MatrixCsr *S) {
+    free(S->row_ptr);
+    free(S->col_idx);
+    free(S->values);
+    memset(S, 0, sizeof(*S));
+}
+
+MatrixBsr matrix_to_bsr(const Matrix *M) {
+    const int b = MM_BSR_BLOCK;
+    MatrixBsr S = {0};
+    if (!M->data) return S;
+    const int brows = (M->rows + b - 1) / b, bcols = (M->cols + b - 1) / b;
+    size_t *row_ptr = (size_t*) malloc(((size_t) brows + 1) * sizeof(size_t));
+    if (!row_ptr) return S;
+    // a block is stored if any of its elements is non-zero
+    row_ptr[0] = 0;
+    for (int bi = 0; bi < brows; bi++) {
+        const int r1 = min_int(M->rows, (bi + 1) * b);
+        size_t count = 0;
+        for (int bj = 0; bj < bcols; bj++) {
+            const int c1 = min_int(M->cols, (bj + 1) * b);
+            int any = 0;
+            for (int i = bi * b; i < r1 && !any; i++)
+                for (int j = bj * b; j < c1 && !any; j++) any = MAT_AT(M, i, j) != 0.0;
+            count += any;
+        }
+        row_ptr[bi + 1] = row_ptr[bi] + count;
+    }
+    const size_t nblocks = row_ptr[brows];
+    int *col_idx = (int*) malloc((nblocks ? nblocks : 1) * sizeof(int));
+    double *values = (double*) calloc(nblocks ? nblocks * b * b : 1, sizeof(double));
+    if (!col_idx || !values) {
+        free(row_ptr);
+        free(col_idx);
+        free(values);
+        return S;
+    }
+    for (int bi = 0; bi < brows; bi++) {
+        const int r1 = min_int(M->rows, (bi + 1) * b);
+        size_t p = row_ptr[bi];
+        for (int bj = 0; bj < bcols && p < row_ptr[bi + 1]; bj++) {
+            const int c1 = min_int(M->cols, (bj + 1) * b);
+            int any = 0;
+            for (int i = bi * b; i < r1 && !any; i++)
+                for (int j = bj * b; j < c1 && !any; j++) any = MAT_AT(M, i, j) != 0.0;
+            if (!any) continue;
+            // edge blocks keep zeros in the rows / columns past the matrix
+            double *blk = values + p * b * b;
+            for (int i = bi * b; i < r1; i++)
+                for (int j = bj * b; j < c1; j++) blk[(i - bi * b) * b + (j - bj * b)] = MAT_AT(M, i, j);
+            col_idx[p++] = bj;
+        }
+    }
+    S.rows = M->rows;
+    S.cols = M->cols;
+    S.nblocks = nblocks;
+    S.row_ptr = row_ptr;
+    S.col_idx = col_idx;
+    S.values = values;
+    return S;
+}
+
+void matrix_bsr_free(MatrixBsr *S) {
+    free(S->row_ptr);
+    free(S->col_idx);
+    free(S->values);
+    memset(S, 0, sizeof(*S));
+}
+
+// ---------- Kernels ----------
+// C[r0:r1, :] = A[r0:r1, :] * B; a tile of C accumulates in registers while
+// the rows of B picked by the row's non-zeros stream past it
+MM_MULTIVERSION
+static void csr_rows(const MatrixCsr *A, const Matrix *B, Matrix *C, int r0, int r1) {
+    const int n = B->cols;
+    for (int i = r0; i < r1; i++) {
+        const size_t p0 = A->row_ptr[i], p1 = A->row_ptr[i + 1];
+        double *Ci = &MAT_AT(C, i, 0);
+        int j = 0;
+        for (; j + CSR_NR <= n; j += CSR_NR) {
+            vec8_t acc[CSR_NR / 8] = {0};
+            for (size_t p = p0; p < p1; p++) {
+                const double a = A->values[p];
+                vec8_t b[CSR_NR / 8];
+                memcpy(b, &MAT_AT(B, A->col_idx[p], j), sizeof(b));
+                for (int v = 0; v < CSR_NR / 8; v++) acc[v] += a * b[v];
+            }
+            memcpy(Ci + j, acc, sizeof(acc));
+        }
+        if (j < n) {
+            memset(Ci + j, 0, (size_t) (n - j) * sizeof(double));
+            for (size_t p = p0; p < p1; p++) {
+                const double a = A->values[p];
+                const double *Bp = &MAT_AT(B, A->col_idx[p], 0);
+                for (int jj = j; jj < n; jj++) Ci[jj] += a * Bp[jj];
+            }
+        }
+    }
+}
+
+// Block rows [br0, br1): each stored block updates MM_BSR_BLOCK rows of C
+// from MM_BSR_BLOCK rows of B, so every loaded vector of B is used once per row
+MM_MULTIVERSION
+static void bsr_rows(const MatrixBsr *A, const Matrix *B, Matrix *C, int br0, int br1) {
+    enum { b = MM_BSR_BLOCK };
+    const int n = B->cols, k = B->rows;
+    for (int bi = br0; bi < br1; bi++) {
+        const size_t p0 = A->row_ptr[bi], p1 = A->row_ptr[bi + 1];
+        const int i0 = bi * b, rows = min_int(b, C->rows - i0);
+        int j = 0;
+        for (; j + BSR_NR <= n; j += BSR_NR) {
+            vec8_t acc[b][BSR_NR / 8] = {{{0}}};
+            for (size_t p = p0; p < p1; p++) {
+                const double *blk = A->values + p * b * b;
+                const int c0 = A->col_idx[p] * b, cols = min_int(b, k - c0);
+                for (int c = 0; c < cols; c++) {
+                    vec8_t v[BSR_NR / 8];
+                    memcpy(v, &MAT_AT(B, c0 + c, j), sizeof(v));
+                    for (int r = 0; r < b; r++)
+                        for (int q = 0; q < BSR_NR / 8; q++) acc[r][q] += blk[r * b + c] * v[q];
+                }
+            }
+            for (int r = 0; r < rows; r++) memcpy(&MAT_AT(C, i0 + r, j), acc[r], sizeof(acc[r]));
+        }
+        for (int r = 0; r < rows && j < n; r++) {
+            double *Ci = &MAT_AT(C, i0 + r, 0);
+            memset(Ci + j, 0, (size_t) (n - j) * sizeof(double));
+            for (size_t p = p0; p < p1; p++) {
+                const double *blk = A->values + p * b * b;
+                const int c0 = A->col_idx[p] * b, cols = min_int(b, k - c0);
+                for (int c = 0; c < cols; c++) {
+                    const double a = blk[r * b + c];
+                    const double *Bp = &MAT_AT(B, c0 + c, 0);
+                    for (int jj = j; jj < n; jj++) Ci[jj] += a * Bp[jj];
+                }
+            }
+        }
+    }
+}
+
+// ---------- Parallel drivers ----------
+typedef struct {
+    const MatrixCsr *csr;
+    const MatrixBsr *bsr;
+    const Matrix *B;
+    Matrix *C;
+    const size_t *row_ptr;   // of whichever format is in use
+    int rows;                // rows (CSR) or block rows (BSR)
+    int tasks;
+} SpmmJob;
+
+// First row of task t: rows are split so every task gets about the same
+// number of non-zeros plus rows, the two things a row costs
+static int task_start(const SpmmJob *job, int t) {
+    if (t == 0) return 0;
+    if (t >= job->tasks) return job->rows;
+    const size_t total = job->row_ptr[job->rows] + (size_t) job->rows;
+    const size_t target = total / (size_t) job->tasks * (size_t) t;
+    int lo = 0, hi = job->rows;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (job->row_ptr[mid] + (size_t) mid < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void spmm_task(void *arg, int task, int worker) {
+    (void) worker;
+    const SpmmJob *job = (const SpmmJob*) arg;
+    const int r0 = task_start(job, task), r1 = task_start(job, task + 1);
+    if (job->csr) csr_rows(job->csr, job->B, job->C, r0, r1);
+    else bsr_rows(job->bsr, job->B, job->C, r0, r1);
+}
+
+static void run_spmm(ThreadPool *pool, SpmmJob *job) {
+    job->tasks = min_int(job->rows, 8 * thread_pool_size(pool));
+    if (job->tasks < 1) job->tasks = 1;
+    thread_pool_run(pool, job->tasks, spmm_task, job);
+}
+
+int matrix_multiply_csr(ThreadPool *pool, const MatrixCsr *A, const Matrix *B, Matrix *C) {
+    if (!A->row_ptr || !B->data || !C->data || A->cols != B->rows || C->rows != A->rows || C->cols != B->cols)
+        return -1;
+    SpmmJob job = { A, NULL, B, C, A->row_ptr, A->rows, 0 };
+    run_spmm(pool, &job);
+    return 0;
+}
+
+int matrix_multiply_bsr(ThreadPool *pool, const MatrixBsr *A, const Matrix *B, Matrix *C) {
+    if (!A->row_ptr || !B->data || !C->data || A->cols != B->rows || C->rows != A->rows || C->cols != B->cols)
+        return -1;
+    SpmmJob job = { NULL, A, B, C, A->row_ptr, (A->rows + MM_BSR_BLOCK - 1) / MM_BSR_BLOCK, 0 };
+    run_spmm(pool, &job);
+    return 0;
+}
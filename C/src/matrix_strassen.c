@@ -0,0 +1,144 @@
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+static MatrixStrassen g_strassen = { 256, MM_KERNEL_SIMD };
+
+MatrixStrassen matrix_get_strassen(void) {
+    return g_strassen;
+}
+
+void matrix_set_strassen(MatrixStrassen s) {
+    if (s.cutoff < 2 || s.base < 0 || s.base >= MM_KERNEL_COUNT || s.base == MM_KERNEL_STRASSEN ||
+        s.base == MM_KERNEL_AUTO)
+        return;
+    g_strassen = s;
+}
+
+// Z = X + sign * Y; Z may alias X or Y
+static void add_to(const Matrix *X, const Matrix *Y, double sign, Matrix *Z) {
+    for (int i = 0; i < Z->rows; i++) {
+        const double *Xi = &MAT_AT(X, i, 0);
+        const double *Yi = &MAT_AT(Y, i, 0);
+        double *Zi = &MAT_AT(Z, i, 0);
+        for (int j = 0; j < Z->cols; j++) Zi[j] = Xi[j] + sign * Yi[j];
+    }
+}
+
+static size_t block_bytes(int rows, int cols) {
+    size_t bytes = (size_t) rows * padded_ld(cols) * sizeof(double);
+    return (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+}
+
+size_t matrix_strassen_scratch_bytes(int m, int k, int n) {
+    // each level holds three quadrant-sized temporaries while it recurses
+    const MatrixStrassen s = g_strassen;
+    size_t total = 0;
+    while (m > s.cutoff && k > s.cutoff && n > s.cutoff) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+        total += block_bytes(m, k) + block_bytes(k, n) + block_bytes(m, n);
+    }
+    return total;
+}
+
+typedef struct {
+    ThreadPool *pool;
+    MatrixArena *arena;
+    MatrixStrassen params;
+} StrassenCtx;
+
+static void base_multiply(const StrassenCtx *ctx, const Matrix *A, const Matrix *B, Matrix *C) {
+    if (ctx->pool) matrix_multiply_parallel(ctx->pool, ctx->params.base, A, B, C);
+    else matrix_multiply_with(ctx->params.base, A, B, C);
+}
+
+// C = A * B; returns -1 if the arena runs out of memory
+static int strassen_rec(const StrassenCtx *ctx, const Matrix *A, const Matrix *B, Matrix *C) {
+    const int m = A->rows, k = A->cols, n = B->cols;
+    const int cut = ctx->params.cutoff;
+    if (m <= cut || k <= cut || n <= cut) {
+        base_multiply(ctx, A, B, C);
+        return 0;
+    }
+
+    // recurse on the even part and peel the odd row / column off with GEMM
+    const int mh = m / 2, kh = k / 2, nh = n / 2;
+    const int m2 = 2 * mh, k2 = 2 * kh, n2 = 2 * nh;
+
+    Matrix A11 = matrix_view(A, 0, 0, mh, kh), A12 = matrix_view(A, 0, kh, mh, kh);
+    Matrix A21 = matrix_view(A, mh, 0, mh, kh), A22 = matrix_view(A, mh, kh, mh, kh);
+    Matrix B11 = matrix_view(B, 0, 0, kh, nh), B12 = matrix_view(B, 0, nh, kh, nh);
+    Matrix B21 = matrix_view(B, kh, 0, kh, nh), B22 = matrix_view(B, kh, nh, kh, nh);
+    Matrix C11 = matrix_view(C, 0, 0, mh, nh), C12 = matrix_view(C, 0, nh, mh, nh);
+    Matrix C21 = matrix_view(C, mh, 0, mh, nh), C22 = matrix_view(C, mh, nh, mh, nh);
+
+    const MatrixArenaMark mark = matrix_arena_mark(ctx->arena);
+    Matrix X = matrix_arena_alloc(ctx->arena, mh, kh);
+    Matrix Y = matrix_arena_alloc(ctx->arena, kh, nh);
+    Matrix Z = matrix_arena_alloc(ctx->arena, mh, nh);
+    int rc = (X.data && Y.data && Z.data) ? 0 : -1;
+
+    // Winograd's variant: 7 products, 15 additions, three temporaries
+    if (rc == 0) {
+        add_to(&A11, &A21, -1.0, &X);   // S3 = A11 - A21
+        add_to(&B22, &B12, -1.0, &Y);   // T3 = B22 - B12
+        rc |= strassen_rec(ctx, &X, &Y, &C21);   // P7 = S3 * T3
+        add_to(&A21, &A22, 1.0, &X);    // S1 = A21 + A22
+        add_to(&B12, &B11, -1.0, &Y);   // T1 = B12 - B11
+        rc |= strassen_rec(ctx, &X, &Y, &C22);   // P5 = S1 * T1
+        add_to(&X, &A11, -1.0, &X);     // S2 = S1 - A11
+        add_to(&B22, &Y, -1.0, &Y);     // T2 = B22 - T1
+        rc |= strassen_rec(ctx, &X, &Y, &C12);   // P6 = S2 * T2
+        rc |= strassen_rec(ctx, &A11, &B11, &Z); // P1 = A11 * B11
+        add_to(&C12, &Z, 1.0, &C12);    // U2 = P1 + P6
+        add_to(&C21, &C12, 1.0, &C21);  // U3 = U2 + P7
+        add_to(&C12, &C22, 1.0, &C12);  // U4 = U2 + P5
+        add_to(&C22, &C21, 1.0, &C22);  // C22 = U3 + P5
+        add_to(&A12, &X, -1.0, &X);     // S4 = A12 - S2
+        rc |= strassen_rec(ctx, &X, &B22, &C11); // P3 = S4 * B22
+        add_to(&C12, &C11, 1.0, &C12);  // C12 = U4 + P3
+        add_to(&Y, &B21, -1.0, &Y);     // T4 = T2 - B21
+        rc |= strassen_rec(ctx, &A22, &Y, &C11); // P4 = A22 * T4
+        add_to(&C21, &C11, -1.0, &C21); // C21 = U3 - P4
+        rc |= strassen_rec(ctx, &A12, &B21, &C11); // P2 = A12 * B21
+        add_to(&C11, &Z, 1.0, &C11);    // C11 = P1 + P2
+    }
+    matrix_arena_release(ctx->arena, mark);
+    if (rc != 0) return -1;
+
+    if (k2 < k) {
+        // C[0:m2, 0:n2] += A[0:m2, k-1] * B[k-1, 0:n2]
+        Matrix a = matrix_view(A, 0, k2, m2, 1), b = matrix_view(B, k2, 0, 1, n2), c = matrix_view(C, 0, 0, m2, n2);
+        matrix_gemm(MM_NO_TRANS, MM_NO_TRANS, 1.0, &a, &b, 1.0, &c);
+    }
+    if (n2 < n) {
+        Matrix b = matrix_view(B, 0, n2, k, 1), c = matrix_view(C, 0, n2, m, 1);
+        matrix_gemm(MM_NO_TRANS, MM_NO_TRANS, 1.0, A, &b, 0.0, &c);
+    }
+    if (m2 < m) {
+        Matrix a = matrix_view(A, m2, 0, 1, k), b = matrix_view(B, 0, 0, k, n2), c = matrix_view(C, m2, 0, 1, n2);
+        matrix_gemm(MM_NO_TRANS, MM_NO_TRANS, 1.0, &a, &b, 0.0, &c);
+    }
+    return 0;
+}
+
+int matrix_multiply_strassen(ThreadPool *pool, MatrixArena *arena, const Matrix *A, const Matrix *B, Matrix *C) {
+    if (matrix_check_shapes(A, B, C) != 0) return -1;
+    StrassenCtx ctx;
+    ctx.pool = pool;
+    ctx.params = g_strassen;
+    ctx.arena = arena;
+    MatrixArena *own = NULL;
+    if (!arena) {
+        const size_t bytes = matrix_strassen_scratch_bytes(A->rows, A->cols, B->cols);
+        own = matrix_arena_create(bytes ? bytes : MATRIX_ALIGN, 0);
+        if (!own) return -1;
+        ctx.arena = own;
+    }
+    const MatrixArenaMark mark = matrix_arena_mark(ctx.arena);
+    const int rc = strassen_rec(&ctx, A, B, C);
+    matrix_arena_release(ctx.arena, mark);
+    matrix_arena_destroy(own);
+    return rc;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "matrix_mult.h"
+#include "matrix_internal.h"
+
+#ifdef _WIN32
+  #include <direct.h>
+  #define MKDIR(p) _mkdir(p)
+  #define PATH_SEP '\\'
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define MKDIR(p) mkdir(p, 0755)
+  #define PATH_SEP '/'
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #include <cpuid.h>
+  #define HAVE_CPUID 1
+#endif
+
+#define TUNE_FILE_MAGIC "# matmul tuning table v1"
+
+static pthread_mutex_t tune_lock = PTHREAD_MUTEX_INITIALIZER;
+static MatrixTuneTable g_table;
+static int g_table_state = 0;   // 0: not looked for yet, 1: g_table installed, -1: built-in choice
+
+// ---------- Host identification ----------
+static char cpu_model[128];
+static pthread_once_t cpu_model_once = PTHREAD_ONCE_INIT;
+
+// Leading/trailing blanks dropped, inner runs of blanks squeezed to one
+static void squeeze_spaces(char *s) {
+    char *w = s;
+    for (const char *r = s; *r; ++r) {
+        if ((*r == ' ' || *r == '\t' || *r == '\n' || *r == '\r') && (w == s || w[-1] == ' ')) continue;
+        *w++ = *r == '\t' || *r == '\n' || *r == '\r' ? ' ' : *r;
+    }
+    while (w > s && w[-1] == ' ') --w;
+    *w = '\0';
+}
+
+// x86 brand string from cpuid, else the first "model name" of /proc/cpuinfo
+static void read_cpu_model(void) {
+    snprintf(cpu_model, sizeof(cpu_model), "unknown");
+#ifdef HAVE_CPUID
+    unsigned int regs[12];
+    if (__get_cpuid(0x80000000u, &regs[0], &regs[1], &regs[2], &regs[3]) && regs[0] >= 0x80000004u) {
+        for (unsigned int leaf = 0; leaf < 3; ++leaf)
+            __get_cpuid(0x80000002u + leaf, &regs[4 * leaf], &regs[4 * leaf + 1], &regs[4 * leaf + 2],
+                        &regs[4 * leaf + 3]);
+        memcpy(cpu_model, regs, sizeof(regs));
+        cpu_model[sizeof(regs)] = '\0';
+        squeeze_spaces(cpu_model);
+        if (cpu_model[0]) return;
+    }
+#endif
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (!colon || strncmp(line, "model name", 10) != 0) continue;
+        snprintf(cpu_model, sizeof(cpu_model), "%s", colon + 1);
+        squeeze_spaces(cpu_model);
+        break;
+    }
+    fclose(f);
+    if (!cpu_model[0]) snprintf(cpu_model, sizeof(cpu_model), "unknown");
+}
+
+const char *matrix_cpu_model(void) {
+    pthread_once(&cpu_model_once, read_cpu_model);
+    return cpu_model;
+}
+
+int matrix_tune_default_path(char *out, size_t size) {
+    const char *env = getenv("MATMUL_TUNE_FILE");
+    if (env && env[0]) {
+        snprintf(out, size, "%s", env);
+        return 0;
+    }
+    char host[64] = "localhost";
+#ifdef _WIN32
+    const char *dir = getenv("LOCALAPPDATA");
+    const char *sub = "";
+    const char *name = getenv("COMPUTERNAME");
+    if (name && name[0]) snprintf(host, sizeof(host), "%s", name);
+#else
+    const char *dir = getenv("XDG_CACHE_HOME");
+    const char *sub = "";
+    if (!dir || !dir[0]) {
+        dir = getenv("HOME");
+        sub = ".cache/";
+    }
+    if (gethostname(host, sizeof(host)) != 0 || !host[0]) snprintf(host, sizeof(host), "localhost");
+    host[sizeof(host) - 1] = '\0';
+#endif
+    if (!dir || !dir[0]) return -1;
+    const int len = snprintf(out, size, "%s%c%smatmul%ctune-%s.txt", dir, PATH_SEP, sub, PATH_SEP, host);
+    return len > 0 && (size_t) len < size ? 0 : -1;
+}
+
+// ---------- Tuning files ----------
+int matrix_tune_load(const char *path, MatrixTuneTable *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    MatrixTuneTable t;
+    memset(&t, 0, sizeof(t));
+    char line[256];
+    int ok = fgets(line, sizeof(line), f) && strncmp(line, TUNE_FILE_MAGIC, strlen(TUNE_FILE_MAGIC)) == 0;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (strncmp(line, "cpu ", 4) == 0) {
+            snprintf(t.cpu, sizeof(t.cpu), "%.*s", (int) sizeof(t.cpu) - 1, line + 4);
+            squeeze_spaces(t.cpu);
+            continue;
+        }
+        char kname[32];
+        MatrixTuneEntry e;
+        if (t.count >= MM_TUNE_MAX_CLASSES ||
+            sscanf(line, "class %d %31s %d %d %d %d", &e.size, kname, &e.tiles.mc, &e.tiles.kc, &e.tiles.nc,
+                   &e.threads) != 6 ||
+            matrix_kernel_from_name(kname, &e.kernel) != 0 || e.kernel == MM_KERNEL_AUTO || e.size <= 0 ||
+            e.tiles.mc <= 0 || e.tiles.kc <= 0 || e.tiles.nc <= 0 || e.threads <= 0 ||
+            (t.count > 0 && e.size <= t.classes[t.count - 1].size)) {
+            ok = 0;
+            break;
+        }
+        t.classes[t.count++] = e;
+    }
+    fclose(f);
+    // a table measured on another CPU model would steer this one wrong
+    if (!ok || t.count == 0 || strcmp(t.cpu, matrix_cpu_model()) != 0) return -1;
+    *out = t;
+    return 0;
+}
+
+int matrix_tune_save(const char *path, const MatrixTuneTable *table) {
+    // create the directories of path that do not exist yet
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *p = dir + 1; *p; ++p) {
+        if (*p != '/' && *p != '\\') continue;
+        const char sep = *p;
+        *p = '\0';
+        MKDIR(dir);   // ignore errors if it exists
+        *p = sep;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "%s\n", TUNE_FILE_MAGIC);
+    fprintf(f, "# class <size> <kernel> <mc> <kc> <nc> <threads>\n");
+    fprintf(f, "cpu %s\n", table->cpu);
+    for (int i = 0; i < table->count; ++i) {
+        const MatrixTuneEntry *e = &table->classes[i];
+        fprintf(f, "class %d %s %d %d %d %d\n", e->size, matrix_kernel_name(e->kernel), e->tiles.mc, e->tiles.kc,
+                e->tiles.nc, e->threads);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// ---------- Dispatch ----------
+void matrix_tune_set(const MatrixTuneTable *table) {
+    pthread_mutex_lock(&tune_lock);
+    if (table && table->count > 0) {
+        g_table = *table;
+        g_table_state = 1;
+    } else {
+        g_table_state = -1;
+    }
+    pthread_mutex_unlock(&tune_lock);
+}
+
+int matrix_tune_active(void) {
+    matrix_tune_choice(1, 1, 1);   // looks for the default file on first use
+    pthread_mutex_lock(&tune_lock);
+    const int state = g_table_state;
+    pthread_mutex_unlock(&tune_lock);
+    return state == 1;
+}
+
+MatrixTuneEntry matrix_tune_choice(int m, int k, int n) {
+    const double size = cbrt((double) m * k * n);
+    pthread_mutex_lock(&tune_lock);
+    if (g_table_state == 0) {
+        char path[1024];
+        MatrixTuneTable t;
+        if (matrix_tune_default_path(path, sizeof(path)) == 0 && matrix_tune_load(path, &t) == 0) {
+            g_table = t;
+            g_table_state = 1;
+        } else {
+            g_table_state = -1;
+        }
+    }
+    MatrixTuneEntry e;
+    if (g_table_state == 1) {
+        // the class measured closest on a log scale
+        int best = 0;
+        for (int i = 1; i < g_table.count; ++i)
+            if (fabs(log(size / g_table.classes[i].size)) < fabs(log(size / g_table.classes[best].size))) best = i;
+        e = g_table.classes[best];
+    } else {
+        // built-in choice: unrolled kernels where they exist, packing once B
+        // no longer fits in cache, threads once there is enough work to split
+        e.size = (int) (size + 0.5);
+        e.tiles = matrix_get_tiles();
+        if (matrix_fixed_supported(m, k, n)) e.kernel = MM_KERNEL_FIXED;
+        else e.kernel = size >= 256 ? MM_KERNEL_PACKED : MM_KERNEL_SIMD;
+        e.threads = size >= 128 ? thread_pool_default_threads() : 1;
+    }
+    pthread_mutex_unlock(&tune_lock);
+    return e;
+}
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix_summa.h"
+#include "matrix_internal.h"
+
+// ---------- Process grid ----------
+int matrix_grid_create(MPI_Comm comm, int rows, int cols, MatrixGrid *grid) {
+    int size, rank;
+    MPI_Comm_size(comm, &size);
+    MPI_Comm_rank(comm, &rank);
+    if (rows == 0 && cols == 0) {
+        int dims[2] = { 0, 0 };
+        MPI_Dims_create(size, 2, dims);
+        rows = dims[0];
+        cols = dims[1];
+    }
+    if (rows <= 0 || cols <= 0 || rows * cols != size) return -1;
+    grid->comm = comm;
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->row = rank / cols;
+    grid->col = rank % cols;
+    MPI_Comm_split(comm, grid->row, grid->col, &grid->row_comm);
+    MPI_Comm_split(comm, grid->col, grid->row, &grid->col_comm);
+    return 0;
+}
+
+void matrix_grid_free(MatrixGrid *grid) {
+    if (grid->row_comm != MPI_COMM_NULL) MPI_Comm_free(&grid->row_comm);
+    if (grid->col_comm != MPI_COMM_NULL) MPI_Comm_free(&grid->col_comm);
+}
+
+void matrix_block_range(int len, int parts, int index, int *start, int *count) {
+    const int base = len / parts, rem = len % parts;
+    *start = index * base + min_int(index, rem);
+    *count = base + (index < rem ? 1 : 0);
+}
+
+static int block_owner(int len, int parts, int idx) {
+    for (int p = 0; p < parts; p++) {
+        int start, count;
+        matrix_block_range(len, parts, p, &start, &count);
+        if (idx < start + count) return p;
+    }
+    return parts - 1;
+}
+
+// ---------- SUMMA ----------
+// One broadcast step: columns [k0, k0 + width) of A and the same rows of B.
+// A panels never straddle two grid columns, nor B panels two grid rows.
+typedef struct {
+    int k0;
+    int width;
+    int a_root;   // grid column that owns these columns of A
+    int b_root;   // grid row that owns these rows of B
+} SummaPanel;
+
+typedef struct {
+    const MatrixGrid *grid;
+    const Matrix *A;
+    const Matrix *B;
+    int rows;          // local block of C
+    int cols;
+    int a_k0;          // first global column of the local A block
+    int b_k0;          // first global row of the local B block
+    double *abuf[2];
+    double *bbuf[2];
+    Matrix Ap[2];      // panel in flight or being multiplied, per slot
+    Matrix Bp[2];
+    MPI_Request req[2][2];
+} SummaCtx;
+
+static int plan_panels(const MatrixGrid *grid, int k, int panel, SummaPanel *out) {
+    int count = 0;
+    for (int k0 = 0; k0 < k;) {
+        const int a_root = block_owner(k, grid->cols, k0), b_root = block_owner(k, grid->rows, k0);
+        int as, ac, bs, bc;
+        matrix_block_range(k, grid->cols, a_root, &as, &ac);
+        matrix_block_range(k, grid->rows, b_root, &bs, &bc);
+        const int end = min_int(min_int(k0 + panel, as + ac), bs + bc);
+        if (out) out[count] = (SummaPanel) { k0, end - k0, a_root, b_root };
+        count++;
+        k0 = end;
+    }
+    return count;
+}
+
+// Empty blocks (more grid rows or columns than the dimension) need no storage
+static int block_ok(const Matrix *M, int rows, int cols) {
+    if (rows == 0 || cols == 0) return 1;
+    return M->data && M->rows == rows && M->cols == cols;
+}
+
+// Owners pack their part of panel p into the slot, then both broadcasts start
+static void post_panel(SummaCtx *cx, const SummaPanel *p, int slot) {
+    const MatrixGrid *g = cx->grid;
+    const int rows = cx->rows, cols = cx->cols;
+    const int lda = padded_ld(p->width), ldb = padded_ld(cols);
+
+    cx->Ap[slot] = (Matrix) { cx->abuf[slot], rows, p->width, lda, 0 };
+    if (g->col == p->a_root) {
+        for (int i = 0; i < rows; i++)
+            memcpy(&MAT_AT(&cx->Ap[slot], i, 0), &MAT_AT(cx->A, i, p->k0 - cx->a_k0), (size_t) p->width * sizeof(double));
+    }
+    MPI_Ibcast(cx->abuf[slot], rows * lda, MPI_DOUBLE, p->a_root, g->row_comm, &cx->req[slot][0]);
+
+    // whole rows of B: the owner sends straight from its block when the strides match
+    cx->Bp[slot] = (Matrix) { cx->bbuf[slot], p->width, cols, ldb, 0 };
+    if (g->row == p->b_root) {
+        if (cx->B->ld == ldb) {
+            cx->Bp[slot].data = (double*) &MAT_AT(cx->B, p->k0 - cx->b_k0, 0);
+        } else {
+            for (int i = 0; i < p->width; i++)
+                memcpy(&MAT_AT(&cx->Bp[slot], i, 0), &MAT_AT(cx->B, p->k0 - cx->b_k0 + i, 0), (size_t) cols * sizeof(double));
+        }
+    }
+    MPI_Ibcast(cx->Bp[slot].data, p->width * ldb, MPI_DOUBLE, p->b_root, g->col_comm, &cx->req[slot][1]);
+}
+
+int matrix_multiply_summa(const MatrixGrid *grid, ThreadPool *pool, int m, int k, int n, int panel,
+                          const Matrix *A, const Matrix *B, Matrix *C, MatrixSummaStats *stats) {
+    if (m <= 0 || k <= 0 || n <= 0) return -1;
+    int r0, rows, c0, cols, ak0, acols, bk0, brows;
+    matrix_block_range(m, grid->rows, grid->row, &r0, &rows);
+    matrix_block_range(n, grid->cols, grid->col, &c0, &cols);
+    matrix_block_range(k, grid->cols, grid->col, &ak0, &acols);
+    matrix_block_range(k, grid->rows, grid->row, &bk0, &brows);
+    if (panel <= 0) panel = matrix_get_tiles().kc;
+
+    SummaCtx cx;
+    memset(&cx, 0, sizeof(cx));
+    cx.grid = grid;
+    cx.A = A;
+    cx.B = B;
+    cx.rows = rows;
+    cx.cols = cols;
+    cx.a_k0 = ak0;
+    cx.b_k0 = bk0;
+    const int npanels = plan_panels(grid, k, panel, NULL);
+    SummaPanel *panels = (SummaPanel*) malloc((size_t) npanels * sizeof(SummaPanel));
+    const size_t abytes = (size_t) rows * padded_ld(panel) * sizeof(double);
+    const size_t bbytes = (size_t) panel * padded_ld(cols) * sizeof(double);
+    int ok = panels != NULL && block_ok(A, rows, acols) && block_ok(B, brows, cols) && block_ok(C, rows, cols);
+    for (int s = 0; s < 2 && ok; s++) {
+        // empty blocks still need a valid buffer address for MPI
+        cx.abuf[s] = (double*) aligned_malloc(abytes ? abytes : MATRIX_ALIGN);
+        cx.bbuf[s] = (double*) aligned_malloc(bbytes ? bbytes : MATRIX_ALIGN);
+        ok = cx.abuf[s] && cx.bbuf[s];
+    }
+    // a rank that cannot take part would leave the others blocked in a broadcast
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, grid->comm);
+
+    double wait_sec = 0.0, compute_sec = 0.0;
+    if (all_ok) {
+        plan_panels(grid, k, panel, panels);
+        post_panel(&cx, &panels[0], 0);
+        for (int t = 0; t < npanels; t++) {
+            const int slot = t % 2;
+            // the next panel travels while this one is multiplied
+            if (t + 1 < npanels) post_panel(&cx, &panels[t + 1], 1 - slot);
+            const double w0 = wall_seconds();
+            MPI_Waitall(2, cx.req[slot], MPI_STATUSES_IGNORE);
+            const double w1 = wall_seconds();
+            wait_sec += w1 - w0;
+            if (rows > 0 && cols > 0)
+                matrix_gemm_parallel(pool, 1.0, &cx.Ap[slot], &cx.Bp[slot], t == 0 ? 0.0 : 1.0, C);
+            compute_sec += wall_seconds() - w1;
+        }
+    }
+    if (stats) {
+        stats->wait_sec = wait_sec;
+        stats->compute_sec = compute_sec;
+        stats->panels = all_ok ? npanels : 0;
+    }
+    for (int s = 0; s < 2; s++) {
+        aligned_free(cx.abuf[s]);
+        aligned_free(cx.bbuf[s]);
+    }
+    free(panels);
+    return all_ok ? 0 : -1;
+}
@@ -0,0 +1,48 @@
+#ifndef MATRIX_SUMMA_H
+#define MATRIX_SUMMA_H
+
+// Distributed C = A * B over MPI (SUMMA). Built only with an MPI compiler:
+//   mpicc -O3 -Isrc -Isrc/mpi ... src/*.c src/mpi/*.c
+
+#include <mpi.h>
+
+#include "matrix_mult.h"
+
+// 2D process grid. Every global matrix is split into grid.rows x grid.cols
+// blocks; the rank at (row, col) owns block (row, col) of A, B and C.
+typedef struct {
+    MPI_Comm comm;       // all ranks of the grid
+    MPI_Comm row_comm;   // ranks in the same grid row, ordered by column
+    MPI_Comm col_comm;   // ranks in the same grid column, ordered by row
+    int rows;
+    int cols;
+    int row;             // this rank's coordinates
+    int col;
+} MatrixGrid;
+
+// rows x cols must equal the size of comm; rows == cols == 0 picks the most
+// square grid (MPI_Dims_create). Collective; returns -1 on bad dimensions.
+int matrix_grid_create(MPI_Comm comm, int rows, int cols, MatrixGrid *grid);
+void matrix_grid_free(MatrixGrid *grid);
+
+// Block 'index' of a dimension of length len split into 'parts' nearly equal
+// blocks: [*start, *start + *count)
+void matrix_block_range(int len, int parts, int index, int *start, int *count);
+
+typedef struct {
+    double wait_sec;      // time spent blocked on panel broadcasts
+    double compute_sec;   // time in the local kernel
+    int panels;           // broadcast steps
+} MatrixSummaStats;
+
+// Global C (m x n) = A (m x k) * B (k x n). A, B and C are this rank's blocks
+// (sizes from matrix_block_range on the grid; an empty block may be a zeroed
+// Matrix). Each step broadcasts a panel of at most 'panel' columns of A
+// (0: the kc tile) along grid rows and the matching rows of B along grid
+// columns, and the next panel is already in flight while the pool multiplies
+// the current one. Collective; -1 if a local block has the wrong shape or a
+// buffer cannot be allocated. stats may be NULL.
+int matrix_multiply_summa(const MatrixGrid *grid, ThreadPool *pool, int m, int k, int n, int panel,
+                          const Matrix *A, const Matrix *B, Matrix *C, MatrixSummaStats *stats);
+
+#endif
@@ -0,0 +1,443 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE   // pthread_setaffinity_np, CPU_SET
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "thread_pool.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+  #define cpu_yield() SwitchToThread()
+#else
+  #include <sched.h>
+  #include <unistd.h>
+  #define cpu_yield() sched_yield()
+#endif
+
+#ifdef __linux__
+  #include <dirent.h>
+  #include <sys/syscall.h>
+#endif
+
+// Chase-Lev style deque over a contiguous task range [base + top, base + bottom).
+// The owner pops at the bottom, thieves take from the top. Tasks are only added
+// before a job is published, so the deque never grows while it is shared.
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    long base;
+    char pad[64 - 2 * sizeof(atomic_long) - sizeof(long)];   // one deque per cache line
+} TaskDeque;
+
+#define DEQUE_EMPTY (-1L)
+#define DEQUE_ABORT (-2L)
+
+static void deque_reset(TaskDeque *d, long begin, long end) {
+    d->base = begin;
+    atomic_store_explicit(&d->top, 0, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, end - begin, memory_order_relaxed);
+}
+
+static long deque_pop(TaskDeque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return DEQUE_EMPTY;
+    }
+    long task = d->base + b;
+    if (t == b) {
+        // last item: race thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed))
+            task = DEQUE_EMPTY;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static long deque_steal(TaskDeque *d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return DEQUE_EMPTY;
+    long task = d->base + t;
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return DEQUE_ABORT;
+    return task;
+}
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+    int cpu;   // CPU to pin to, -1 for none
+} WorkerArg;
+
+struct ThreadPool {
+    int nthreads;
+    pthread_t *threads;
+    WorkerArg *args;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;   // bumped once per job
+    int pending;                // workers still busy with the current job
+    int shutdown;
+
+    // current job
+    pool_task_fn fn;
+    void *arg;
+    int ntasks;
+    int each;                   // run fn once per worker instead of over the deques
+    TaskDeque *deques;          // one per worker
+    atomic_int remaining;       // tasks not yet finished
+    atomic_long steals;         // cumulative, for diagnostics
+
+    PoolAffinity affinity;
+    int *cpus;                  // CPU of each worker, -1 if unpinned
+#ifdef __linux__
+    cpu_set_t caller_mask;      // worker 0's affinity before the pool pinned it
+#endif
+};
+
+int thread_pool_default_threads(void) {
+    const char *env = getenv("MATMUL_THREADS");
+    if (env && atoi(env) > 0) return atoi(env);
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int) si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+#endif
+}
+
+// ---------- Topology and pinning ----------
+int thread_pool_cpu_node(int cpu) {
+#ifdef __linux__
+    // /sys/devices/system/cpu/cpuN holds a nodeM link on NUMA kernels
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    int node = 0;
+    for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+        if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+#else
+    (void) cpu;
+    return 0;
+#endif
+}
+
+int thread_pool_current_cpu(int *node) {
+#ifdef __linux__
+    unsigned int cpu = 0, nd = 0;
+    if (syscall(SYS_getcpu, &cpu, &nd, NULL) != 0) return -1;
+    if (node) *node = (int) nd;
+    return (int) cpu;
+#elif defined(_WIN32)
+    PROCESSOR_NUMBER pn;
+    GetCurrentProcessorNumberEx(&pn);
+    USHORT nd = 0;
+    if (node) *node = GetNumaProcessorNodeEx(&pn, &nd) ? (int) nd : 0;
+    return (int) pn.Number;
+#else
+    if (node) *node = 0;
+    return -1;
+#endif
+}
+
+PoolAffinity thread_pool_default_affinity(void) {
+    const char *env = getenv("MATMUL_AFFINITY");
+    PoolAffinity a = POOL_AFFINITY_NONE;
+    if (env) thread_pool_affinity_from_name(env, &a);
+    return a;
+}
+
+static const char *const affinity_names[] = { "none", "compact", "scatter" };
+
+const char *thread_pool_affinity_name(PoolAffinity a) {
+    if (a < POOL_AFFINITY_NONE || a > POOL_AFFINITY_SCATTER) return "unknown";
+    return affinity_names[a];
+}
+
+int thread_pool_affinity_from_name(const char *name, PoolAffinity *out) {
+    for (int a = POOL_AFFINITY_NONE; a <= POOL_AFFINITY_SCATTER; a++) {
+        if (strcmp(name, affinity_names[a]) == 0) {
+            *out = (PoolAffinity) a;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#ifdef __linux__
+// CPUs this process may run on, ordered for the policy: compact walks node by
+// node, scatter takes one CPU from each node in turn. Returns the count.
+static int order_cpus(PoolAffinity affinity, int *order, int max) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+    int count = 0, nodes = 0;
+    int *cpu = (int*) malloc((size_t) max * sizeof(int));
+    int *node = (int*) malloc((size_t) max * sizeof(int));
+    if (!cpu || !node) {
+        free(cpu);
+        free(node);
+        return 0;
+    }
+    for (int c = 0; c < CPU_SETSIZE && count < max; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        cpu[count] = c;
+        node[count] = thread_pool_cpu_node(c);
+        if (node[count] + 1 > nodes) nodes = node[count] + 1;
+        count++;
+    }
+    int out = 0;
+    if (affinity == POOL_AFFINITY_COMPACT) {
+        for (int nd = 0; nd < nodes; nd++)
+            for (int i = 0; i < count; i++)
+                if (node[i] == nd) order[out++] = cpu[i];
+    } else {
+        // round r takes the r-th CPU of every node that still has one
+        for (int r = 0; out < count; r++)
+            for (int nd = 0; nd < nodes; nd++) {
+                int seen = 0;
+                for (int i = 0; i < count; i++) {
+                    if (node[i] != nd) continue;
+                    if (seen++ == r) {
+                        order[out++] = cpu[i];
+                        break;
+                    }
+                }
+            }
+    }
+    free(cpu);
+    free(node);
+    return out;
+}
+
+static void pin_self(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+#endif
+
+// Fills pool->cpus for the policy; leaves every entry -1 where pinning is unsupported
+static void plan_affinity(ThreadPool *pool) {
+    for (int w = 0; w < pool->nthreads; w++) pool->cpus[w] = -1;
+    if (pool->affinity == POOL_AFFINITY_NONE) return;
+#ifdef __linux__
+    int order[CPU_SETSIZE];
+    const int count = order_cpus(pool->affinity, order, CPU_SETSIZE);
+    for (int w = 0; count > 0 && w < pool->nthreads; w++) pool->cpus[w] = order[w % count];
+#endif
+}
+
+// Drain our own deque, then steal from the others until the whole job is finished
+static void run_worker(ThreadPool *pool, int worker) {
+    unsigned int rng = 2654435761u * (unsigned int) (worker + 1);
+    for (;;) {
+        long task = deque_pop(&pool->deques[worker]);
+        if (task == DEQUE_EMPTY) {
+            if (atomic_load_explicit(&pool->remaining, memory_order_acquire) == 0) return;
+            // sweep the victims starting at a random one
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            const int start = (int) (rng % (unsigned int) pool->nthreads);
+            for (int i = 0; i < pool->nthreads && task < 0; i++) {
+                const int victim = (start + i) % pool->nthreads;
+                if (victim == worker) continue;
+                do {
+                    task = deque_steal(&pool->deques[victim]);
+                } while (task == DEQUE_ABORT);
+            }
+            if (task < 0) {
+                cpu_yield();   // the rest is in flight on other workers
+                continue;
+            }
+            atomic_fetch_add_explicit(&pool->steals, 1, memory_order_relaxed);
+        }
+        pool->fn(pool->arg, (int) task, worker);
+        atomic_fetch_sub_explicit(&pool->remaining, 1, memory_order_acq_rel);
+    }
+}
+
+static void *worker_main(void *p) {
+    WorkerArg *wa = (WorkerArg*) p;
+    ThreadPool *pool = wa->pool;
+    unsigned long seen = 0;
+#ifdef __linux__
+    if (wa->cpu >= 0) pin_self(wa->cpu);
+#endif
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        const int each = pool->each;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (each) pool->fn(pool->arg, wa->index, wa->index);
+        else run_worker(pool, wa->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->work_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+ThreadPool *thread_pool_create(int nthreads) {
+    return thread_pool_create_pinned(nthreads, thread_pool_default_affinity());
+}
+
+ThreadPool *thread_pool_create_pinned(int nthreads, PoolAffinity affinity) {
+    if (nthreads <= 0) nthreads = thread_pool_default_threads();
+    ThreadPool *pool = (ThreadPool*) calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->nthreads = nthreads;
+    pool->affinity = affinity;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // worker 0 is the caller of thread_pool_run
+    pool->threads = (pthread_t*) calloc((size_t) nthreads, sizeof(pthread_t));
+    pool->args = (WorkerArg*) calloc((size_t) nthreads, sizeof(WorkerArg));
+    pool->deques = (TaskDeque*) calloc((size_t) nthreads, sizeof(TaskDeque));
+    pool->cpus = (int*) calloc((size_t) nthreads, sizeof(int));
+    if (!pool->threads || !pool->args || !pool->deques || !pool->cpus) {
+        pool->nthreads = 1;
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    plan_affinity(pool);
+#ifdef __linux__
+    // the creating thread is worker 0; its old mask comes back on destroy
+    if (pool->cpus[0] >= 0) {
+        if (pthread_getaffinity_np(pthread_self(), sizeof(pool->caller_mask), &pool->caller_mask) == 0)
+            pin_self(pool->cpus[0]);
+        else
+            pool->cpus[0] = -1;
+    }
+#endif
+    for (int w = 1; w < nthreads; w++) {
+        pool->args[w].pool = pool;
+        pool->args[w].index = w;
+        pool->args[w].cpu = pool->cpus[w];
+        if (pthread_create(&pool->threads[w], NULL, worker_main, &pool->args[w]) != 0) {
+            pool->nthreads = w;   // only join what was started
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 1; w < pool->nthreads; w++) pthread_join(pool->threads[w], NULL);
+#ifdef __linux__
+    if (pool->cpus && pool->cpus[0] >= 0)
+        pthread_setaffinity_np(pthread_self(), sizeof(pool->caller_mask), &pool->caller_mask);
+#endif
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->deques);
+    free(pool->cpus);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->nthreads : 1;
+}
+
+PoolAffinity thread_pool_affinity(const ThreadPool *pool) {
+    return pool ? pool->affinity : POOL_AFFINITY_NONE;
+}
+
+int thread_pool_worker_cpu(const ThreadPool *pool, int worker) {
+    if (!pool || worker < 0 || worker >= pool->nthreads) return -1;
+    return pool->cpus[worker];
+}
+
+long thread_pool_steals(const ThreadPool *pool) {
+    return pool ? atomic_load(&((ThreadPool*) pool)->steals) : 0;
+}
+
+void thread_pool_run(ThreadPool *pool, int ntasks, pool_task_fn fn, void *arg) {
+    if (ntasks <= 0) return;
+    if (!pool || pool->nthreads == 1) {
+        for (int t = 0; t < ntasks; t++) fn(arg, t, 0);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->ntasks = ntasks;
+    for (int w = 0; w < pool->nthreads; w++) {
+        deque_reset(&pool->deques[w], (long) ntasks * w / pool->nthreads,
+                    (long) ntasks * (w + 1) / pool->nthreads);
+    }
+    atomic_store(&pool->remaining, ntasks);
+    pool->pending = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_worker(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->work_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_run_each(ThreadPool *pool, pool_task_fn fn, void *arg) {
+    if (!pool || pool->nthreads == 1) {
+        fn(arg, 0, 0);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->each = 1;
+    pool->pending = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    fn(arg, 0, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->work_done, &pool->lock);
+    pool->each = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
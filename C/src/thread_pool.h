@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Persistent worker pool: threads are created once and parked between jobs,
+// so callers can reuse one pool across many multiplies.
+typedef struct ThreadPool ThreadPool;
+
+// Runs task 'task' of a job; 'worker' is in [0, thread_pool_size)
+typedef void (*pool_task_fn)(void *arg, int task, int worker);
+
+// Thread count from MATMUL_THREADS, else the number of online CPUs
+int thread_pool_default_threads(void);
+
+// Where workers run. COMPACT fills the CPUs of one NUMA node before moving
+// to the next (shared caches, one memory controller); SCATTER takes one CPU
+// from each node in turn so every node's memory bandwidth is used. Only the
+// CPUs in the process's affinity mask are used. Pinning is implemented on
+// Linux; elsewhere workers stay unpinned.
+typedef enum {
+    POOL_AFFINITY_NONE,
+    POOL_AFFINITY_COMPACT,
+    POOL_AFFINITY_SCATTER
+} PoolAffinity;
+
+// MATMUL_AFFINITY (none, compact, scatter) if set, else none
+PoolAffinity thread_pool_default_affinity(void);
+const char *thread_pool_affinity_name(PoolAffinity a);
+int thread_pool_affinity_from_name(const char *name, PoolAffinity *out);
+
+// nthreads counts the calling thread; <= 0 means thread_pool_default_threads().
+// Uses thread_pool_default_affinity(). Returns NULL if the workers could not be started.
+ThreadPool *thread_pool_create(int nthreads);
+// Same with an explicit policy. Worker 0 is the creating thread: it is pinned
+// too, and gets its previous affinity back in thread_pool_destroy.
+ThreadPool *thread_pool_create_pinned(int nthreads, PoolAffinity affinity);
+void thread_pool_destroy(ThreadPool *pool);
+int thread_pool_size(const ThreadPool *pool);
+PoolAffinity thread_pool_affinity(const ThreadPool *pool);
+// CPU worker w is pinned to, -1 if it is not pinned
+int thread_pool_worker_cpu(const ThreadPool *pool, int worker);
+
+// NUMA node of a CPU (0 when the topology is unknown)
+int thread_pool_cpu_node(int cpu);
+// CPU the calling thread is running on right now (-1 if unknown); *node gets its NUMA node
+int thread_pool_current_cpu(int *node);
+
+// Runs fn(arg, t, worker) for t in [0, ntasks) and returns when all are done.
+// The caller participates as worker 0. Worker w starts with the contiguous
+// range [w*ntasks/P, (w+1)*ntasks/P) in its own deque; once that is empty it
+// steals from the other workers, so a slow or descheduled thread does not
+// hold up the job.
+void thread_pool_run(ThreadPool *pool, int ntasks, pool_task_fn fn, void *arg);
+
+// Runs fn(arg, w, w) exactly once on every worker w, each on its own thread
+// (the caller is worker 0); no stealing. For per-thread setup such as
+// opening thread-local counters.
+void thread_pool_run_each(ThreadPool *pool, pool_task_fn fn, void *arg);
+
+// Total number of tasks taken from another worker's deque since creation
+long thread_pool_steals(const ThreadPool *pool);
+
+#endif
@@ -1,10 +1,23 @@
+import java.nio.ByteBuffer;
+import java.nio.DoubleBuffer;
+import java.nio.charset.StandardCharsets;
 import java.nio.file.*;
 import java.io.*;
 import java.time.LocalDateTime;
 import java.time.format.DateTimeFormatter;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
 
 public class Benchmark {
 
+    // Same columns as the C harness (CSV_HEADER in C/benchmark/Benchmark.c); columns are only ever appended
+    private static final String CSV_HEADER = "language,matrix_size,run_index,elapsed_sec,memory_used_mb,"
+            + "timestamp_iso,kernel,setup_sec,threads,shape,mults_per_sec,rel_error,precision,load_sec,ranks,"
+            + "density,transfer_sec,p50_sec,p99_sec,gflops,cycles,instructions,l1d_misses,llc_misses,dtlb_misses,"
+            + "alloc_peak_bytes,peak_rss_mb,minor_faults,major_faults,cache,overhead_sec";
+
     // ----- CSV Utilities -----
     private static Path resolveCsv() throws IOException {
         String env = System.getenv("RESULTS_CSV");
@@ -14,9 +27,22 @@ public class Benchmark {
         Files.createDirectories(p.toAbsolutePath().getParent());
         if (!Files.exists(p)) {
             try (BufferedWriter w = Files.newBufferedWriter(p)) {
-                w.write("language,matrix_size,run_index,elapsed_sec,memory_used_mb,timestamp_iso");
+                w.write(CSV_HEADER);
                 w.newLine();
             }
+            return p;
+        }
+        // a file written with an older schema has a prefix of the header: rewrite that line
+        List<String> lines = Files.readAllLines(p);
+        String header = lines.isEmpty() ? "" : lines.get(0);
+        if (!header.equals(CSV_HEADER)) {
+            if (!header.isEmpty() && CSV_HEADER.startsWith(header + ",")) {
+                lines.set(0, CSV_HEADER);
+                Files.write(p, lines);
+                System.out.println("[INFO] Upgraded CSV header to current schema");
+            } else {
+                System.err.println("[WARN] Unrecognized CSV header in " + p);
+            }
         }
         return p;
     }
@@ -29,14 +55,135 @@ public class Benchmark {
         }
     }
 
-    private static long usedBytes() {
+    private static String fmt(String format, double v) {
+        return String.format(Locale.ROOT, format, v);
+    }
+
+    // One CSV line in CSV_HEADER order. Negative mem[] entries and overhead were not measured
+    private static String csvRow(int n, int run, double elapsed, double memUsedMB, String kernel, int threads,
+                                 double[] mem, double overhead) {
+        String ts = LocalDateTime.now().format(DateTimeFormatter.ofPattern("yyyy-MM-dd'T'HH:mm:ss"));
+        double flops = 2.0 * n * n * n;
+        List<String> f = new ArrayList<>();
+        f.add("Java");
+        f.add(Integer.toString(n));
+        f.add(Integer.toString(run));
+        f.add(fmt("%.6f", elapsed));
+        f.add(fmt("%.3f", memUsedMB));
+        f.add(ts);
+        f.add(kernel);
+        f.add("0.000000");                                   // setup_sec
+        f.add(Integer.toString(threads));
+        f.add(n + "x" + n + "x" + n);
+        f.add(fmt("%.3f", elapsed > 0 ? 1.0 / elapsed : 0.0));
+        f.add("");                                           // rel_error
+        f.add("fp64");
+        f.add("0.000000");                                   // load_sec
+        f.add("1");                                          // ranks
+        f.add("");                                           // density
+        f.add("0.000000");                                   // transfer_sec
+        f.add("");                                           // p50_sec
+        f.add("");                                           // p99_sec
+        f.add(elapsed > 0 ? fmt("%.3f", flops / elapsed / 1e9) : "");
+        for (int e = 0; e < 5; e++) f.add("");               // perf counters
+        f.add("");                                           // alloc_peak_bytes: no library allocations
+        f.add(mem[0] >= 0 ? fmt("%.3f", mem[0]) : "");
+        f.add(mem[1] >= 0 ? fmt("%.0f", mem[1]) : "");
+        f.add(mem[2] >= 0 ? fmt("%.0f", mem[2]) : "");
+        f.add("hot");
+        f.add(overhead >= 0 ? fmt("%.9f", overhead) : "");
+        return String.join(",", f);
+    }
+
+    // ----- Memory probes (the C harness's sources: /proc on Linux) -----
+    private static long statusKb(String field) {
+        try {
+            for (String line : Files.readAllLines(Paths.get("/proc/self/status"))) {
+                if (line.startsWith(field + ":")) return Long.parseLong(line.replaceAll("[^0-9]", ""));
+            }
+        } catch (IOException | RuntimeException e) {
+            // not Linux
+        }
+        return -1;
+    }
+
+    // Resident set in MB; the Java heap in use where /proc is missing
+    private static double usedMB() {
+        long kb = statusKb("VmRSS");
+        if (kb >= 0) return kb / 1024.0;
         Runtime rt = Runtime.getRuntime();
-        return rt.totalMemory() - rt.freeMemory();
+        return (rt.totalMemory() - rt.freeMemory()) / (1024.0 * 1024.0);
+    }
+
+    // Linux 4.0+ restarts the VmHWM mark when "5" is written to clear_refs
+    private static boolean resetPeakRss() {
+        try {
+            Files.write(Paths.get("/proc/self/clear_refs"), "5".getBytes(StandardCharsets.US_ASCII));
+            return true;
+        } catch (IOException | RuntimeException e) {
+            return false;
+        }
+    }
+
+    // {minor, major} page faults of the process, {-1, -1} without /proc
+    private static long[] pageFaults() {
+        try {
+            String stat = new String(Files.readAllBytes(Paths.get("/proc/self/stat")), StandardCharsets.US_ASCII);
+            String[] f = stat.substring(stat.lastIndexOf(')') + 2).trim().split(" +");
+            return new long[] { Long.parseLong(f[7]), Long.parseLong(f[9]) };
+        } catch (IOException | RuntimeException e) {
+            return new long[] { -1, -1 };
+        }
+    }
+
+    // Counters sampled just before a run, as mem_probe_start in the C harness
+    private static final class MemProbe {
+        final boolean peakReset = resetPeakRss();
+        final long[] faults = pageFaults();
+        final double startMB = usedMB();
+
+        // {peak_rss_mb, minor_faults, major_faults} into mem; returns the growth in MB, from the
+        // start to the peak where the peak could be reset, to the end otherwise
+        double stop(double[] mem) {
+            double endMB = usedMB();
+            long[] end = pageFaults();
+            long hwm = statusKb("VmHWM");
+            mem[0] = hwm >= 0 ? hwm / 1024.0 : -1.0;
+            mem[1] = end[0] >= 0 && faults[0] >= 0 ? end[0] - faults[0] : -1.0;
+            mem[2] = end[1] >= 0 && faults[1] >= 0 ? end[1] - faults[1] : -1.0;
+            double grown = (peakReset && mem[0] >= 0 ? mem[0] : endMB) - startMB;
+            return Math.max(0.0, grown);
+        }
+    }
+
+    // ----- Run statistics (as the C harness) -----
+    // Nearest-rank percentile (0..100); sorts values in place
+    private static double percentile(double[] values, int count, double pct) {
+        Arrays.sort(values, 0, count);
+        int rank = Math.max(1, (int) Math.ceil(pct / 100.0 * count));
+        return values[rank - 1];
+    }
+
+    // 95% percentile-bootstrap interval of the median, with the C harness's fixed xorshift64 stream
+    private static double[] bootstrapMedianCi(double[] times, int count) {
+        if (count < 2) return new double[] { times[0], times[0] };
+        double[] sample = new double[count];
+        double[] medians = new double[1000];
+        long state = 0x9E3779B97F4A7C15L;
+        for (int b = 0; b < medians.length; b++) {
+            for (int i = 0; i < count; i++) {
+                state ^= state << 13;
+                state ^= state >>> 7;
+                state ^= state << 17;
+                sample[i] = times[(int) Long.remainderUnsigned(state, count)];
+            }
+            medians[b] = percentile(sample, count, 50.0);
+        }
+        return new double[] { percentile(medians, medians.length, 2.5), percentile(medians, medians.length, 97.5) };
     }
 
     // ----- Generation and multiplication of matrix -----
-    private static double[][] randomMatrix(int n) {
-        java.util.Random rnd = new java.util.Random();
+    private static double[][] randomMatrix(int n, java.util.Random rnd) {
         double[][] M = new double[n][n];
         for (int i = 0; i < n; i++) {
             double[] Mi = M[i];
@@ -47,6 +194,13 @@ public class Benchmark {
         return M;
     }
 
+    private static double[][] toArray(ByteBuffer buf, int n) {
+        DoubleBuffer d = buf.asDoubleBuffer();
+        double[][] M = new double[n][n];
+        for (int i = 0; i < n; i++) d.get(M[i]);   // rows are consecutive
+        return M;
+    }
+
     private static double[][] multiply(double[][] A, double[][] B) {
         int n = A.length;
         double[][] C = new double[n][n];
@@ -64,58 +218,188 @@ public class Benchmark {
         return C;
     }
 
+    // ----- Timed runs -----
+    // One multiply; returns the kernel's own time in seconds, or -1 if it has none (the Java loop)
+    private interface Multiply {
+        double run();
+    }
+
+    // Warmup runs, then 'runs' recorded ones, timed and probed as the C harness does
+    private static void runSeries(Path csv, int n, String kernel, int threads, int warmup, int runs, Multiply mul)
+            throws IOException {
+        System.out.println("---------------------------------------");
+        System.out.printf("Kernel: %s | Threads: %d%n", kernel, threads);
+        for (int w = 0; w < warmup; w++) mul.run();
+
+        double[] times = new double[runs];
+        double[] overheads = new double[runs];
+        double total = 0.0;
+        for (int r = 1; r <= runs; r++) {
+            MemProbe probe = new MemProbe();
+            long t0 = System.nanoTime();
+            double inner = mul.run();
+            long t1 = System.nanoTime();
+            double[] mem = new double[3];
+            double memUsedMB = probe.stop(mem);
+
+            double elapsed = (t1 - t0) / 1e9;
+            // what crossing into the library costs: the call minus the multiply it timed itself
+            double overhead = inner >= 0 ? Math.max(0.0, elapsed - inner) : -1.0;
+            total += elapsed;
+            times[r - 1] = elapsed;
+            overheads[r - 1] = overhead;
+
+            appendCsv(csv, csvRow(n, r, elapsed, memUsedMB, kernel, threads, mem, overhead));
+
+            // Console Log
+            System.out.printf(Locale.ROOT, "Run %d: %.6f s | %.2f GFLOP/s | Memory used: %.3f MB", r, elapsed,
+                    elapsed > 0 ? 2.0 * n * n * n / elapsed / 1e9 : 0.0, memUsedMB);
+            if (mem[0] >= 0) System.out.printf(Locale.ROOT, " | peak RSS %.1f MB", mem[0]);
+            if (overhead >= 0) System.out.printf(Locale.ROOT, " | call overhead %.3f us", overhead * 1e6);
+            System.out.println();
+        }
+        System.out.printf(Locale.ROOT, "Average time (%s, %d threads): %.6f s%n", kernel, threads, total / runs);
+        double[] ci = bootstrapMedianCi(times, runs);
+        double median = percentile(times.clone(), runs, 50.0);
+        System.out.printf(Locale.ROOT, "Median %.6f s | p95 %.6f s | 95%% CI of median [%.6f, %.6f] | %d runs%n",
+                median, percentile(times.clone(), runs, 95.0), ci[0], ci[1], runs);
+        if (overheads[0] >= 0) {
+            double o = percentile(overheads, runs, 50.0);
+            System.out.printf(Locale.ROOT, "Call overhead: median %.3f us (%.2f%% of the median time)%n", o * 1e6,
+                    median > 0 ? 100.0 * o / median : 0.0);
+        }
+    }
+
+    private static double maxAbsDiff(double[][] X, ByteBuffer Y, int n) {
+        DoubleBuffer d = Y.asDoubleBuffer();
+        double worst = 0.0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) worst = Math.max(worst, Math.abs(X[i][j] - d.get(i * n + j)));
+        return worst;
+    }
+
+    private static int[] parseInts(String list) {
+        return Arrays.stream(list.split(",")).mapToInt(Integer::parseInt).toArray();
+    }
+
+    private static void printUsage() {
+        System.out.println("Usage: java Benchmark <matrix_size> <num_runs> [options]");
+        System.out.println("  --sizes N[,N...]    run these sizes instead of <matrix_size>");
+        System.out.println("  --warmup W          untimed runs before the recorded ones (default 0)");
+        System.out.println("  --seed S            seed of the random inputs (default: the current time, logged)");
+        System.out.println("  --native K[,K...]   also run these C kernels through JNI (NativeMatrix), e.g. packed");
+        System.out.println("  --threads T         threads of the native kernels (default 1)");
+        System.out.println("  --native-only       skip the Java loop");
+    }
+
     // ----- Main Program -----
     public static void main(String[] args) {
         try {
             if (args.length < 2) {
-                System.out.println("Usage: java Benchmark <matrix_size> <num_runs>");
+                printUsage();
                 return;
             }
-            int n = Integer.parseInt(args[0]);
+            int[] sizes = { Integer.parseInt(args[0]) };
             int runs = Integer.parseInt(args[1]);
+            int warmup = 0;
+            int threads = 1;
+            long seed = System.currentTimeMillis() / 1000;
+            String[] nativeNames = {};
+            boolean loop = true;
+            for (int i = 2; i < args.length; i++) {
+                String opt = args[i];
+                if (opt.equals("--native-only")) {
+                    loop = false;
+                    continue;
+                }
+                if (i + 1 >= args.length) {
+                    System.err.println("[ERROR] " + opt + " expects a value");
+                    System.exit(1);
+                }
+                String val = args[++i];
+                switch (opt) {
+                    case "--sizes": sizes = parseInts(val); break;
+                    case "--warmup": warmup = Integer.parseInt(val); break;
+                    case "--seed": seed = Long.parseUnsignedLong(val); break;
+                    case "--native": nativeNames = val.split(","); break;
+                    case "--threads": threads = Integer.parseInt(val); break;
+                    default:
+                        System.err.println("[ERROR] unknown option " + opt);
+                        printUsage();
+                        System.exit(1);
+                }
+            }
+            if (runs < 1 || warmup < 0 || Arrays.stream(sizes).anyMatch(s -> s < 1)) {
+                System.err.println("[ERROR] sizes and <num_runs> must be positive");
+                System.exit(1);
+            }
 
-            Path CSV = resolveCsv();
-            double[][] A = randomMatrix(n);
-            double[][] B = randomMatrix(n);
+            int[] kernels = new int[nativeNames.length];
+            String[] labels = new String[nativeNames.length];
+            if (kernels.length > 0) {
+                try {
+                    NativeMatrix.setSeed(seed);
+                } catch (UnsatisfiedLinkError e) {
+                    System.err.println("[ERROR] could not load libmatmul_jni (" + e.getMessage() + "). Build C/ with"
+                            + " -DMATMUL_JNI=ON and set MATMUL_JNI_LIB or -Djava.library.path");
+                    System.exit(1);
+                }
+                for (int i = 0; i < kernels.length; i++) {
+                    kernels[i] = NativeMatrix.kernelId(nativeNames[i]);
+                    if (kernels[i] < 0) {
+                        System.err.println("[ERROR] unknown native kernel " + nativeNames[i]);
+                        System.exit(1);
+                    }
+                    // rows record the micro-kernel that ran, as the C harness's "simd-avx2"
+                    String name = NativeMatrix.kernelName(kernels[i]);
+                    boolean simd = name.equals("simd") || name.equals("packed");
+                    labels[i] = "jni-" + name + (simd ? "-" + NativeMatrix.isaName() : "");
+                }
+            }
 
+            Path CSV = resolveCsv();
             System.out.println("=========== JAVA BENCHMARK ===========");
-            System.out.printf("Matrix size: %dx%d | Runs: %d%n", n, n, runs);
-            System.out.println("---------------------------------------");
-
-            double total = 0.0;
-            for (int r = 1; r <= runs; r++) {
-                long memBefore = usedBytes();
-                long t0 = System.nanoTime();
-                double[][] C = multiply(A, B);
-                long t1 = System.nanoTime();
-                long memAfter = usedBytes();
-
-                double elapsed = (t1 - t0) / 1e9;
-                double memUsedMB = Math.max(0.0, (memAfter - memBefore) / (1024.0 * 1024.0));
-                total += elapsed;
-
-                String ts = LocalDateTime.now().format(DateTimeFormatter.ISO_LOCAL_DATE_TIME);
-                String line = String.join(",",
-                        "Java",
-                        Integer.toString(n),
-                        Integer.toString(r),
-                        Double.toString(elapsed),
-                        Double.toString(memUsedMB),
-                        ts
-                );
-
-                appendCsv(CSV, line);
-
-                // Console Log
-                System.out.printf("Run %d: %.6f s | Memory used: %.2f MB%n", r, elapsed, memUsedMB);
-
-                // Avoid the compiler deleting variable
-                if (C.length == 0) System.out.print("");
-            }
+            System.out.printf("[INFO] Seed: %s (repeat the inputs with --seed)%n", Long.toUnsignedString(seed));
+            for (int n : sizes) {
+                System.out.printf("Matrix size: %dx%d | Runs: %d%n", n, n, runs);
+                if (warmup > 0) System.out.printf("Warmup runs: %d (not recorded)%n", warmup);
+
+                // with the library loaded, every path multiplies the C benchmark's inputs for this seed
+                ByteBuffer a = null, b = null, c = null;
+                double[][] A, B;
+                if (kernels.length > 0) {
+                    a = NativeMatrix.allocate(n, n);
+                    b = NativeMatrix.allocate(n, n);
+                    c = NativeMatrix.allocate(n, n);
+                    NativeMatrix.fill(a, n, n, NativeMatrix.inputStream(n, n, n, 0));
+                    NativeMatrix.fill(b, n, n, NativeMatrix.inputStream(n, n, n, 1));
+                    A = toArray(a, n);
+                    B = toArray(b, n);
+                } else {
+                    java.util.Random rnd = new java.util.Random(seed);
+                    A = randomMatrix(n, rnd);
+                    B = randomMatrix(n, rnd);
+                }
 
-            System.out.println("---------------------------------------");
-            System.out.printf("Average time: %.6f s%n", total / runs);
-            System.out.println("=======================================");
+                double[][][] C = new double[1][][];
+                if (loop) {
+                    runSeries(CSV, n, "naive", 1, warmup, runs, () -> {
+                        C[0] = multiply(A, B);
+                        return -1.0;
+                    });
+                }
+                for (int i = 0; i < kernels.length; i++) {
+                    final int kernel = kernels[i], t = threads;
+                    final ByteBuffer na = a, nb = b, nc = c;
+                    runSeries(CSV, n, labels[i], threads, warmup, runs,
+                            () -> NativeMatrix.multiply(kernel, t, n, n, n, na, nb, nc));
+                    if (C[0] != null)
+                        System.out.printf(Locale.ROOT, "[INFO] max |C_java - C_%s|: %.3e%n", labels[i],
+                                maxAbsDiff(C[0], c, n));
+                }
+                System.out.println("=======================================");
+            }
+            if (kernels.length > 0) NativeMatrix.shutdown();
 
         } catch (Exception e) {
             e.printStackTrace();
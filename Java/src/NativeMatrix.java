@@ -0,0 +1,69 @@
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * The C library's kernels through JNI (C/src/jni/matrix_jni.c, built with
+ * -DMATMUL_JNI=ON). Matrices are row-major doubles in direct ByteBuffers, which
+ * the kernels read and write in place: nothing is copied on a call.
+ *
+ * The library is loaded from MATMUL_JNI_LIB if that is set, else as
+ * "matmul_jni" from java.library.path.
+ */
+public final class NativeMatrix {
+
+    static {
+        String path = System.getenv("MATMUL_JNI_LIB");
+        if (path != null && !path.isBlank()) System.load(path);
+        else System.loadLibrary("matmul_jni");
+    }
+
+    private NativeMatrix() {}
+
+    /** A zeroed rows x cols matrix in native byte order, 64-byte aligned like matrix_alloc. */
+    public static ByteBuffer allocate(int rows, int cols) {
+        int bytes = Math.multiplyExact(Math.multiplyExact(rows, cols), Double.BYTES);
+        return ByteBuffer.allocateDirect(bytes + 63).alignedSlice(64).order(ByteOrder.nativeOrder());
+    }
+
+    /** MatrixKernel value of a kernel name ("simd", "packed", ...), -1 if unknown. */
+    public static native int kernelId(String name);
+
+    /** Name of a MatrixKernel value, null if out of range. */
+    public static native String kernelName(int kernel);
+
+    /** ISA the SIMD micro-kernels run with ("avx512", "avx2", "scalar"). */
+    public static native String isaName();
+
+    /** Seed of {@link #fill}; also restarts the stream numbering. */
+    public static native void setSeed(long seed);
+
+    /**
+     * Fills a rows x cols matrix from random stream {@code stream}. Under the
+     * same seed, {@link #inputStream} streams give the C benchmark's A and B.
+     */
+    public static native void fill(ByteBuffer m, int rows, int cols, long stream);
+
+    /** Stream of the C benchmark's operand 0 (A) or 1 (B) for an m x k times k x n product. */
+    public static native long inputStream(int m, int k, int n, int operand);
+
+    /**
+     * C (m x n) = A (m x k) * B (k x n) with a kernel from {@link #kernelId} on
+     * {@code threads} threads (<= 0: the library default). Returns the
+     * multiply's own time in seconds, measured inside the library.
+     *
+     * @throws IllegalArgumentException if a buffer is not direct or too small,
+     *                                  or the library rejected the arguments
+     */
+    public static double multiply(int kernel, int threads, int m, int k, int n,
+                                  ByteBuffer a, ByteBuffer b, ByteBuffer c) {
+        double sec = multiplyNative(kernel, threads, m, k, n, a, b, c);
+        if (sec < 0) throw new IllegalArgumentException("matrix_multiply_buffers rejected the arguments");
+        return sec;
+    }
+
+    /** Stops the thread pool the library keeps between multithreaded calls. */
+    public static native void shutdown();
+
+    private static native double multiplyNative(int kernel, int threads, int m, int k, int n,
+                                                ByteBuffer a, ByteBuffer b, ByteBuffer c);
+}
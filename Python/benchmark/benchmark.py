@@ -1,66 +1,288 @@
-import os, sys, time, random, psutil, csv
+import os, sys, time, random, csv, math, argparse
+from array import array
 from datetime import datetime
 
 sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
 from src.matrix_mult import matrix_multiply
 
+try:
+    import psutil
+except ImportError:
+    psutil = None
+try:
+    import numpy as np
+except ImportError:
+    np = None
+try:
+    import resource
+except ImportError:
+    resource = None
+
 SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
-RESULTS_PATH = os.path.normpath(os.path.join(SCRIPT_DIR, "..", "..", "data", "results.csv"))
+DEFAULT_RESULTS = os.path.normpath(os.path.join(SCRIPT_DIR, "..", "..", "data", "results.csv"))
+RESULTS_PATH = os.environ.get("RESULTS_CSV") or DEFAULT_RESULTS
+
+# Same columns as the C harness (CSV_HEADER in C/benchmark/Benchmark.c); columns are only ever appended
+CSV_HEADER = ["language", "matrix_size", "run_index", "elapsed_sec", "memory_used_mb", "timestamp_iso", "kernel",
+              "setup_sec", "threads", "shape", "mults_per_sec", "rel_error", "precision", "load_sec", "ranks",
+              "density", "transfer_sec", "p50_sec", "p99_sec", "gflops", "cycles", "instructions", "l1d_misses",
+              "llc_misses", "dtlb_misses", "alloc_peak_bytes", "peak_rss_mb", "minor_faults", "major_faults",
+              "cache", "overhead_sec"]
+
 
 def ensure_csv():
-    os.makedirs(os.path.dirname(RESULTS_PATH), exist_ok=True)
+    os.makedirs(os.path.dirname(os.path.abspath(RESULTS_PATH)), exist_ok=True)
+    header = ",".join(CSV_HEADER)
     if not os.path.exists(RESULTS_PATH):
         with open(RESULTS_PATH, "w", newline="") as f:
-            writer = csv.writer(f)
-            writer.writerow(["language", "matrix_size", "run_index", "elapsed_sec", "memory_used_mb", "timestamp_iso"])
+            csv.writer(f).writerow(CSV_HEADER)
+        return
+    with open(RESULTS_PATH, newline="") as f:
+        lines = f.read().splitlines(keepends=True)
+    first = lines[0].rstrip("\r\n") if lines else ""
+    if first == header:
+        return
+    # a file written with an older schema has a prefix of the header: rewrite that line
+    if first and header.startswith(first + ","):
+        lines[0] = header + "\n"
+        with open(RESULTS_PATH, "w", newline="") as f:
+            f.writelines(lines)
+        print("[INFO] Upgraded CSV header to current schema")
+    else:
+        print(f"[WARN] Unrecognized CSV header in {RESULTS_PATH}", file=sys.stderr)
+
 
-def log_csv(n, run_index, elapsed_sec, mem_used_mb):
+def log_csv(n, run_index, elapsed_sec, mem_used_mb, kernel, threads, mem, overhead):
+    """One row in CSV_HEADER order; negative mem entries and overhead were not measured."""
+    opt = lambda v, fmt: format(v, fmt) if v >= 0 else ""
+    row = ["Python", n, run_index, f"{elapsed_sec:.6f}", f"{mem_used_mb:.3f}",
+           datetime.now().isoformat(timespec="seconds"), kernel, "0.000000", threads, f"{n}x{n}x{n}",
+           f"{1.0 / elapsed_sec if elapsed_sec > 0 else 0.0:.3f}", "", "fp64", "0.000000", 1, "", "0.000000", "", "",
+           opt(2.0 * n ** 3 / elapsed_sec / 1e9 if elapsed_sec > 0 else -1, ".3f"), "", "", "", "", "", "",
+           opt(mem["peak_rss_mb"], ".3f"), opt(mem["minor_faults"], ".0f"), opt(mem["major_faults"], ".0f"), "hot",
+           opt(overhead, ".9f")]
     with open(RESULTS_PATH, "a", newline="") as f:
-        writer = csv.writer(f)
-        writer.writerow(["Python", n, run_index, f"{elapsed_sec:.6f}",
-                         f"{mem_used_mb:.2f}", datetime.now().isoformat(timespec="seconds")])
+        csv.writer(f).writerow(row)
+
+
+# ---------- memory probes (the C harness's sources: /proc on Linux) ----------
+def _status_kb(field):
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith(field + ":"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return -1
+
+
+def get_memory_mb():
+    kb = _status_kb("VmRSS")
+    if kb >= 0:
+        return kb / 1024
+    return psutil.Process(os.getpid()).memory_info().rss / (1024**2) if psutil else 0.0
+
+
+def reset_peak_rss():
+    """Linux 4.0+ restarts the VmHWM mark when "5" is written to clear_refs."""
+    try:
+        with open("/proc/self/clear_refs", "w") as f:
+            f.write("5")
+        return True
+    except OSError:
+        return False
+
+
+def page_faults():
+    if resource is None:
+        return -1, -1
+    ru = resource.getrusage(resource.RUSAGE_SELF)
+    return ru.ru_minflt, ru.ru_majflt
+
+
+class MemProbe:
+    """Counters sampled just before a run, as mem_probe_start in the C harness."""
+
+    def __init__(self):
+        self.peak_reset = reset_peak_rss()
+        self.faults = page_faults()
+        self.start_mb = get_memory_mb()
+
+    def stop(self):
+        """(growth in MB, stats): the growth runs from the start to the peak where the
+        peak could be reset, to the end otherwise."""
+        end_mb = get_memory_mb()
+        minor, major = page_faults()
+        hwm = _status_kb("VmHWM")
+        stats = {"peak_rss_mb": hwm / 1024 if hwm >= 0 else -1.0,
+                 "minor_faults": minor - self.faults[0] if minor >= 0 else -1.0,
+                 "major_faults": major - self.faults[1] if major >= 0 else -1.0}
+        peak = stats["peak_rss_mb"]
+        grown = (peak if self.peak_reset and peak >= 0 else end_mb) - self.start_mb
+        return max(0.0, grown), stats
+
+
+# ---------- run statistics (as the C harness) ----------
+def percentile(values, pct):
+    """Nearest-rank percentile (0..100)."""
+    ordered = sorted(values)
+    return ordered[max(1, math.ceil(pct / 100 * len(ordered))) - 1]
+
+
+def bootstrap_median_ci(times, resamples=1000):
+    """95% percentile-bootstrap interval of the median, with the C harness's fixed xorshift64 stream."""
+    if len(times) < 2:
+        return times[0], times[0]
+    state, mask, medians = 0x9E3779B97F4A7C15, (1 << 64) - 1, []
+    for _ in range(resamples):
+        sample = []
+        for _ in times:
+            state ^= (state << 13) & mask
+            state ^= state >> 7
+            state ^= (state << 17) & mask
+            sample.append(times[state % len(times)])
+        medians.append(percentile(sample, 50))
+    return percentile(medians, 2.5), percentile(medians, 97.5)
+
 
 def create_matrix(n):
     return [[random.random() for _ in range(n)] for _ in range(n)]
 
-def get_memory_mb():
-    return psutil.Process(os.getpid()).memory_info().rss / (1024**2)
 
-def run_experiment(n, runs):
-    ensure_csv()
-    A = create_matrix(n)
-    B = create_matrix(n)
+def new_buffer(n):
+    """Zeroed n x n float64 buffer: a NumPy array when NumPy is installed, else array('d')."""
+    return np.zeros((n, n)) if np is not None else array("d", bytes(8 * n * n))
 
-    print("=========== PYTHON BENCHMARK ===========")
-    print(f"Matrix size: {n}x{n} | Runs: {runs}")
 
-    total = 0.0
+def to_lists(buf, n):
+    flat = memoryview(buf).cast("B").cast("d")
+    return [list(flat[i * n:(i + 1) * n]) for i in range(n)]
+
+
+def run_series(n, kernel, threads, warmup, runs, multiply):
+    """Warmup runs, then runs recorded ones, timed and probed as the C harness does.
+    multiply() returns the kernel's own time in seconds, or None (the Python loop)."""
+    print("---------------------------------------")
+    print(f"Kernel: {kernel} | Threads: {threads}")
+    for _ in range(warmup):
+        multiply()
+
+    times, overheads = [], []
     for r in range(1, runs + 1):
-        mem_before = get_memory_mb()
+        probe = MemProbe()
         t0 = time.perf_counter()
-        C = matrix_multiply(A, B, n)
+        inner = multiply()
         t1 = time.perf_counter()
-        mem_after = get_memory_mb()
+        mem_used, mem = probe.stop()
 
         elapsed = t1 - t0
-        mem_used = max(0.0, mem_after - mem_before)
-        total += elapsed
+        # what crossing into the library costs: the call minus the multiply it timed itself
+        overhead = max(0.0, elapsed - inner) if inner is not None else -1.0
+        times.append(elapsed)
+        if overhead >= 0:
+            overheads.append(overhead)
 
-        print(f"Run {r}: {elapsed:.6f} s | Memory used: {mem_used:.2f} MB")
-        log_csv(n, r, elapsed, mem_used)
+        line = f"Run {r}: {elapsed:.6f} s | {2.0 * n ** 3 / elapsed / 1e9 if elapsed > 0 else 0.0:.2f} GFLOP/s"
+        line += f" | Memory used: {mem_used:.3f} MB"
+        if mem["peak_rss_mb"] >= 0:
+            line += f" | peak RSS {mem['peak_rss_mb']:.1f} MB"
+        if overhead >= 0:
+            line += f" | call overhead {overhead * 1e6:.3f} us"
+        print(line)
+        log_csv(n, r, elapsed, mem_used, kernel, threads, mem, overhead)
 
-        # Prevent C from being optimized away by interpreter (noop read)
-        if C and C[0] and C[0][0] == float("nan"):
-            print("", end="")
+    median = percentile(times, 50)
+    lo, hi = bootstrap_median_ci(times)
+    print(f"Average time ({kernel}, {threads} threads): {sum(times) / runs:.6f} s")
+    print(f"Median {median:.6f} s | p95 {percentile(times, 95):.6f} s | 95% CI of median [{lo:.6f}, {hi:.6f}]"
+          f" | {runs} runs")
+    if overheads:
+        o = percentile(overheads, 50)
+        print(f"Call overhead: median {o * 1e6:.3f} us ({100 * o / median if median > 0 else 0.0:.2f}% of the"
+              f" median time)")
+
+
+def run_experiment(sizes, runs, warmup=0, seed=None, native_kernels=(), threads=1, loop=True):
+    ensure_csv()
+    seed = int(time.time()) if seed is None else seed
+    lib, kernels = None, []
+    if native_kernels:
+        from src.matrix_native import NativeMatrix
+        try:
+            lib = NativeMatrix()
+        except OSError as e:
+            print(f"[ERROR] could not load libmatmul: {e}", file=sys.stderr)
+            return 1
+        lib.set_seed(seed)
+        try:
+            ids = [lib.kernel_id(name) for name in native_kernels]
+        except ValueError as e:
+            print(f"[ERROR] {e}", file=sys.stderr)
+            return 1
+        for kid in ids:
+            # rows record the micro-kernel that ran, as the C harness's "simd-avx2"
+            name = lib.kernel_name(kid)
+            kernels.append((kid, f"ctypes-{name}-{lib.isa_name()}" if name in ("simd", "packed") else f"ctypes-{name}"))
+
+    print("=========== PYTHON BENCHMARK ===========")
+    print(f"[INFO] Seed: {seed} (repeat the inputs with --seed)")
+    if lib:
+        print(f"[INFO] Native library: {lib.path} | buffers: {'numpy' if np is not None else 'array'}")
+    for n in sizes:
+        print(f"Matrix size: {n}x{n} | Runs: {runs}")
+        if warmup > 0:
+            print(f"Warmup runs: {warmup} (not recorded)")
+
+        # with the library loaded, every path multiplies the C benchmark's inputs for this seed
+        if lib:
+            a, b, c = new_buffer(n), new_buffer(n), new_buffer(n)
+            lib.fill(a, n, n, lib.input_stream(n, n, n, 0))
+            lib.fill(b, n, n, lib.input_stream(n, n, n, 1))
+            A, B = to_lists(a, n), to_lists(b, n)
+        else:
+            random.seed(seed)
+            A, B = create_matrix(n), create_matrix(n)
+
+        result = []
+        if loop:
+            def python_loop():
+                result[:] = [matrix_multiply(A, B, n)]
+                return None
+            run_series(n, "naive", 1, warmup, runs, python_loop)
+        for kid, label in kernels:
+            run_series(n, label, threads, warmup, runs, lambda: lib.multiply(kid, threads, n, n, n, a, b, c))
+            if result:
+                flat = memoryview(c).cast("B").cast("d")
+                worst = max(abs(x - flat[i * n + j]) for i, row in enumerate(result[0]) for j, x in enumerate(row))
+                print(f"[INFO] max |C_python - C_{label}|: {worst:.3e}")
+        print("=======================================")
+    if lib:
+        lib.shutdown()
+    return 0
+
+
+def parse_args(argv):
+    p = argparse.ArgumentParser(description="Python matrix multiply benchmark",
+                                usage="python benchmark/benchmark.py <matrix_size> <num_runs> [options]")
+    p.add_argument("matrix_size", type=int)
+    p.add_argument("num_runs", type=int)
+    p.add_argument("--sizes", type=lambda s: [int(x) for x in s.split(",")],
+                   help="run these sizes instead of <matrix_size>")
+    p.add_argument("--warmup", type=int, default=0, help="untimed runs before the recorded ones (default 0)")
+    p.add_argument("--seed", type=int, help="seed of the random inputs (default: the current time, logged)")
+    p.add_argument("--native", type=lambda s: s.split(","), default=[],
+                   help="also run these C kernels through ctypes, e.g. simd,packed (needs a shared libmatmul)")
+    p.add_argument("--threads", type=int, default=1, help="threads of the native kernels (default 1)")
+    p.add_argument("--native-only", action="store_true", help="skip the Python loop")
+    args = p.parse_args(argv)
+    sizes = args.sizes or [args.matrix_size]
+    if args.num_runs < 1 or args.warmup < 0 or min(sizes) < 1:
+        p.error("sizes and <num_runs> must be positive")
+    return args, sizes
 
-    print("---------------------------------------")
-    print(f"Average time: {total / runs:.6f} s")
-    print("=======================================")
 
 if __name__ == "__main__":
-    if len(sys.argv) < 3:
-        print("Usage: python benchmarks/benchmark.py <matrix_size> <num_runs>")
-        sys.exit(1)
-    n = int(sys.argv[1])
-    runs = int(sys.argv[2])
-    run_experiment(n, runs)
+    args, sizes = parse_args(sys.argv[1:])
+    sys.exit(run_experiment(sizes, args.num_runs, args.warmup, args.seed, args.native, args.threads,
+                            not args.native_only))
@@ -0,0 +1,122 @@
+"""The C library's kernels through ctypes.
+
+Needs a shared libmatmul: from C/, `cmake -S . -B build-shared -DBUILD_SHARED_LIBS=ON`
+and `cmake --build build-shared`. MATMUL_LIB overrides where it is looked for.
+
+Matrices are any C-contiguous float64 buffer (a NumPy array, array.array('d'),
+a memoryview): the kernels read and write that memory in place through the
+buffer protocol, nothing is copied on a call.
+"""
+import ctypes
+import glob
+import os
+
+C_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "C"))
+LIB_NAMES = ("libmatmul.so", "libmatmul.dylib", "matmul.dll")
+
+_dbl = ctypes.POINTER(ctypes.c_double)
+
+
+def find_library():
+    """MATMUL_LIB if set, else the first shared libmatmul in a C/build*/ directory."""
+    env = os.environ.get("MATMUL_LIB")
+    if env:
+        return env
+    for name in LIB_NAMES:
+        # multi-config generators put it one level down (build-shared/Release/matmul.dll)
+        found = sorted(glob.glob(os.path.join(C_DIR, "build*", name)) +
+                       glob.glob(os.path.join(C_DIR, "build*", "*", name)))
+        if found:
+            return found[0]
+    return None
+
+
+def _address(buf, count, writable):
+    """Address of the first of count doubles in buf, which must stay alive for the call."""
+    view = memoryview(buf)
+    if view.format != "d" or not view.c_contiguous:
+        raise TypeError("matrix buffers must be C-contiguous float64")
+    if view.nbytes < count * 8:
+        raise ValueError(f"buffer holds {view.nbytes // 8} doubles, the matrix needs {count}")
+    if writable and view.readonly:
+        raise ValueError("the result buffer is read-only")
+    iface = getattr(buf, "__array_interface__", None)
+    if iface is not None:
+        # NumPy: the address is known without exporting a writable buffer
+        return iface["data"][0]
+    if view.readonly:
+        raise TypeError("read-only buffers are only accepted as NumPy arrays")
+    return ctypes.addressof(ctypes.c_char.from_buffer(view))
+
+
+class NativeMatrix:
+    """Handle on a loaded libmatmul."""
+
+    def __init__(self, path=None):
+        path = path or find_library()
+        if not path:
+            raise OSError("no shared libmatmul found: build C/ with -DBUILD_SHARED_LIBS=ON or set MATMUL_LIB")
+        self.path = path
+        lib = ctypes.CDLL(path)
+        lib.matrix_multiply_buffers.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                                ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int,
+                                                ctypes.c_void_p, ctypes.c_int, _dbl]
+        lib.matrix_multiply_buffers.restype = ctypes.c_int
+        lib.matrix_fill_buffer.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                           ctypes.c_uint64]
+        lib.matrix_fill_buffer.restype = ctypes.c_int
+        lib.matrix_input_stream.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        lib.matrix_input_stream.restype = ctypes.c_uint64
+        lib.matrix_set_seed.argtypes = [ctypes.c_uint64]
+        lib.matrix_set_seed.restype = None
+        lib.matrix_kernel_from_name.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_int)]
+        lib.matrix_kernel_from_name.restype = ctypes.c_int
+        lib.matrix_kernel_name.argtypes = [ctypes.c_int]
+        lib.matrix_kernel_name.restype = ctypes.c_char_p
+        lib.matrix_simd_isa.argtypes = []
+        lib.matrix_simd_isa.restype = ctypes.c_int
+        lib.matrix_isa_name.argtypes = [ctypes.c_int]
+        lib.matrix_isa_name.restype = ctypes.c_char_p
+        lib.matrix_buffers_shutdown.argtypes = []
+        lib.matrix_buffers_shutdown.restype = None
+        self._lib = lib
+
+    def kernel_id(self, name):
+        """MatrixKernel value of a kernel name ("simd", "packed", ...); ValueError if unknown."""
+        out = ctypes.c_int()
+        if self._lib.matrix_kernel_from_name(name.encode(), ctypes.byref(out)) != 0:
+            raise ValueError(f"unknown native kernel {name}")
+        return out.value
+
+    def kernel_name(self, kernel):
+        return self._lib.matrix_kernel_name(kernel).decode()
+
+    def isa_name(self):
+        """ISA the SIMD micro-kernels run with ("avx512", "avx2", "scalar")."""
+        return self._lib.matrix_isa_name(self._lib.matrix_simd_isa()).decode()
+
+    def set_seed(self, seed):
+        self._lib.matrix_set_seed(seed)
+
+    def fill(self, buf, rows, cols, stream):
+        """Random rows x cols matrix from stream; under one seed, input_stream gives the C benchmark's A and B."""
+        if self._lib.matrix_fill_buffer(_address(buf, rows * cols, True), rows, cols, cols, stream) != 0:
+            raise ValueError("matrix_fill_buffer rejected the arguments")
+
+    def input_stream(self, m, k, n, operand):
+        """Stream of the C benchmark's operand 0 (A) or 1 (B) for an m x k times k x n product."""
+        return self._lib.matrix_input_stream(m, k, n, operand)
+
+    def multiply(self, kernel, threads, m, k, n, a, b, c):
+        """c (m x n) = a (m x k) @ b (k x n); returns the multiply's own time in seconds."""
+        sec = ctypes.c_double()
+        rc = self._lib.matrix_multiply_buffers(kernel, threads, m, k, n, _address(a, m * k, False), k,
+                                               _address(b, k * n, False), n, _address(c, m * n, True), n,
+                                               ctypes.byref(sec))
+        if rc != 0:
+            raise ValueError("matrix_multiply_buffers rejected the arguments")
+        return sec.value
+
+    def shutdown(self):
+        """Stops the thread pool the library keeps between multithreaded calls."""
+        self._lib.matrix_buffers_shutdown()
@@ -4,11 +4,31 @@ Generates comparative figures (grouped bar charts + improved boxplots) and
 a LaTeX snippet that includes them.
 
 Input CSV schema:
-  language,matrix_size,run_index,elapsed_sec,memory_used_mb,timestamp_iso
+  language,matrix_size,run_index,elapsed_sec,memory_used_mb,timestamp_iso[,kernel,setup_sec,threads,...,
+   precision,load_sec,ranks,density,transfer_sec,p50_sec,p99_sec,gflops,cycles,instructions,l1d_misses,
+   llc_misses,dtlb_misses,alloc_peak_bytes,peak_rss_mb,minor_faults,major_faults,cache]
+
+The language column names the backend as well ("C", "C-CUDA"), so GPU rows
+form their own series. Rows with a non-naive kernel are plotted as their own
+series ("C/blocked"), fp32 and mixed-precision rows get a precision suffix ("C/simd/fp32"), and
+multithreaded rows get a thread suffix ("C/simd-avx2/8t"). When several
+thread counts are present a strong-scaling figure is written as well.
+Sparse-input rows get a density suffix ("C/csr/d0.05") and MPI SUMMA rows a
+rank suffix ("C/summa/4r"); runs over several rank counts add strong- and
+weak-scaling figures across ranks. Runs timed with flushed caches get a
+"/cold" suffix. The summary CSV has the median, the p95 and a 95% bootstrap
+confidence interval of the median next to the mean and std.
+
+--compare BASELINE skips the figures and checks the CSV against a baseline
+instead: either an earlier results CSV (Mann-Whitney U test on the runs) or a
+summary CSV such as paper/summary_stats.csv (Welch's t-test on its mean and
+std). It exits with status 1 if any series/size is slower by more than
+--threshold percent at significance --alpha.
 
 Usage (from repo root):
   python scripts/plot_benchmarks.py
   python scripts/plot_benchmarks.py --csv data/results.csv --out paper/figures --show
+  python scripts/plot_benchmarks.py --csv new.csv --compare paper/summary_stats.csv --threshold 5
 
 Requirements:
   pip install pandas matplotlib
@@ -40,22 +60,226 @@ def load_data(csv_path: Path) -> pd.DataFrame:
     df["run_index"] = df["run_index"].astype(int)
     df["elapsed_sec"] = df["elapsed_sec"].astype(float)
     df["memory_used_mb"] = df["memory_used_mb"].astype(float)
+
+    # optional kernel column (C harness): split optimized kernels into their own series
+    if "kernel" in df.columns:
+        kern = df["kernel"].fillna("naive").astype(str)
+        tuned = kern != "naive"
+        df.loc[tuned, "language"] = df.loc[tuned, "language"] + "/" + kern[tuned]
+
+    # optional precision column: fp64 is the default, other precisions get a suffix ("C/simd/fp32")
+    if "precision" in df.columns:
+        prec = df["precision"].fillna("fp64").astype(str)
+        reduced = prec != "fp64"
+        df.loc[reduced, "language"] = df.loc[reduced, "language"] + "/" + prec[reduced]
+
+    # optional density column (sparse runs): one series per density ("C/csr/d0.05")
+    if "density" in df.columns:
+        dens = df["density"]
+        sparse = dens.notna()
+        df.loc[sparse, "language"] = df.loc[sparse, "language"] + "/d" + dens[sparse].map(lambda d: f"{d:g}")
+
+    # optional cache column: hot runs keep their label, cold ones are their own series
+    if "cache" in df.columns:
+        cold = df["cache"].fillna("hot").astype(str) == "cold"
+        df.loc[cold, "language"] = df.loc[cold, "language"] + "/cold"
+
+    # optional ranks column (MPI SUMMA): single-rank rows keep their label
+    df["ranks"] = df["ranks"].fillna(1).astype(int) if "ranks" in df.columns else 1
+    df["rank_series"] = df["language"]
+    distributed = df["ranks"] > 1
+    df.loc[distributed, "language"] = df.loc[distributed, "language"] + "/" + df.loc[distributed, "ranks"].astype(str) + "r"
+
+    # optional threads column: keep the single-thread label, suffix the rest
+    df["series"] = df["language"]
+    df["threads"] = df["threads"].fillna(1).astype(int) if "threads" in df.columns else 1
+    multi = df["threads"] > 1
+    df.loc[multi, "language"] = df.loc[multi, "language"] + "/" + df.loc[multi, "threads"].astype(str) + "t"
     return df
 
 
+def bootstrap_median_ci(values: np.ndarray, resamples: int = 1000, seed: int = 0) -> tuple[float, float]:
+    """95% percentile-bootstrap interval of the median (fixed seed, reproducible)."""
+    if len(values) < 2:
+        v = float(values[0]) if len(values) else float("nan")
+        return v, v
+    rng = np.random.default_rng(seed)
+    medians = np.median(rng.choice(values, size=(resamples, len(values)), replace=True), axis=1)
+    return float(np.percentile(medians, 2.5)), float(np.percentile(medians, 97.5))
+
+
 def summarize(df: pd.DataFrame) -> pd.DataFrame:
-    return (
+    summary = (
         df.groupby(["language", "matrix_size"])
           .agg(
               runs=("run_index", "count"),
               avg_time_s=("elapsed_sec", "mean"),
               std_time_s=("elapsed_sec", "std"),
+              median_time_s=("elapsed_sec", "median"),
+              p95_time_s=("elapsed_sec", lambda t: t.quantile(0.95)),
               avg_mem_mb=("memory_used_mb", "mean"),
               std_mem_mb=("memory_used_mb", "std"),
           )
           .reset_index()
           .sort_values(["language", "matrix_size"])
     )
+    ci = {key: bootstrap_median_ci(g["elapsed_sec"].to_numpy())
+          for key, g in df.groupby(["language", "matrix_size"])}
+    keys = list(zip(summary["language"], summary["matrix_size"]))
+    summary["ci_lo_s"] = [ci[key][0] for key in keys]
+    summary["ci_hi_s"] = [ci[key][1] for key in keys]
+    # optional overhead_sec column (Java/Python rows of native kernels): the cost of the call itself
+    if "overhead_sec" in df.columns and df["overhead_sec"].notna().any():
+        overhead = df.groupby(["language", "matrix_size"])["overhead_sec"].median()
+        summary["median_overhead_s"] = [overhead.get(key, float("nan")) for key in keys]
+    return summary
+
+
+# -------------------- regression gate -------------------- #
+
+def mann_whitney_counts(n1: int, n2: int) -> list[float]:
+    """Number of orderings of n1 + n2 distinct values giving each U = 0..n1*n2.
+    Built up by placing the largest value last: from the first sample it beats
+    all n2 of the second (U grows by n2), from the second it adds nothing."""
+    prev = [[1.0] for _ in range(n2 + 1)]
+    for i in range(1, n1 + 1):
+        row = [[1.0]]
+        for j in range(1, n2 + 1):
+            c = [0.0] * (i * j + 1)
+            for u, v in enumerate(prev[j]):
+                c[u + j] += v
+            for u, v in enumerate(row[j - 1]):
+                c[u] += v
+            row.append(c)
+        prev = row
+    return prev[n2]
+
+
+def mann_whitney_greater(new, base) -> float:
+    """One-sided Mann-Whitney U p-value for "new tends to be larger than base".
+    Exact for small samples without ties, else the tie-corrected normal
+    approximation."""
+    n1, n2 = len(new), len(base)
+    pooled = sorted(list(new) + list(base))
+    # average rank of each distinct value, and the size of every tie group
+    rank, ties, i = {}, [], 0
+    while i < len(pooled):
+        j = i
+        while j < len(pooled) and pooled[j] == pooled[i]:
+            j += 1
+        rank[pooled[i]] = (i + 1 + j) / 2
+        ties.append(j - i)
+        i = j
+    u = sum(rank[v] for v in new) - n1 * (n1 + 1) / 2
+    if max(ties) == 1 and n1 * n2 <= 2500:
+        counts = mann_whitney_counts(n1, n2)
+        return sum(counts[math.ceil(u - 1e-9):]) / sum(counts)
+    n = n1 + n2
+    var = n1 * n2 / 12 * ((n + 1) - sum(t ** 3 - t for t in ties) / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (u - n1 * n2 / 2 - 0.5) / math.sqrt(var)   # with continuity correction
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def _betacf(a: float, b: float, x: float) -> float:
+    # continued fraction of the incomplete beta function (modified Lentz)
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        for num in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                    -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + num * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + num / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1.0) < 1e-12:
+            break
+    return h
+
+
+def betainc(a: float, b: float, x: float) -> float:
+    """Regularized incomplete beta function I_x(a, b)."""
+    if x <= 0.0 or x >= 1.0:
+        return 0.0 if x <= 0.0 else 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log1p(-x))
+    if x < (a + 1) / (a + b + 2):
+        return front * _betacf(a, b, x) / a
+    return 1.0 - front * _betacf(b, a, 1.0 - x) / b
+
+
+def welch_greater(m1: float, s1: float, n1: int, m2: float, s2: float, n2: int) -> float:
+    """One-sided Welch t-test p-value for "mean 1 is larger than mean 2", from summary statistics."""
+    v1, v2 = s1 * s1 / n1, s2 * s2 / n2
+    if v1 + v2 <= 0:
+        return 0.0 if m1 > m2 else 1.0
+    t = (m1 - m2) / math.sqrt(v1 + v2)
+    dof = (v1 + v2) ** 2 / (v1 * v1 / (n1 - 1) + v2 * v2 / (n2 - 1))
+    tail = 0.5 * betainc(dof / 2, 0.5, dof / (dof + t * t))   # P(T > |t|)
+    return tail if t >= 0 else 1.0 - tail
+
+
+def compare_to_baseline(df: pd.DataFrame, baseline_path: Path, threshold: float, alpha: float) -> pd.DataFrame:
+    """One row per (series, size) of df: its slowdown against the baseline and
+    whether that is a significant regression.
+
+    A raw results CSV as baseline compares medians with a Mann-Whitney test. A
+    summary CSV (as written by --summary-out) only has aggregates, so its
+    median (the mean for older summaries) is compared and Welch's t-test runs
+    on the means and standard deviations."""
+    if not baseline_path.exists():
+        raise FileNotFoundError(f"[ERROR] Baseline not found: {baseline_path}")
+    base_cols = set(pd.read_csv(baseline_path, nrows=0).columns)
+    raw = "elapsed_sec" in base_cols
+    if raw:
+        base_df = load_data(baseline_path)
+        base_runs = {key: g["elapsed_sec"].to_numpy() for key, g in base_df.groupby(["language", "matrix_size"])}
+        base = summarize(base_df).set_index(["language", "matrix_size"])
+    elif {"language", "matrix_size", "runs", "avg_time_s", "std_time_s"} <= base_cols:
+        base = pd.read_csv(baseline_path).set_index(["language", "matrix_size"])
+    else:
+        raise ValueError(f"[ERROR] {baseline_path} is neither a results CSV nor a summary CSV")
+    center = "median_time_s" if "median_time_s" in base.columns else "avg_time_s"
+
+    rows = []
+    new = summarize(df).set_index(["language", "matrix_size"])
+    for key, g in df.groupby(["language", "matrix_size"]):
+        times = g["elapsed_sec"].to_numpy()
+        row = {"language": key[0], "matrix_size": key[1], "runs": len(times),
+               "new_time_s": float(new.at[key, center]), "base_time_s": math.nan,
+               "slowdown": math.nan, "p_value": math.nan, "status": "new"}
+        if key in base.index:
+            b = base.loc[key]
+            row["base_time_s"] = float(b[center])
+            row["slowdown"] = row["new_time_s"] / row["base_time_s"] - 1.0
+            if raw and len(times) >= 2 and len(base_runs[key]) >= 2:
+                row["p_value"] = mann_whitney_greater(times, base_runs[key])
+            elif not raw and len(times) >= 2 and b["runs"] >= 2:
+                row["p_value"] = welch_greater(float(times.mean()), float(times.std(ddof=1)), len(times),
+                                               float(b["avg_time_s"]), float(b["std_time_s"]), int(b["runs"]))
+            if math.isnan(row["p_value"]):
+                row["status"] = "untested"   # fewer than two runs on one side
+            elif row["slowdown"] > threshold and row["p_value"] < alpha:
+                row["status"] = "SLOWER"
+            elif row["slowdown"] < -threshold:
+                row["status"] = "faster"
+            else:
+                row["status"] = "ok"
+        rows.append(row)
+    return pd.DataFrame(rows)
+
+
+def print_comparison(report: pd.DataFrame, threshold: float, alpha: float) -> None:
+    print(f"Regression gate: slower by more than {threshold * 100:g}% at p < {alpha:g}")
+    print(f"{'series':<28} {'size':>6} {'runs':>5} {'baseline s':>12} {'new s':>12} {'change':>8} {'p':>8}  status")
+    for r in report.itertuples(index=False):
+        change = "" if math.isnan(r.slowdown) else f"{r.slowdown * 100:+.1f}%"
+        p = "" if math.isnan(r.p_value) else f"{r.p_value:.3g}"
+        print(f"{r.language:<28} {r.matrix_size:>6} {r.runs:>5} {r.base_time_s:>12.6g} {r.new_time_s:>12.6g} "
+              f"{change:>8} {p:>8}  {r.status}")
 
 
 # -------------------- helper: color cycle -------------------- #
@@ -133,6 +357,79 @@ def fig_speedup_vs_python(summary: pd.DataFrame, outdir: Path, show: bool = Fals
     return p, tbl_path
 
 
+def fig_strong_scaling(df: pd.DataFrame, outdir: Path, show: bool = False):
+    """Speedup T(1)/T(p) per series and size; None when only one thread count was run."""
+    if df["threads"].nunique() < 2:
+        return None
+    avg = df.groupby(["series", "matrix_size", "threads"])["elapsed_sec"].mean().reset_index()
+    base = avg[avg["threads"] == 1][["series", "matrix_size", "elapsed_sec"]].rename(columns={"elapsed_sec": "t1"})
+    merged = avg.merge(base, on=["series", "matrix_size"], how="inner")
+    merged = merged[merged.groupby(["series", "matrix_size"])["threads"].transform("nunique") > 1]
+    if merged.empty:
+        return None
+    merged["speedup"] = merged["t1"] / merged["elapsed_sec"]
+
+    p = outdir / "strong_scaling.png"
+    plt.figure()
+    for (series, size), g in merged.groupby(["series", "matrix_size"]):
+        g = g.sort_values("threads")
+        plt.plot(g["threads"], g["speedup"], marker="o", label=f"{series} n={size}")
+    tmax = merged["threads"].max()
+    plt.plot([1, tmax], [1, tmax], linestyle="--", color="gray", label="ideal")
+    plt.xlabel("Threads")
+    plt.ylabel("Speedup vs 1 thread (×)")
+    plt.title("Strong Scaling")
+    plt.grid(True, axis="y")
+    plt.legend(fontsize="small")
+    plt.tight_layout()
+    plt.savefig(p, bbox_inches="tight")
+    if show: plt.show()
+    plt.close()
+    return p
+
+
+def fig_rank_scaling(df: pd.DataFrame, outdir: Path, show: bool = False):
+    """Across MPI ranks: strong-scaling speedup T(1)/T(P) at a fixed size, and
+    weak-scaling efficiency T(1)/T(P) for "-weak" rows, whose size grows with P."""
+    if df["ranks"].nunique() < 2:
+        return []
+    avg = df.groupby(["rank_series", "threads", "matrix_size", "ranks"])["elapsed_sec"].mean().reset_index()
+    weak = avg["rank_series"].str.endswith("-weak")
+    written = []
+    for is_weak, keys, fname, ylabel, title in (
+            (False, ["rank_series", "threads", "matrix_size"], "rank_strong_scaling.png",
+             "Speedup vs 1 rank (×)", "Strong Scaling across Ranks"),
+            (True, ["rank_series", "threads"], "rank_weak_scaling.png",
+             "Efficiency T(1)/T(P)", "Weak Scaling across Ranks")):
+        sub = avg[weak == is_weak]
+        base = sub[sub["ranks"] == 1][keys + ["elapsed_sec"]].rename(columns={"elapsed_sec": "t1"})
+        merged = sub.merge(base, on=keys, how="inner")
+        merged = merged[merged.groupby(keys)["ranks"].transform("nunique") > 1]
+        if merged.empty:
+            continue
+        merged["ratio"] = merged["t1"] / merged["elapsed_sec"]
+
+        p = outdir / fname
+        plt.figure()
+        for key, g in merged.groupby(keys):
+            g = g.sort_values("ranks")
+            label = f"{key[0]} {key[1]}t" + ("" if is_weak else f" n={key[2]}")
+            plt.plot(g["ranks"], g["ratio"], marker="o", label=label)
+        pmax = merged["ranks"].max()
+        plt.plot([1, pmax], [1, 1] if is_weak else [1, pmax], linestyle="--", color="gray", label="ideal")
+        plt.xlabel("MPI ranks")
+        plt.ylabel(ylabel)
+        plt.title(title)
+        plt.grid(True, axis="y")
+        plt.legend(fontsize="small")
+        plt.tight_layout()
+        plt.savefig(p, bbox_inches="tight")
+        if show: plt.show()
+        plt.close()
+        written.append(p)
+    return written
+
+
 # -------------------- NEW: Grouped bar charts (with error bars) -------------------- #
 
 def grouped_bar(summary: pd.DataFrame, value_col: str, err_col: str, ylabel: str, filename: str,
@@ -272,9 +569,29 @@ def main():
     ap.add_argument("--out", type=Path, default=Path("paper/figures"))
     ap.add_argument("--summary-out", type=Path, default=Path("paper/summary_stats.csv"))
     ap.add_argument("--show", action="store_true")
+    ap.add_argument("--compare", type=Path, metavar="BASELINE",
+                    help="compare against a baseline results or summary CSV and exit 1 on regressions")
+    ap.add_argument("--threshold", type=float, default=5.0, help="slowdown in percent that fails --compare")
+    ap.add_argument("--alpha", type=float, default=0.05, help="significance level for --compare")
+    ap.add_argument("--report", type=Path, help="write the --compare table to this CSV")
     args = ap.parse_args()
 
     df = load_data(args.csv)
+    if args.compare:
+        report = compare_to_baseline(df, args.compare, args.threshold / 100.0, args.alpha)
+        print_comparison(report, args.threshold / 100.0, args.alpha)
+        if args.report:
+            args.report.parent.mkdir(parents=True, exist_ok=True)
+            report.to_csv(args.report, index=False)
+        untested = int((report["status"] == "untested").sum())
+        if untested:
+            print(f"[WARN] {untested} series/sizes have fewer than two runs on one side and were not tested")
+        slower = report[report["status"] == "SLOWER"]
+        if len(slower):
+            print(f"[FAIL] {len(slower)} regression(s) against {args.compare}", file=sys.stderr)
+            return 1
+        print(f"[OK] no significant regression against {args.compare}")
+        return 0
     args.out.mkdir(parents=True, exist_ok=True)
     args.summary_out.parent.mkdir(parents=True, exist_ok=True)
 
@@ -286,6 +603,8 @@ def main():
     fig_avg_time(summary, args.out, args.show)
     fig_avg_mem(summary, args.out, args.show)
     fig_speedup_vs_python(summary, args.out, args.show)
+    fig_strong_scaling(df, args.out, args.show)
+    fig_rank_scaling(df, args.out, args.show)
 
     # === NEW required plots ===
     # 1) grouped bar — time & memory with error bars
@@ -304,6 +623,11 @@ def main():
     box_grid(df, "memory_used_mb", "Memory used (MB)",
              filename="box_mem_all_sizes.png", outdir=args.out, show=args.show)
 
+    # peak resident set per run (C harness); older rows leave the column empty
+    if "peak_rss_mb" in df.columns and df["peak_rss_mb"].notna().any():
+        box_grid(df.dropna(subset=["peak_rss_mb"]), "peak_rss_mb", "Peak RSS (MB)",
+                 filename="box_peak_rss_all_sizes.png", outdir=args.out, show=args.show)
+
     # Write LaTeX snippet that includes the four figs above
     snippet = write_bars_boxplots_snippet(args.out)
 
@@ -311,11 +635,12 @@ def main():
     print(f"Summary CSV: {args.summary_out.resolve()}")
     print(f"LaTeX snippet written to: {snippet.resolve()}")
     print(f"Figures dir: {args.out.resolve()}")
+    return 0
 
 
 if __name__ == "__main__":
     try:
-        main()
+        sys.exit(main())
     except Exception as e:
         print(f"[FATAL] {e}", file=sys.stderr)
         sys.exit(1)